@@ -26,16 +26,45 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <string.h>
 
 #include "Arduino.h"
+#include "CRCEngine.h"
 
 
-/**< CRC configuration */
-#define CRC16_POLYNOMIAL 0x8005u
-#define CRC32_POLYNOMIAL 0xEDB88320u
-
 /**< SHA256 configuration */
-#define SHA256_CHUNK_SIZE 64
 #define SHA256_TOTAL_LEN_LEN 8
 
+/**< SHA256 round functions, Ch and Maj use forms with one operation less */
+#define SHA256_ROTR(x, n) __calcSHA256_RightRotation((x), (n))
+#define SHA256_SUM0(x) (SHA256_ROTR((x), 2) ^ SHA256_ROTR((x), 13) ^ SHA256_ROTR((x), 22))
+#define SHA256_SUM1(x) (SHA256_ROTR((x), 6) ^ SHA256_ROTR((x), 11) ^ SHA256_ROTR((x), 25))
+#define SHA256_SCHEDULE_S0(x) (SHA256_ROTR((x), 7) ^ SHA256_ROTR((x), 18) ^ ((x) >> 3))
+#define SHA256_SCHEDULE_S1(x) (SHA256_ROTR((x), 17) ^ SHA256_ROTR((x), 19) ^ ((x) >> 10))
+#define SHA256_CH(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define SHA256_MAJ(x, y, z) (((x) & (y)) | ((z) & ((x) | (y))))
+
+/**< One SHA256 round, updates d and h in place */
+#define SHA256_ROUND(a, b, c, d, e, f, g, h, i)                                                  \
+    do                                                                                           \
+    {                                                                                            \
+        uint32_t temp1 = (h) + SHA256_SUM1(e) + SHA256_CH(e, f, g) + sha256_k[i] + w[(i) & 15]; \
+        (d) += temp1;                                                                            \
+        (h) = temp1 + SHA256_SUM0(a) + SHA256_MAJ(a, b, c);                                     \
+    } while (0)
+
+
+/**< CRC16 used by UART protocol: poly 0x8005, no reflection */
+typedef CRCEngine<uint16_t, 16, 0x8005u, CRC16_INIT_VAL, false, false, 0x0000u, (CRCTable_T)CRC16_TABLE_SIZE> CRC16_T;
+
+/**< CRC16 MODBUS: poly 0x8005, reflected in and out */
+typedef CRCEngine<uint16_t, 16, 0x8005u, CRC16_INIT_VAL, true, true, 0x0000u, (CRCTable_T)CRC16_MODBUS_TABLE_SIZE> CRC16Modbus_T;
+
+/**< CRC32: poly 0x04C11DB7, reflected in and out, inverted result */
+typedef CRCEngine<uint32_t, 32, 0x04C11DB7u, CRC32_INIT_VAL, true, true, 0xFFFFFFFFu, (CRCTable_T)CRC32_TABLE_SIZE> CRC32_T;
+
+/**< Known answer checks of the engines, data is "123456789" */
+static constexpr uint8_t crc_check_data[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+static_assert(CRC16_T::Calc(crc_check_data, sizeof(crc_check_data)) == 0xAEE7u, "CRC16 known answer check failed");
+static_assert(CRC16Modbus_T::Calc(crc_check_data, sizeof(crc_check_data)) == 0x4B37u, "CRC16 MODBUS known answer check failed");
+static_assert(CRC32_T::Calc(crc_check_data, sizeof(crc_check_data)) == 0xCBF43926u, "CRC32 known answer check failed");
 
 static const uint32_t sha256_k[] = {0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01,
                                     0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
@@ -47,35 +76,11 @@ static const uint32_t sha256_k[] = {0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5db
 
 static const uint32_t sha256_h[] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
 
-typedef struct __SHA256_State_Tag
-{
-    const uint8_t *p;
-    size_t         len;
-    size_t         total_len;
-    bool           single_one_delivered;
-    bool           total_len_delivered;
-} __SHA256_State_T;
-
-
-/*
- *  Internal CRC16 calculations
- */
-static uint16_t __calcCRC16(uint8_t data, uint16_t crc);
-
-/**
- * Internal CRC16 calculations, byte reflection
- */
-static uint8_t __calcCRC16_ReflectByte(uint8_t crc);
-
-/*
- *  Internal SHA256 calculations
- */
-static void __calcSHA256(uint32_t hash[32], const void *input, size_t len);
 
 /*
- *  Internal SHA256 chunk calculations
+ *  Internal SHA256 block compression
  */
-static bool __calcSHA256_Chunk(uint8_t chunk[SHA256_CHUNK_SIZE], __SHA256_State_T *state);
+static void __calcSHA256_Block(uint32_t state[8], const uint8_t *block);
 
 /*
  *  Internal SHA256 right rotation
@@ -85,217 +90,159 @@ static inline uint32_t __calcSHA256_RightRotation(uint32_t value, unsigned int c
 
 uint16_t CalcCRC16(uint8_t *data, size_t len, uint16_t init_val)
 {
-    uint16_t crc = init_val;
-    for (size_t i = 0; i < len; i++)
-    {
-        crc = __calcCRC16(data[i], crc);
-    }
-
-    return crc;
+    return CRC16_T::Final(CRC16_T::Update(init_val, data, len));
 }
 
 uint16_t CalcCRC16_Modbus(uint8_t *data, size_t len, uint16_t init_val)
 {
-    uint16_t crc = init_val;
-    for (size_t i = 0; i < len; i++)
-    {
-        crc = __calcCRC16(__calcCRC16_ReflectByte(data[i]), crc);
-    }
+    uint16_t crc = CRC16Modbus_T::Final(CRC16Modbus_T::Update(CRC16Modbus_T::Register(init_val), data, len));
 
-    uint16_t result = 0;
-    result |= (uint16_t)__calcCRC16_ReflectByte(lowByte(crc));
-    result |= (uint16_t)__calcCRC16_ReflectByte(highByte(crc)) << 8;
-
-    return result;
+    // Low byte of MODBUS CRC goes first on the wire, MODBUS.cpp sends high byte first
+    return (uint16_t)(crc << 8) | (uint16_t)(crc >> 8);
 }
 
 uint32_t CalcCRC32(uint8_t *data, size_t len, uint32_t init_val)
 {
-    uint32_t crc = init_val;
-    for (uint32_t i = 0; i < len; i++)
-    {
-        crc = crc ^ data[i];
-        for (uint32_t j = 8; j > 0; j--)
-        {
-            crc = (crc >> 1) ^ (CRC32_POLYNOMIAL & ((crc & 1) ? 0xFFFFFFFF : 0));
-        }
-    }
-    return ~crc;
+    return CRC32_T::Final(CRC32_T::Update(init_val, data, len));
 }
 
 void CalcSHA256(uint8_t *data, size_t len, uint8_t *sha256)
 {
-    __calcSHA256((uint32_t *)sha256, data, len);
-}
+    Sha256_T ctx;
 
+    Sha256_Init(&ctx);
+    Sha256_Update(&ctx, data, len);
+    Sha256_Final(&ctx, sha256);
+}
 
-static uint16_t __calcCRC16(uint8_t data, uint16_t crc)
+void Sha256_Init(Sha256_T *p_ctx)
 {
-    for (uint8_t i = 0; i < 8; i++)
-    {
-        if (((crc & 0x8000) >> 8) ^ (data & 0x80))
-        {
-            crc = (crc << 1) ^ CRC16_POLYNOMIAL;
-        }
-        else
-        {
-            crc = (crc << 1);
-        }
-        data <<= 1;
-    }
-
-    return crc;
+    memcpy(p_ctx->state, sha256_h, sizeof(p_ctx->state));
+    p_ctx->total_len = 0;
+    p_ctx->block_len = 0;
 }
 
-static uint8_t __calcCRC16_ReflectByte(uint8_t crc)
+void Sha256_Resume(Sha256_T *p_ctx, const uint32_t *state, uint64_t len)
 {
-    uint8_t result = 0;
-
-    result |= (uint8_t)(crc & 0x01u) << 7;
-    result |= (uint8_t)(crc & 0x02u) << 5;
-    result |= (uint8_t)(crc & 0x04u) << 3;
-    result |= (uint8_t)(crc & 0x08u) << 1;
-    result |= (uint8_t)(crc & 0x10u) >> 1;
-    result |= (uint8_t)(crc & 0x20u) >> 3;
-    result |= (uint8_t)(crc & 0x40u) >> 5;
-    result |= (uint8_t)(crc & 0x80u) >> 7;
-
-    return result;
+    memcpy(p_ctx->state, state, sizeof(p_ctx->state));
+    p_ctx->total_len = len;
+    p_ctx->block_len = 0;
 }
 
-static void __calcSHA256(uint32_t hash[32], const void *input, size_t len)
+void Sha256_Update(Sha256_T *p_ctx, const uint8_t *data, size_t len)
 {
-    size_t i, j;
+    p_ctx->total_len += len;
 
-    memcpy(hash, sha256_h, 32);
-
-    uint8_t chunk[64];
-
-    __SHA256_State_T state = {
-        .p                    = (uint8_t *)input,
-        .len                  = len,
-        .total_len            = len,
-        .single_one_delivered = 0,
-        .total_len_delivered  = 0,
-    };
-
-    while (__calcSHA256_Chunk(chunk, &state))
+    if (p_ctx->block_len != 0)
     {
-        uint32_t ah[8];
-
-        uint32_t       w[64];
-        const uint8_t *p = chunk;
-
-        memset(w, 0x00, sizeof w);
-        for (i = 0; i < 16; i++)
-        {
-            w[i] = (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | (uint32_t)p[3];
-            p += 4;
-        }
-
-        for (i = 16; i < 64; i++)
-        {
-            const uint32_t s0 = __calcSHA256_RightRotation(w[i - 15], 7) ^ __calcSHA256_RightRotation(w[i - 15], 18) ^ (w[i - 15] >> 3);
-            const uint32_t s1 = __calcSHA256_RightRotation(w[i - 2], 17) ^ __calcSHA256_RightRotation(w[i - 2], 19) ^ (w[i - 2] >> 10);
-
-            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
-        }
-
-        for (i = 0; i < 8; i++)
+        size_t fill = SHA256_BLOCK_SIZE - p_ctx->block_len;
+        if (len < fill)
         {
-            ah[i] = hash[i];
+            memcpy(p_ctx->block + p_ctx->block_len, data, len);
+            p_ctx->block_len += len;
+            return;
         }
 
-        for (i = 0; i < 64; i++)
-        {
-            const uint32_t s1 = __calcSHA256_RightRotation(ah[4], 6) ^ __calcSHA256_RightRotation(ah[4], 11) ^ __calcSHA256_RightRotation(ah[4], 25);
-
-            const uint32_t ch    = (ah[4] & ah[5]) ^ (~ah[4] & ah[6]);
-            const uint32_t temp1 = ah[7] + s1 + ch + sha256_k[i] + w[i];
-            const uint32_t s0    = __calcSHA256_RightRotation(ah[0], 2) ^ __calcSHA256_RightRotation(ah[0], 13) ^ __calcSHA256_RightRotation(ah[0], 22);
-
-            const uint32_t maj   = (ah[0] & ah[1]) ^ (ah[0] & ah[2]) ^ (ah[1] & ah[2]);
-            const uint32_t temp2 = s0 + maj;
-
-            ah[7] = ah[6];
-            ah[6] = ah[5];
-            ah[5] = ah[4];
-            ah[4] = ah[3] + temp1;
-            ah[3] = ah[2];
-            ah[2] = ah[1];
-            ah[1] = ah[0];
-            ah[0] = temp1 + temp2;
-        }
-
-        for (i = 0; i < 8; i++)
-        {
-            hash[i] += ah[i];
-        }
+        memcpy(p_ctx->block + p_ctx->block_len, data, fill);
+        __calcSHA256_Block(p_ctx->state, p_ctx->block);
+        p_ctx->block_len = 0;
+        data += fill;
+        len -= fill;
     }
 
-    for (i = 0, j = 0; i < 8; i++)
+    // Full blocks are compressed directly from input, without copying
+    while (len >= SHA256_BLOCK_SIZE)
     {
-        uint32_t word          = hash[i];
-        ((uint8_t *)hash)[j++] = (uint8_t)(word >> 24);
-        ((uint8_t *)hash)[j++] = (uint8_t)(word >> 16);
-        ((uint8_t *)hash)[j++] = (uint8_t)(word >> 8);
-        ((uint8_t *)hash)[j++] = (uint8_t)word;
+        __calcSHA256_Block(p_ctx->state, data);
+        data += SHA256_BLOCK_SIZE;
+        len -= SHA256_BLOCK_SIZE;
     }
+
+    memcpy(p_ctx->block, data, len);
+    p_ctx->block_len = len;
 }
 
-static bool __calcSHA256_Chunk(uint8_t chunk[SHA256_CHUNK_SIZE], __SHA256_State_T *state)
+void Sha256_Final(Sha256_T *p_ctx, uint8_t *sha256)
 {
-    size_t space_in_chunk;
+    uint64_t total_bits = p_ctx->total_len << 3;
+    size_t   len        = p_ctx->block_len;
+
+    p_ctx->block[len++] = 0x80;
+
+    if (len > SHA256_BLOCK_SIZE - SHA256_TOTAL_LEN_LEN)
+    {
+        memset(p_ctx->block + len, 0x00, SHA256_BLOCK_SIZE - len);
+        __calcSHA256_Block(p_ctx->state, p_ctx->block);
+        len = 0;
+    }
 
-    if (state->total_len_delivered)
+    memset(p_ctx->block + len, 0x00, SHA256_BLOCK_SIZE - SHA256_TOTAL_LEN_LEN - len);
+    for (size_t i = 0; i < SHA256_TOTAL_LEN_LEN; i++)
     {
-        return false;
+        p_ctx->block[SHA256_BLOCK_SIZE - 1 - i] = (uint8_t)(total_bits >> (8 * i));
     }
+    __calcSHA256_Block(p_ctx->state, p_ctx->block);
 
-    if (state->len >= SHA256_CHUNK_SIZE)
+    for (size_t i = 0, j = 0; i < 8; i++)
     {
-        memcpy(chunk, state->p, SHA256_CHUNK_SIZE);
-        state->p += SHA256_CHUNK_SIZE;
-        state->len -= SHA256_CHUNK_SIZE;
-        return true;
+        uint32_t word = p_ctx->state[i];
+        sha256[j++]   = (uint8_t)(word >> 24);
+        sha256[j++]   = (uint8_t)(word >> 16);
+        sha256[j++]   = (uint8_t)(word >> 8);
+        sha256[j++]   = (uint8_t)word;
     }
+}
+
 
-    memcpy(chunk, state->p, state->len);
-    chunk += state->len;
-    space_in_chunk = SHA256_CHUNK_SIZE - state->len;
-    state->p += state->len;
-    state->len = 0;
+static void __calcSHA256_Block(uint32_t state[8], const uint8_t *block)
+{
+    uint32_t w[16]; /**< Rolling message schedule, w[i & 15] holds word i */
+    size_t   i;
 
-    if (!state->single_one_delivered)
+    for (i = 0; i < 16; i++)
     {
-        *chunk++ = 0x80;
-        space_in_chunk -= 1;
-        state->single_one_delivered = 1;
+        w[i] = (uint32_t)block[0] << 24 | (uint32_t)block[1] << 16 | (uint32_t)block[2] << 8 | (uint32_t)block[3];
+        block += 4;
     }
 
-    if (space_in_chunk >= SHA256_TOTAL_LEN_LEN)
+    uint32_t a = state[0];
+    uint32_t b = state[1];
+    uint32_t c = state[2];
+    uint32_t d = state[3];
+    uint32_t e = state[4];
+    uint32_t f = state[5];
+    uint32_t g = state[6];
+    uint32_t h = state[7];
+
+    // 8 rounds per pass, working variables are renamed instead of shifted
+    for (i = 0; i < 64; i += 8)
     {
-        const size_t left = space_in_chunk - SHA256_TOTAL_LEN_LEN;
-        size_t       len  = state->total_len;
-        int          i;
-        memset(chunk, 0x00, left);
-        chunk += left;
-
-        chunk[7] = (uint8_t)(len << 3);
-        len >>= 5;
-        for (i = 6; i >= 0; i--)
+        if (i >= 16)
         {
-            chunk[i] = (uint8_t)len;
-            len >>= 8;
+            for (size_t j = i; j < i + 8; j++)
+            {
+                w[j & 15] += SHA256_SCHEDULE_S0(w[(j - 15) & 15]) + w[(j - 7) & 15] + SHA256_SCHEDULE_S1(w[(j - 2) & 15]);
+            }
         }
-        state->total_len_delivered = 1;
-    }
-    else
-    {
-        memset(chunk, 0x00, space_in_chunk);
+
+        SHA256_ROUND(a, b, c, d, e, f, g, h, i + 0);
+        SHA256_ROUND(h, a, b, c, d, e, f, g, i + 1);
+        SHA256_ROUND(g, h, a, b, c, d, e, f, i + 2);
+        SHA256_ROUND(f, g, h, a, b, c, d, e, i + 3);
+        SHA256_ROUND(e, f, g, h, a, b, c, d, i + 4);
+        SHA256_ROUND(d, e, f, g, h, a, b, c, i + 5);
+        SHA256_ROUND(c, d, e, f, g, h, a, b, i + 6);
+        SHA256_ROUND(b, c, d, e, f, g, h, a, i + 7);
     }
 
-    return true;
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
 }
 
 static inline uint32_t __calcSHA256_RightRotation(uint32_t value, unsigned int count)
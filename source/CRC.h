@@ -28,9 +28,45 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <stdint.h>
 
 
+#ifndef CRC16_TABLE_SIZE
+#define CRC16_TABLE_SIZE 256 /**< CRC16 lookup table size: 256 (byte-wise, 512 B of flash) or 16 (nibble-wise, 32 B of flash) */
+#endif
+
+#ifndef CRC16_MODBUS_TABLE_SIZE
+#define CRC16_MODBUS_TABLE_SIZE 16 /**< CRC16 MODBUS lookup table size: 256 (byte-wise, 512 B of flash) or 16 (nibble-wise, 32 B of flash) */
+#endif
+
+#ifndef CRC32_TABLE_SIZE
+#define CRC32_TABLE_SIZE 256 /**< CRC32 lookup table size: 1024 (slicing-by-4, 4 kB of flash), 256 (byte-wise, 1 kB of flash) or 16 (nibble-wise, 64 B of flash) */
+#endif
+
+#if CRC16_TABLE_SIZE != 256 && CRC16_TABLE_SIZE != 16
+#error "CRC16_TABLE_SIZE must be 256 or 16"
+#endif
+
+#if CRC16_MODBUS_TABLE_SIZE != 256 && CRC16_MODBUS_TABLE_SIZE != 16
+#error "CRC16_MODBUS_TABLE_SIZE must be 256 or 16"
+#endif
+
+#if CRC32_TABLE_SIZE != 1024 && CRC32_TABLE_SIZE != 256 && CRC32_TABLE_SIZE != 16
+#error "CRC32_TABLE_SIZE must be 1024, 256 or 16"
+#endif
+
 #define CRC16_INIT_VAL 0xFFFFu     /**< CRC16 init value */
 #define CRC32_INIT_VAL 0xFFFFFFFFu /**< CRC32 init value */
 
+#define SHA256_BLOCK_SIZE 64  /**< SHA256 block size */
+#define SHA256_DIGEST_SIZE 32 /**< SHA256 digest size */
+
+
+typedef struct
+{
+    uint32_t state[8];                 /**< Intermediate hash value */
+    uint64_t total_len;                /**< Number of bytes hashed so far */
+    uint8_t  block[SHA256_BLOCK_SIZE]; /**< Data waiting for a full block */
+    uint8_t  block_len;                /**< Number of bytes in block */
+} Sha256_T;
+
 
 /*
  *  Calculate CRC16
@@ -63,7 +99,7 @@ uint16_t CalcCRC16_Modbus(uint8_t *data, size_t len, uint16_t init_val);
 uint32_t CalcCRC32(uint8_t *data, size_t len, uint32_t init_val);
 
 /*
- *  Calculate CRC32
+ *  Calculate SHA256
  *
  *  @param * data       Pointer to data
  *  @param len          Data len
@@ -71,4 +107,37 @@ uint32_t CalcCRC32(uint8_t *data, size_t len, uint32_t init_val);
  */
 void CalcSHA256(uint8_t *data, size_t len, uint8_t *sha256);
 
+/*
+ *  Start streaming SHA256 calculation
+ *
+ *  @param * p_ctx      SHA256 context
+ */
+void Sha256_Init(Sha256_T *p_ctx);
+
+/*
+ *  Add data to streaming SHA256 calculation
+ *
+ *  @param * p_ctx      SHA256 context
+ *  @param * data       Pointer to data
+ *  @param len          Data len
+ */
+void Sha256_Update(Sha256_T *p_ctx, const uint8_t *data, size_t len);
+
+/*
+ *  Continue streaming SHA256 calculation from saved intermediate hash
+ *
+ *  @param * p_ctx      SHA256 context
+ *  @param * state      Intermediate hash value, state field of a context
+ *  @param len          Number of bytes already hashed, multiple of SHA256_BLOCK_SIZE
+ */
+void Sha256_Resume(Sha256_T *p_ctx, const uint32_t *state, uint64_t len);
+
+/*
+ *  Finish streaming SHA256 calculation. Context has to be initialized again before reuse.
+ *
+ *  @param * p_ctx      SHA256 context
+ *  @param * sha256     [out] calculated SHA256
+ */
+void Sha256_Final(Sha256_T *p_ctx, uint8_t *sha256);
+
 #endif    // CRC_H_
@@ -0,0 +1,231 @@
+/*
+Copyright © 2021 Silvair Sp. z o.o. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef CRC_ENGINE_H_
+#define CRC_ENGINE_H_
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/**< Lookup table layouts, value is number of table entries */
+enum CRCTable_T
+{
+    CRC_TABLE_NIBBLE     = 16,   /**< Nibble-wise, 2 lookups per byte */
+    CRC_TABLE_BYTE       = 256,  /**< Byte-wise, 1 lookup per byte */
+    CRC_TABLE_SLICE_BY_4 = 1024, /**< 4 tables, 4 lookups per 4 bytes, reflected 32-bit CRCs only */
+};
+
+
+/*
+ *  Reflect lowest bits of value
+ *
+ *  @param value        Value to reflect
+ *  @param bits         Number of bits to reflect
+ *  @return             Reflected value
+ */
+template <typename T>
+constexpr T CRC_Reflect(T value, unsigned bits)
+{
+    T result = 0;
+    for (unsigned i = 0; i < bits; i++)
+    {
+        result = (result << 1) | ((value >> i) & 1u);
+    }
+    return result;
+}
+
+
+/*
+ *  CRC lookup table generated at compile time
+ */
+template <typename T, unsigned Width, T Poly, bool Reflected, CRCTable_T Table>
+struct CRCLookup
+{
+    T value[Table];
+
+    constexpr CRCLookup() : value()
+    {
+        const unsigned bits      = (Table == CRC_TABLE_NIBBLE) ? 4 : 8;
+        const unsigned entries   = 1u << bits;
+        const T        mask      = (Width == 8 * sizeof(T)) ? (T)~(T)0 : (T)(((T)1 << Width) - 1);
+        const T        top_bit   = (T)1 << (Width - 1);
+        const T        poly_refl = CRC_Reflect<T>(Poly, Width);
+
+        for (unsigned i = 0; i < entries; i++)
+        {
+            T crc = Reflected ? (T)i : (T)((T)i << (Width - bits));
+            for (unsigned j = 0; j < bits; j++)
+            {
+                if (Reflected)
+                {
+                    crc = (crc & 1u) ? (T)((crc >> 1) ^ poly_refl) : (T)(crc >> 1);
+                }
+                else
+                {
+                    crc = (crc & top_bit) ? (T)((crc << 1) ^ Poly) : (T)(crc << 1);
+                }
+            }
+            value[i] = crc & mask;
+        }
+
+        // Slice k gives CRC of the byte followed by k zero bytes
+        for (unsigned slice = 1; slice < Table / 256; slice++)
+        {
+            for (unsigned i = 0; i < 256; i++)
+            {
+                T prev                    = value[(slice - 1) * 256 + i];
+                value[slice * 256 + i] = (T)((prev >> 8) ^ value[prev & 0xFFu]);
+            }
+        }
+    }
+};
+
+
+/*
+ *  CRC engine parameterised like in the Rocksoft model.
+ *
+ *  Register value is kept in the domain of the algorithm, i.e. reflected if RefIn is set,
+ *  so input bytes are never bit reversed. Calculation can be split between several
+ *  Update calls:
+ *
+ *      T crc = CRC::Start();
+ *      crc   = CRC::Update(crc, data_1, len_1);
+ *      crc   = CRC::Update(crc, data_2, len_2);
+ *      T val = CRC::Final(crc);
+ */
+template <typename T, unsigned Width, T Poly, T Init, bool RefIn, bool RefOut, T XorOut, CRCTable_T Table>
+class CRCEngine
+{
+    static_assert((Width >= 8) && (Width <= 8 * sizeof(T)), "CRC width must fit the register type");
+    static_assert((Table != CRC_TABLE_SLICE_BY_4) || (RefIn && (Width == 32)), "Slicing-by-4 supports reflected 32-bit CRCs only");
+
+  public:
+    /*
+     *  Get register value to start calculation with
+     *
+     *  @return             Initial register value
+     */
+    static constexpr T Start(void)
+    {
+        return Register(Init);
+    }
+
+    /*
+     *  Convert init value of the model to register value
+     *
+     *  @param init         Init value
+     *  @return             Register value
+     */
+    static constexpr T Register(T init)
+    {
+        return RefIn ? CRC_Reflect<T>(init, Width) : init;
+    }
+
+    /*
+     *  Update register with data
+     *
+     *  @param crc          Register value
+     *  @param * data       Pointer to data
+     *  @param len          Data len
+     *  @return             Updated register value
+     */
+    static constexpr T Update(T crc, const uint8_t *data, size_t len)
+    {
+        size_t i = 0;
+
+        if (Table == CRC_TABLE_SLICE_BY_4)
+        {
+            for (; i + 4 <= len; i += 4)
+            {
+                crc ^= (T)data[i] | ((T)data[i + 1] << 8) | ((T)data[i + 2] << 16) | ((T)data[i + 3] << 24);
+                crc = table.value[3 * 256 + (crc & 0xFFu)] ^ table.value[2 * 256 + ((crc >> 8) & 0xFFu)] ^
+                      table.value[1 * 256 + ((crc >> 16) & 0xFFu)] ^ table.value[(crc >> 24) & 0xFFu];
+            }
+        }
+
+        for (; i < len; i++)
+        {
+            crc = UpdateByte(crc, data[i]);
+        }
+
+        return crc;
+    }
+
+    /*
+     *  Get CRC value from register
+     *
+     *  @param crc          Register value
+     *  @return             CRC value
+     */
+    static constexpr T Final(T crc)
+    {
+        return (T)(((RefIn != RefOut) ? CRC_Reflect<T>(crc, Width) : crc) ^ XorOut);
+    }
+
+    /*
+     *  Calculate CRC of data
+     *
+     *  @param * data       Pointer to data
+     *  @param len          Data len
+     *  @return             CRC value
+     */
+    static constexpr T Calc(const uint8_t *data, size_t len)
+    {
+        return Final(Update(Start(), data, len));
+    }
+
+  private:
+    static constexpr T Mask = (Width == 8 * sizeof(T)) ? (T)~(T)0 : (T)(((T)1 << Width) - 1);
+
+    static constexpr CRCLookup<T, Width, Poly, RefIn, Table> table{};
+
+    static constexpr T UpdateByte(T crc, uint8_t data)
+    {
+        if (Table == CRC_TABLE_NIBBLE)
+        {
+            if (RefIn)
+            {
+                crc = (T)((crc >> 4) ^ table.value[(crc ^ data) & 0x0Fu]);
+                crc = (T)((crc >> 4) ^ table.value[(crc ^ (data >> 4)) & 0x0Fu]);
+            }
+            else
+            {
+                crc = (T)(((crc << 4) ^ table.value[((crc >> (Width - 4)) ^ (data >> 4)) & 0x0Fu]) & Mask);
+                crc = (T)(((crc << 4) ^ table.value[((crc >> (Width - 4)) ^ data) & 0x0Fu]) & Mask);
+            }
+            return crc;
+        }
+
+        if (RefIn)
+        {
+            return (T)((crc >> 8) ^ table.value[(crc ^ data) & 0xFFu]);
+        }
+
+        return (T)(((crc << 8) ^ table.value[((crc >> (Width - 8)) ^ data) & 0xFFu]) & Mask);
+    }
+};
+
+template <typename T, unsigned Width, T Poly, T Init, bool RefIn, bool RefOut, T XorOut, CRCTable_T Table>
+constexpr CRCLookup<T, Width, Poly, RefIn, Table> CRCEngine<T, Width, Poly, Init, RefIn, RefOut, XorOut, Table>::table;
+
+#endif    // CRC_ENGINE_H_
@@ -25,13 +25,24 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "Arduino.h"
 
-#define ENABLE_CLIENT 0     /**< Enable Client support */
-#define ENABLE_LC 0         /**< Enable LC support */
-#define ENABLE_CTL 0        /**< Enable CTL support */
-#define ENABLE_PIRALS 0     /**< Enable PIR and ALS support */
-#define ENABLE_ENERGY 0     /**< Enable energy monitoring support */
-#define ENABLE_1_10_V 0     /**< Define for calculate lightness for 0-10 V (value 0) or 1-10 V (value 1) */
-#define ENABLE_EMG_L_TEST 0 /**< Enable Emergency Lighting Testing support */
+#define ENABLE_CLIENT 0          /**< Enable Client support */
+#define ENABLE_LC 0              /**< Enable LC support */
+#define ENABLE_CTL 0             /**< Enable CTL support */
+#define ENABLE_PIRALS 0          /**< Enable PIR and ALS support */
+#define ENABLE_ENERGY 0          /**< Enable energy monitoring support */
+#define ENABLE_1_10_V 0          /**< Define for calculate lightness for 0-10 V (value 0) or 1-10 V (value 1) */
+#define ENABLE_EMG_L_TEST 0      /**< Enable Emergency Lighting Testing support */
+/*
+ *  UART statistics take about 1.7 kB of RAM (UARTStats_T is 1716 B). Together with the 512 B UART RX and TX
+ *  buffers, the UART_TX_CONTROL_BACKLOG_LEN backlog and DFU_PAGE_BUFFERS page buffers of 1 kB, the largest
+ *  static buffers take about 5 kB of the 8 kB RAM, 4 kB with a single DFU page buffer.
+ */
+#ifndef ENABLE_UART_STATS
+#define ENABLE_UART_STATS 0      /**< Enable UART link statistics, takes about 1.7 kB of RAM for counters and histograms */
+#endif
+#ifndef ENABLE_UART_STATS_PING
+#define ENABLE_UART_STATS_PING 0 /**< Enable pings sent only to measure UART round trip time, requires ENABLE_UART_STATS */
+#endif
 
 #if ENABLE_CTL == 1 && ENABLE_LC == 1
 #error "Features CTL and LC cannot be enabled at the same time"
@@ -42,6 +53,22 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #define INSTANCE_INDEX_UNKNOWN UINT8_MAX /**< Defines unknown instance index value. */
 
+#define UART_RX_FRAMES_PER_LOOP 4       /**< Defines maximum number of UART frames dispatched in one loop pass. */
+#define UART_TX_CONTROL_RESERVE 160     /**< Defines TX buffer space telemetry frames must leave free for control frames. */
+#define UART_TX_DEFERRED_SLOTS 4        /**< Defines number of telemetry frames that can wait for TX buffer space. */
+#define UART_TX_DEFERRED_PAYLOAD_MAX 12 /**< Defines maximum payload length of deferred telemetry frame. */
+#define UART_TX_CONTROL_BACKLOG_LEN 256 /**< Defines size of buffer for control frames waiting for TX buffer space, power of two. */
+#define UART_STATS_PRINT_INTV 10000     /**< Defines UART statistics print interval in milliseconds. */
+#define UART_STATS_PING_INTV 1000       /**< Defines interval of pings measuring UART round trip time in milliseconds. */
+#define DFU_COMMIT_WORDS_PER_LOOP 16    /**< Defines number of DFU page words programmed to flash in one loop pass. */
+#ifndef DFU_PAGE_BUFFERS
+#define DFU_PAGE_BUFFERS 2              /**< Defines number of 1 kB DFU page buffers: 2 receives next page while previous one is committed, 1 saves 1 kB of RAM */
+#endif
+
+#if DFU_PAGE_BUFFERS != 1 && DFU_PAGE_BUFFERS != 2
+#error "DFU_PAGE_BUFFERS must be 1 or 2"
+#endif
+
 
 #ifdef CMAKE_UNIT_TEST
 
@@ -0,0 +1,165 @@
+/*
+Copyright © 2021 Silvair Sp. z o.o. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "DeltaPatcher.h"
+
+
+/**< Decoding steps */
+#define STATE_OPCODE 0
+#define STATE_COPY_ARGS 1
+#define STATE_INSERT_LEN 2
+#define STATE_COPY 3
+#define STATE_INSERT 4
+
+#define COPY_OFFSET_LEN 4 /**< Size of copy offset argument */
+#define COPY_ARGS_LEN 6   /**< Size of copy offset and len arguments */
+#define INSERT_ARGS_LEN 2 /**< Size of insert len argument */
+
+
+void DeltaPatcher_Init(DeltaPatcher_T *p_patcher, uint32_t base_size, uint32_t out_size, DeltaPatcher_Read_T read, DeltaPatcher_Write_T write)
+{
+    p_patcher->read      = read;
+    p_patcher->write     = write;
+    p_patcher->base_size = base_size;
+    p_patcher->out_size  = out_size;
+    p_patcher->out_len   = 0;
+    p_patcher->position  = 0;
+    p_patcher->arg       = 0;
+    p_patcher->count     = 0;
+    p_patcher->arg_len   = 0;
+    p_patcher->state     = STATE_OPCODE;
+}
+
+int DeltaPatcher_Process(DeltaPatcher_T *p_patcher, const uint8_t *p_data, size_t len, size_t max_out, size_t *p_used)
+{
+    size_t index   = 0;
+    size_t written = 0;
+    int    status  = DELTAPATCHER_SUCCESS;
+
+    while (status == DELTAPATCHER_SUCCESS)
+    {
+        if ((p_patcher->state == STATE_COPY) || (p_patcher->state == STATE_INSERT))
+        {
+            if (p_patcher->count == 0)
+            {
+                p_patcher->state = STATE_OPCODE;
+                continue;
+            }
+            if ((written == max_out) || ((p_patcher->state == STATE_INSERT) && (index == len)))
+            {
+                break;
+            }
+            if (p_patcher->out_len == p_patcher->out_size)
+            {
+                status = DELTAPATCHER_ERROR_OVERFLOW;
+                break;
+            }
+
+            uint8_t data = (p_patcher->state == STATE_COPY) ? p_patcher->read(p_patcher->position++) : p_data[index++];
+            if (!p_patcher->write(data))
+            {
+                status = DELTAPATCHER_ERROR_OUTPUT;
+                break;
+            }
+            p_patcher->out_len++;
+            p_patcher->count--;
+            written++;
+            continue;
+        }
+
+        if (index == len)
+        {
+            break;
+        }
+
+        uint8_t data = p_data[index++];
+
+        switch (p_patcher->state)
+        {
+            case STATE_OPCODE:
+                p_patcher->arg     = 0;
+                p_patcher->arg_len = 0;
+                p_patcher->count   = 0;
+                if (data == DELTAPATCHER_OP_COPY)
+                {
+                    p_patcher->state = STATE_COPY_ARGS;
+                }
+                else if (data == DELTAPATCHER_OP_INSERT)
+                {
+                    p_patcher->state = STATE_INSERT_LEN;
+                }
+                else
+                {
+                    status = DELTAPATCHER_ERROR_OPCODE;
+                }
+                break;
+
+            case STATE_COPY_ARGS:
+                if (p_patcher->arg_len < COPY_OFFSET_LEN)
+                {
+                    p_patcher->arg |= (uint32_t)data << (8 * p_patcher->arg_len);
+                }
+                else
+                {
+                    p_patcher->count |= (uint16_t)data << (8 * (p_patcher->arg_len - COPY_OFFSET_LEN));
+                }
+                if (++p_patcher->arg_len == COPY_ARGS_LEN)
+                {
+                    p_patcher->position = p_patcher->arg;
+                    if ((p_patcher->position > p_patcher->base_size) || (p_patcher->count > p_patcher->base_size - p_patcher->position))
+                    {
+                        status = DELTAPATCHER_ERROR_RANGE;
+                        break;
+                    }
+                    p_patcher->state = STATE_COPY;
+                }
+                break;
+
+            case STATE_INSERT_LEN:
+                p_patcher->arg |= (uint32_t)data << (8 * p_patcher->arg_len);
+                if (++p_patcher->arg_len == INSERT_ARGS_LEN)
+                {
+                    p_patcher->count = (uint16_t)p_patcher->arg;
+                    p_patcher->state = STATE_INSERT;
+                }
+                break;
+        }
+    }
+
+    *p_used = index;
+    return status;
+}
+
+bool DeltaPatcher_IsWaitingForInput(const DeltaPatcher_T *p_patcher)
+{
+    return (p_patcher->state != STATE_COPY) || (p_patcher->count == 0);
+}
+
+bool DeltaPatcher_IsDone(const DeltaPatcher_T *p_patcher)
+{
+    if ((p_patcher->state == STATE_COPY_ARGS) || (p_patcher->state == STATE_INSERT_LEN))
+    {
+        return false;
+    }
+
+    return (p_patcher->out_len == p_patcher->out_size) && (p_patcher->count == 0);
+}
@@ -0,0 +1,116 @@
+/*
+Copyright © 2021 Silvair Sp. z o.o. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#ifndef DELTAPATCHER_H
+#define DELTAPATCHER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**< Patch operations, each starts with opcode byte, arguments are little endian */
+#define DELTAPATCHER_OP_COPY 0x01   /**< u32 offset, u16 len: copy len bytes of base image from offset */
+#define DELTAPATCHER_OP_INSERT 0x02 /**< u16 len, len bytes: append bytes from patch */
+
+/**< Patcher return codes */
+#define DELTAPATCHER_SUCCESS 0
+#define DELTAPATCHER_ERROR_OPCODE 1   /**< Unknown operation */
+#define DELTAPATCHER_ERROR_RANGE 2    /**< Copy refers to data past base image end */
+#define DELTAPATCHER_ERROR_OVERFLOW 3 /**< Data does not fit declared output size */
+#define DELTAPATCHER_ERROR_OUTPUT 4   /**< Output write failed */
+
+/*
+ *  Read byte of base image
+ *
+ *  @param position     Base image position
+ *  @return             Byte value
+ */
+typedef uint8_t (*DeltaPatcher_Read_T)(uint32_t position);
+
+/*
+ *  Append byte to output
+ *
+ *  @param data         Byte value
+ *  @return             True on success
+ */
+typedef bool (*DeltaPatcher_Write_T)(uint8_t data);
+
+/*
+ *  Streaming applier of patches made of copy and insert operations. Input can
+ *  be split at any byte and output can be paused in the middle of an
+ *  operation. Base image is read through the read callback, so it does not
+ *  have to be kept in RAM.
+ */
+typedef struct DeltaPatcher_Tag
+{
+    DeltaPatcher_Read_T  read;
+    DeltaPatcher_Write_T write;
+    uint32_t             base_size; /**< Size of base image */
+    uint32_t             out_size;  /**< Declared size of patched data */
+    uint32_t             out_len;   /**< Number of patched bytes */
+    uint32_t             position;  /**< Next base image position to copy */
+    uint32_t             arg;       /**< Operation argument being received */
+    uint16_t             count;     /**< Remaining copy or insert bytes */
+    uint8_t              arg_len;   /**< Number of argument bytes received */
+    uint8_t              state;     /**< Decoding step */
+} DeltaPatcher_T;
+
+/*
+ *  Initialize patcher
+ *
+ *  @param p_patcher    Patcher instance
+ *  @param base_size    Size of base image
+ *  @param out_size     Size of patched data
+ *  @param read         Base image read callback
+ *  @param write        Output write callback
+ */
+void DeltaPatcher_Init(DeltaPatcher_T *p_patcher, uint32_t base_size, uint32_t out_size, DeltaPatcher_Read_T read, DeltaPatcher_Write_T write);
+
+/*
+ *  Apply patch data. Stops when all input is used or max_out bytes are written.
+ *
+ *  @param p_patcher    Patcher instance
+ *  @param p_data       Patch data
+ *  @param len          Patch data len
+ *  @param max_out      Maximum number of bytes to write
+ *  @param p_used       [out] Number of patch bytes used
+ *  @return             Patcher return code
+ */
+int DeltaPatcher_Process(DeltaPatcher_T *p_patcher, const uint8_t *p_data, size_t len, size_t max_out, size_t *p_used);
+
+/*
+ *  Check if patcher can not continue without more input, i.e. no copy is
+ *  waiting to be done
+ *
+ *  @param p_patcher    Patcher instance
+ *  @return             True if next output byte needs patch data
+ */
+bool DeltaPatcher_IsWaitingForInput(const DeltaPatcher_T *p_patcher);
+
+/*
+ *  Check if whole declared output was written
+ *
+ *  @param p_patcher    Patcher instance
+ *  @return             True if patching is complete
+ */
+bool DeltaPatcher_IsDone(const DeltaPatcher_T *p_patcher);
+
+#endif    // DELTAPATCHER_H
@@ -25,12 +25,15 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <kinetis.h>
 #include <stdint.h>
 
+#include "FlasherSectors.h"
+
 
 #define FLASH_END_ADDR 0x10000u                   /**< Pointer to end of flash. */
-#define FLASH_SECTOR_SIZE 0x400u                  /**< Flash sector size */
+#define FLASH_FIRMWARE_ADDR 0x0u                  /**< Pointer to beggining of running firmware */
+#define FLASH_SECTOR_SIZE FLASHER_SECTOR_SIZE     /**< Flash sector size */
 #define FLASH_EEPROM_SIZE (2 * FLASH_SECTOR_SIZE) /**< Size of space reserved for dummy eeprom */
-#define FLASH_CONFIG_FIELD_ADDR 0x40u             /**< Config field address */
-#define FLASH_CONFIG_FIELD_VAL 0xFFFFFFFEu        /**< Config field desirable value */
+#define FLASH_CONFIG_FIELD_ADDR (FLASH_FIRMWARE_ADDR + FLASHER_CONFIG_FIELD_OFFSET) /**< Config field address */
+#define FLASH_CONFIG_FIELD_VAL FLASHER_CONFIG_FIELD_VAL                            /**< Config field desirable value */
 #define FLASH_ERASED_WORD_VAL 0xFFFFFFFFu         /**< Erased word value */
 #define FLASH_WRITE_WORD_CMD 0x06                 /**< Flash write word command code */
 #define FLASH_ERASE_SECTOR_CMD 0x09               /**< Flash sector erase command code */
@@ -44,6 +47,8 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
         __asm volatile("dmb"); \
     } while (0)
 
+static_assert(FLASH_END_ADDR == FLASHER_SECTOR_COUNT * FLASH_SECTOR_SIZE, "Flash geometry mismatch");
+
 extern unsigned long _etext; /**< End of .text section label */
 extern unsigned long _sdata; /**< Start of .data section label */
 extern unsigned long _edata; /**< Ennd of .data section label */
@@ -69,29 +74,34 @@ RAMFUNC static int Flasher_FlashWordNotEeprom(uint32_t address, uint32_t word_va
  */
 RAMFUNC static int Flasher_SectorErase(uint32_t address, bool unsafe, bool reenable_irq);
 
-
 RAMFUNC int Flasher_UpdateFirmware(uint32_t num_of_words)
 {
     uint32_t src = Flasher_GetSpaceAddr();
-    uint32_t dst = 0;
+    uint32_t dst = FLASH_FIRMWARE_ADDR;
 
     __disable_irq();
 
-    for (uint32_t i = 0; i <= num_of_words; i++)
+    for (uint32_t i = 0; i <= num_of_words; i += FLASHER_SECTOR_WORDS)
     {
         uint32_t source      = src + i * 4;
         uint32_t destination = dst + i * 4;
+        uint32_t words       = Flasher_SectorWords(num_of_words, i);
+
+        if (!Flasher_IsSectorChanged(destination, source, words, FLASH_CONFIG_FIELD_ADDR))
+        {
+            continue;
+        }
 
-        if (destination % FLASH_SECTOR_SIZE == 0)
+        Flasher_SectorErase(destination, true, false);
+        if (destination + FLASH_SECTOR_SIZE > FLASH_CONFIG_FIELD_ADDR && destination <= FLASH_CONFIG_FIELD_ADDR)
         {
-            Flasher_SectorErase(destination, true, false);
-            if (destination + FLASH_SECTOR_SIZE > FLASH_CONFIG_FIELD_ADDR && destination <= FLASH_CONFIG_FIELD_ADDR)
-            {
-                Flasher_FlashWordNotEeprom(FLASH_CONFIG_FIELD_ADDR, FLASH_CONFIG_FIELD_VAL, false);
-            }
+            Flasher_FlashWordNotEeprom(FLASH_CONFIG_FIELD_ADDR, FLASH_CONFIG_FIELD_VAL, false);
         }
 
-        Flasher_FlashWordNotEeprom(destination, *(volatile uint32_t *)source, false);
+        for (uint32_t j = 0; j < words; j++)
+        {
+            Flasher_FlashWordNotEeprom(destination + j * 4, *(volatile uint32_t *)(source + j * 4), false);
+        }
     }
 
     *CPU_RESTART_ADDR = CPU_RESTART_VAL;
@@ -99,6 +109,11 @@ RAMFUNC int Flasher_UpdateFirmware(uint32_t num_of_words)
     return FLASHER_SUCCESS;
 }
 
+uint32_t Flasher_CountChangedSectors(uint32_t num_of_words)
+{
+    return Flasher_CountSectorsToRewrite(FLASH_FIRMWARE_ADDR, Flasher_GetSpaceAddr(), num_of_words);
+}
+
 RAMFUNC int Flasher_FlashWord(uint32_t address, uint32_t word_value, bool reenable_irq)
 {
     if ((uint32_t)address % sizeof(uint32_t) != 0)
@@ -169,6 +184,11 @@ uint32_t Flasher_GetSpaceAddr(void)
     return (FLASH_SECTOR_SIZE * ((first_free_addr / FLASH_SECTOR_SIZE) + 1));
 }
 
+uint32_t Flasher_GetFirmwareAddr(void)
+{
+    return FLASH_FIRMWARE_ADDR;
+}
+
 size_t Flasher_GetSpaceSize(void)
 {
     return FLASH_END_ADDR - Flasher_GetSpaceAddr() - FLASH_EEPROM_SIZE;
@@ -189,6 +209,16 @@ int Flasher_EraseSpace(void)
     return FLASHER_SUCCESS;
 }
 
+int Flasher_EraseSpaceSector(uint32_t address)
+{
+    if ((address < Flasher_GetSpaceAddr()) || (address >= Flasher_GetSpaceAddr() + Flasher_GetSpaceSize()))
+    {
+        return FLASHER_ERROR_RANGE;
+    }
+
+    return Flasher_SectorErase(address, false, true);
+}
+
 int Flasher_SaveMemoryToFlash(uint32_t address, const uint32_t *src, uint32_t num_of_words)
 {
     if (address % sizeof(uint32_t) != 0)
@@ -36,6 +36,10 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 /**< RAMFUNC attribute definition. Used to place function in RAM */
 #define RAMFUNC __attribute__((section(".fastrun"), noinline, noclone, optimize("Os")))
 
+/**< Flash geometry */
+#define FLASHER_SECTOR_SIZE 0x400u /**< Flash sector size */
+#define FLASHER_SECTOR_COUNT 64u   /**< Number of sectors in whole flash */
+
 /**< Flasher return codes*/
 #define FLASHER_SUCCESS 0
 #define FLASHER_ERROR_ALIGNMENT 1
@@ -51,6 +55,8 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 /*
  *  Copy stored firmware to the beggining of flash and reboots.
+ *  Sectors identical to the stored firmware are not erased nor programmed. Either way the last
+ *  sector is left erased past the image and flash config field holds its programmed value.
  *  If success will never return.
  *
  *  @param num_of_words    Size of firmware image.
@@ -58,6 +64,15 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 RAMFUNC int Flasher_UpdateFirmware(uint32_t num_of_words);
 
+/*
+ *  Count application sectors that differ from the staged firmware.
+ *  Flasher_UpdateFirmware rewrites only these sectors.
+ *
+ *  @param num_of_words    Size of firmware image.
+ *  @return                Number of sectors to rewrite.
+ */
+uint32_t Flasher_CountChangedSectors(uint32_t num_of_words);
+
 /*
  *  Save word to flash.
  *
@@ -75,6 +90,14 @@ RAMFUNC int Flasher_FlashWord(uint32_t address, uint32_t word_value, bool reenab
  */
 uint32_t Flasher_GetSpaceAddr(void);
 
+/*
+ *  Get pointer to beggining of running firmware.
+ *  Running firmware ends before storage space.
+ *
+ *  @return        running firmware address.
+ */
+uint32_t Flasher_GetFirmwareAddr(void);
+
 /*
  *  Get number of available bytes in storage space.
  *
@@ -89,9 +112,17 @@ size_t Flasher_GetSpaceSize(void);
  */
 int Flasher_EraseSpace(void);
 
+/*
+ *  Erase single sector of storage space.
+ *
+ *  @param address       Pointer to first byte in sector to be erased.
+ *  @return              Flasher return code
+ */
+int Flasher_EraseSpaceSector(uint32_t address);
+
 /*
  *  Saves words to flash.
- *  Destination should be already erased with Flasher_EraseSpace.
+ *  Destination should be already erased with Flasher_EraseSpace or Flasher_EraseSpaceSector.
  *
  *  @param address         Destination pointer
  *  @param src             Source pointer
@@ -0,0 +1,120 @@
+/*
+Copyright © 2021 Silvair Sp. z o.o. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+ *  Comparison of application sectors with staged firmware, kept apart from flash
+ *  controller access so that host tests run the same code. Flasher_UpdateFirmware
+ *  calls it while application sectors are rewritten, so it runs from RAM.
+ */
+
+#ifndef FLASHER_SECTORS_H_
+#define FLASHER_SECTORS_H_
+
+
+#include <stdint.h>
+
+#include "Flasher.h"
+
+
+#define FLASHER_SECTOR_WORDS (FLASHER_SECTOR_SIZE / sizeof(uint32_t)) /**< Number of words in flash sector */
+#define FLASHER_CONFIG_FIELD_OFFSET 0x40u                             /**< Config field offset from firmware start */
+#define FLASHER_CONFIG_FIELD_VAL 0xFFFFFFFEu                          /**< Config field value programmed by the updater */
+#define FLASHER_ERASED_WORD 0xFFFFFFFFu                               /**< Value of erased flash word */
+
+
+/*
+ *  Get number of words copied to sector. Word following the image is copied too,
+ *  it holds the tail of an image not aligned to words.
+ *
+ *  @param num_of_words  Size of firmware image
+ *  @param first_word    Index of first word in sector, not greater than num_of_words
+ *  @return              Number of words
+ */
+RAMFUNC static uint32_t Flasher_SectorWords(uint32_t num_of_words, uint32_t first_word)
+{
+    uint32_t words = num_of_words + 1 - first_word;
+
+    return (words > FLASHER_SECTOR_WORDS) ? FLASHER_SECTOR_WORDS : words;
+}
+
+/*
+ *  Check if sector content differs from what rewriting it would leave there: staged words,
+ *  erased words up to the sector end and FLASHER_CONFIG_FIELD_VAL in flash config field,
+ *  which the updater programs in place of the staged word. Running firmware then depends
+ *  only on the staged image, whichever sectors were skipped.
+ *
+ *  @param destination        Pointer to first byte in sector
+ *  @param source             Pointer to staged data
+ *  @param num_of_words       Number of staged words copied to sector
+ *  @param config_field_addr  Pointer to flash config field
+ *  @return                   True if sector has to be rewritten
+ */
+RAMFUNC static bool Flasher_IsSectorChanged(uint32_t destination, uint32_t source, uint32_t num_of_words, uint32_t config_field_addr)
+{
+    for (uint32_t i = 0; i < FLASHER_SECTOR_WORDS; i++)
+    {
+        uint32_t address  = destination + i * 4;
+        uint32_t expected = FLASHER_ERASED_WORD;
+
+        if (address == config_field_addr)
+        {
+            expected = FLASHER_CONFIG_FIELD_VAL;
+        }
+        else if (i < num_of_words)
+        {
+            expected = *(volatile uint32_t *)(uintptr_t)(source + i * 4);
+        }
+
+        if (*(volatile uint32_t *)(uintptr_t)address != expected)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+ *  Count application sectors that differ from the staged firmware.
+ *
+ *  @param firmware_addr  Pointer to running firmware
+ *  @param space_addr     Pointer to staged firmware
+ *  @param num_of_words   Size of firmware image
+ *  @return               Number of sectors to rewrite
+ */
+static inline uint32_t Flasher_CountSectorsToRewrite(uint32_t firmware_addr, uint32_t space_addr, uint32_t num_of_words)
+{
+    uint32_t count = 0;
+
+    for (uint32_t i = 0; i <= num_of_words; i += FLASHER_SECTOR_WORDS)
+    {
+        uint32_t words = Flasher_SectorWords(num_of_words, i);
+
+        if (Flasher_IsSectorChanged(firmware_addr + i * 4, space_addr + i * 4, words, firmware_addr + FLASHER_CONFIG_FIELD_OFFSET))
+        {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+#endif    // FLASHER_SECTORS_H_
@@ -0,0 +1,185 @@
+/*
+Copyright © 2021 Silvair Sp. z o.o. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "LZ4Decoder.h"
+
+
+/**< Decoding steps */
+#define STATE_TOKEN 0
+#define STATE_LITERAL_LEN 1
+#define STATE_LITERALS 2
+#define STATE_OFFSET_LOW 3
+#define STATE_OFFSET_HIGH 4
+#define STATE_MATCH_LEN 5
+#define STATE_MATCH 6
+
+#define LEN_EXTENDED 0x0F /**< Nibble value announcing extra length bytes */
+#define MIN_MATCH_LEN 4   /**< Match length encoded as 0 */
+
+
+void LZ4Decoder_Init(LZ4Decoder_T *p_decoder, uint32_t out_size, LZ4Decoder_Read_T read, LZ4Decoder_Write_T write)
+{
+    p_decoder->read     = read;
+    p_decoder->write    = write;
+    p_decoder->out_size = out_size;
+    p_decoder->out_len  = 0;
+    p_decoder->count    = 0;
+    p_decoder->offset   = 0;
+    p_decoder->token    = 0;
+    p_decoder->state    = STATE_TOKEN;
+}
+
+int LZ4Decoder_Process(LZ4Decoder_T *p_decoder, const uint8_t *p_data, size_t len, size_t max_out, size_t *p_used)
+{
+    size_t index   = 0;
+    size_t written = 0;
+    int    status  = LZ4DECODER_SUCCESS;
+
+    while (status == LZ4DECODER_SUCCESS)
+    {
+        if (p_decoder->state == STATE_MATCH)
+        {
+            if (written == max_out)
+            {
+                break;
+            }
+            if (p_decoder->out_len == p_decoder->out_size)
+            {
+                status = LZ4DECODER_ERROR_OVERFLOW;
+                break;
+            }
+
+            uint8_t data = p_decoder->read(p_decoder->out_len - p_decoder->offset);
+            if (!p_decoder->write(data))
+            {
+                status = LZ4DECODER_ERROR_OUTPUT;
+                break;
+            }
+            p_decoder->out_len++;
+            written++;
+
+            if (--p_decoder->count == 0)
+            {
+                p_decoder->state = STATE_TOKEN;
+            }
+            continue;
+        }
+
+        if (p_decoder->state == STATE_LITERALS)
+        {
+            if (p_decoder->count == 0)
+            {
+                // Block ends with literals, without match
+                p_decoder->state = (p_decoder->out_len == p_decoder->out_size) ? STATE_TOKEN : STATE_OFFSET_LOW;
+                continue;
+            }
+            if ((written == max_out) || (index == len))
+            {
+                break;
+            }
+            if (p_decoder->out_len == p_decoder->out_size)
+            {
+                status = LZ4DECODER_ERROR_OVERFLOW;
+                break;
+            }
+            if (!p_decoder->write(p_data[index++]))
+            {
+                status = LZ4DECODER_ERROR_OUTPUT;
+                break;
+            }
+            p_decoder->out_len++;
+            written++;
+            p_decoder->count--;
+            continue;
+        }
+
+        if (index == len)
+        {
+            break;
+        }
+
+        uint8_t data = p_data[index++];
+
+        switch (p_decoder->state)
+        {
+            case STATE_TOKEN:
+                if (p_decoder->out_len == p_decoder->out_size)
+                {
+                    status = LZ4DECODER_ERROR_OVERFLOW;
+                    break;
+                }
+                p_decoder->token = data;
+                p_decoder->count = data >> 4;
+                p_decoder->state = (p_decoder->count == LEN_EXTENDED) ? STATE_LITERAL_LEN : STATE_LITERALS;
+                break;
+
+            case STATE_LITERAL_LEN:
+                p_decoder->count += data;
+                if (data != 0xFF)
+                {
+                    p_decoder->state = STATE_LITERALS;
+                }
+                break;
+
+            case STATE_OFFSET_LOW:
+                p_decoder->offset = data;
+                p_decoder->state  = STATE_OFFSET_HIGH;
+                break;
+
+            case STATE_OFFSET_HIGH:
+                p_decoder->offset |= (uint16_t)data << 8;
+                if ((p_decoder->offset == 0) || (p_decoder->offset > p_decoder->out_len))
+                {
+                    status = LZ4DECODER_ERROR_OFFSET;
+                    break;
+                }
+                p_decoder->count = (p_decoder->token & LEN_EXTENDED) + MIN_MATCH_LEN;
+                p_decoder->state = ((p_decoder->token & LEN_EXTENDED) == LEN_EXTENDED) ? STATE_MATCH_LEN : STATE_MATCH;
+                break;
+
+            case STATE_MATCH_LEN:
+                p_decoder->count += data;
+                if (data != 0xFF)
+                {
+                    p_decoder->state = STATE_MATCH;
+                }
+                break;
+        }
+    }
+
+    *p_used = index;
+    return status;
+}
+
+bool LZ4Decoder_IsWaitingForInput(const LZ4Decoder_T *p_decoder)
+{
+    if (p_decoder->state == STATE_MATCH)
+    {
+        return false;
+    }
+
+    return (p_decoder->state != STATE_LITERALS) || (p_decoder->count != 0);
+}
+
+bool LZ4Decoder_IsDone(const LZ4Decoder_T *p_decoder)
+{
+    return (p_decoder->out_len == p_decoder->out_size) && (p_decoder->state == STATE_TOKEN);
+}
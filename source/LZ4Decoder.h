@@ -0,0 +1,106 @@
+/*
+Copyright © 2021 Silvair Sp. z o.o. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef LZ4DECODER_H
+#define LZ4DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**< Decoder return codes */
+#define LZ4DECODER_SUCCESS 0
+#define LZ4DECODER_ERROR_OFFSET 1   /**< Match refers to data before output start */
+#define LZ4DECODER_ERROR_OVERFLOW 2 /**< Data does not fit declared output size */
+#define LZ4DECODER_ERROR_OUTPUT 3   /**< Output write failed */
+
+/*
+ *  Read byte already written to output
+ *
+ *  @param position     Output position
+ *  @return             Byte value
+ */
+typedef uint8_t (*LZ4Decoder_Read_T)(uint32_t position);
+
+/*
+ *  Append byte to output
+ *
+ *  @param data         Byte value
+ *  @return             True on success
+ */
+typedef bool (*LZ4Decoder_Write_T)(uint8_t data);
+
+/*
+ *  Streaming decoder of LZ4 block format. Input can be split at any byte and
+ *  output can be paused in the middle of a sequence. Matches are copied from
+ *  output through the read callback, so no window is kept in RAM.
+ */
+typedef struct LZ4Decoder_Tag
+{
+    LZ4Decoder_Read_T  read;
+    LZ4Decoder_Write_T write;
+    uint32_t           out_size; /**< Declared size of decoded data */
+    uint32_t           out_len;  /**< Number of decoded bytes */
+    uint32_t           count;    /**< Remaining literal or match bytes */
+    uint16_t           offset;   /**< Match offset */
+    uint8_t            token;    /**< Current sequence token */
+    uint8_t            state;    /**< Decoding step */
+} LZ4Decoder_T;
+
+/*
+ *  Initialize decoder
+ *
+ *  @param p_decoder    Decoder instance
+ *  @param out_size     Size of decoded data
+ *  @param read         Output read callback
+ *  @param write        Output write callback
+ */
+void LZ4Decoder_Init(LZ4Decoder_T *p_decoder, uint32_t out_size, LZ4Decoder_Read_T read, LZ4Decoder_Write_T write);
+
+/*
+ *  Decode input data. Stops when all input is used or max_out bytes are written.
+ *
+ *  @param p_decoder    Decoder instance
+ *  @param p_data       Input data
+ *  @param len          Input data len
+ *  @param max_out      Maximum number of bytes to write
+ *  @param p_used       [out] Number of input bytes used
+ *  @return             Decoder return code
+ */
+int LZ4Decoder_Process(LZ4Decoder_T *p_decoder, const uint8_t *p_data, size_t len, size_t max_out, size_t *p_used);
+
+/*
+ *  Check if decoder can not continue without more input, i.e. no match is
+ *  waiting to be copied
+ *
+ *  @param p_decoder    Decoder instance
+ *  @return             True if next output byte needs input data
+ */
+bool LZ4Decoder_IsWaitingForInput(const LZ4Decoder_T *p_decoder);
+
+/*
+ *  Check if whole declared output was written
+ *
+ *  @param p_decoder    Decoder instance
+ *  @return             True if decoding is complete
+ */
+bool LZ4Decoder_IsDone(const LZ4Decoder_T *p_decoder);
+
+#endif    // LZ4DECODER_H
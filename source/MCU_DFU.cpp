@@ -22,10 +22,13 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "MCU_DFU.h"
 
+#include <stddef.h>
 #include <string.h>
 
 #include "CRC.h"
+#include "DeltaPatcher.h"
 #include "Flasher.h"
+#include "LZ4Decoder.h"
 #include "Log.h"
 #include "UARTProtocol.h"
 #include "Utils.h"
@@ -33,6 +36,7 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #define SHA256_SIZE 32u
 #define MAX_PAGE_SIZE 1024UL
+#define COMMIT_PAGE ((RxPage + 1) % DFU_PAGE_BUFFERS) /**< Index of page buffer being committed, same as RxPage with single buffer */
 
 #define DFU_INVALID_CODE 0x00
 #define DFU_SUCCESS 0x01
@@ -49,21 +53,85 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define DFU_STATUS_IN_PROGRESS 0x00
 #define DFU_STATUS_NOT_IN_PROGRESS 0x01
 
-/**< CRC configuration */
-#define CRC_POLYNOMIAL 0x8005u
-#define CRC_INIT_VAL 0xFFFFu
-
 /**< Defines string that forces update */
 #define DFU_VALIDATION_IGNORE_STRING "ignore"
 
+/**< Image formats, detected from the first bytes of transferred image */
+#define DFU_FORMAT_RAW 0x00        /**< Image is copied to storage space as is */
+#define DFU_FORMAT_COMPRESSED 0x01 /**< Header followed by LZ4 block, decompressed to storage space */
+#define DFU_FORMAT_DELTA 0x02      /**< Header followed by patch against running firmware, applied to storage space */
+
+#define DFU_COMPRESSED_MAGIC 0x315A4C53u /**< "SLZ1", starts compressed image header */
+#define DFU_DELTA_MAGIC 0x31504453u      /**< "SDP1", starts delta image header */
+
+/**< Progress records, kept in the last sector of storage space */
+#define DFU_PROGRESS_MAGIC 0x50554644u /**< "DFUP", written last to mark header or record as complete */
+
+#define DFU_ERASED_WORD 0xFFFFFFFFu /**< Value of word not written since sector erase */
 
-static uint8_t DfuInProgress             = 0;
-static size_t  FirmwareSize              = 0;
-static size_t  FirmwareOffset            = 0;
-static uint8_t Sha256[SHA256_SIZE]       = {0};
-static uint8_t PageBuffer[MAX_PAGE_SIZE] = {0};
-static size_t  PageOffset                = 0;
-static size_t  PageSize                  = 0;
+
+typedef struct
+{
+    uint32_t firmware_size;       /**< Size of transferred image */
+    uint8_t  sha256[SHA256_SIZE]; /**< Expected SHA256 of transferred image */
+    uint32_t magic;               /**< DFU_PROGRESS_MAGIC */
+} MCU_DFU_ProgressHeader_T;
+
+typedef struct
+{
+    uint32_t offset;          /**< Number of bytes stored in flash, multiple of FLASHER_SECTOR_SIZE */
+    uint32_t crc;             /**< CRC32 of stored bytes */
+    uint32_t sha256_state[8]; /**< SHA256 intermediate hash of stored bytes */
+    uint32_t magic;           /**< DFU_PROGRESS_MAGIC */
+} MCU_DFU_ProgressRecord_T;
+
+typedef struct
+{
+    uint32_t magic;      /**< DFU_COMPRESSED_MAGIC */
+    uint32_t image_size; /**< Size of decompressed image */
+    uint32_t image_crc;  /**< CRC32 of decompressed image */
+} MCU_DFU_CompressedHeader_T;
+
+typedef struct
+{
+    uint32_t magic;                    /**< DFU_DELTA_MAGIC */
+    uint32_t image_size;               /**< Size of patched image */
+    uint32_t image_crc;                /**< CRC32 of patched image */
+    uint32_t base_size;                /**< Size of running firmware the patch applies to */
+    uint8_t  base_sha256[SHA256_SIZE]; /**< SHA256 of running firmware, as returned by CalcSHA256 */
+} MCU_DFU_DeltaHeader_T;
+
+
+static uint8_t  DfuInProgress             = 0;
+static size_t   FirmwareSize              = 0;
+static size_t   FirmwareOffset            = 0;
+static uint32_t FirmwareCrc               = ~CRC32_INIT_VAL; /**< CRC32 of FirmwareOffset bytes stored in flash */
+static uint8_t  Sha256[SHA256_SIZE]       = {0};
+static size_t   PageOffset                = 0;
+static size_t   PageSize                  = 0;
+static bool     PageDataLost              = false;
+static bool     PageStoreQueued           = false;           /**< Received page waits until the previous one is committed */
+static uint8_t  RxPage                    = 0;               /**< Index of page buffer receiving data */
+static size_t   CommitSize                = 0;               /**< Size of page being committed to flash, 0 if none */
+static size_t   CommitOffset              = 0;               /**< Number of bytes of the page already committed */
+static Sha256_T ImageSha256; /**< Hash of pages stored so far */
+
+static __attribute__((aligned(4))) uint8_t PageBuffer[DFU_PAGE_BUFFERS][MAX_PAGE_SIZE] = {{0}}; /**< Page buffers, ping-pong if there are two */
+
+static uint32_t ErasedSectors[(FLASHER_SECTOR_COUNT + 31) / 32] = {0}; /**< Bitmap of erased storage space sectors */
+static size_t   ProgressRecordOffset                              = 0;   /**< Offset of next free record in progress sector */
+
+static uint8_t      ImageFormat = DFU_FORMAT_RAW;  /**< Format of transferred image */
+static size_t       ImageSize   = 0;               /**< Size of output image written to storage space */
+static uint32_t     ImageCrc    = 0;               /**< Expected CRC32 of output image */
+static size_t       OutputLen   = 0;               /**< Number of output image bytes, including OutputWord */
+static uint32_t     OutputWord  = DFU_ERASED_WORD; /**< Output image bytes waiting for a full word */
+static LZ4Decoder_T Decoder;                       /**< Decoder of compressed image */
+
+static DeltaPatcher_T Patcher;               /**< Applier of delta image */
+static Sha256_T       BaseSha256;            /**< Hash of running firmware, checked before patch is applied */
+static size_t         BaseHashLen   = 0;     /**< Number of running firmware bytes hashed so far */
+static bool           IsBaseChecked = false; /**< True if running firmware matches delta image header */
 
 
 /*
@@ -77,7 +145,149 @@ static uint8_t MCU_DFU_AppData_Validate(uint8_t *p_app_data, uint8_t app_data_le
 static void MCU_DFU_ClearStates(void);
 
 /*
- *  Calculate CRC of data saved in flash and ram
+ *  Start committing received page to flash from LoopDFU, switch reception to the other page buffer
+ */
+static void MCU_DFU_CommitStart(void);
+
+/*
+ *  Account committed page and send page store response
+ */
+static void MCU_DFU_CommitFinish(void);
+
+/*
+ *  Send failure response for committed page and queued one
+ *
+ *  @param status       DFU status code
+ */
+static void MCU_DFU_CommitFail(uint8_t status);
+
+/*
+ *  Go back to the last progress record after raw page commit failed, so sectors
+ *  of the failed page are erased again when it is retried
+ */
+static void MCU_DFU_CommitRollback(void);
+
+/*
+ *  Detect image format from the header at the start of the first page
+ *
+ *  @return             DFU status code
+ */
+static uint8_t MCU_DFU_DetectFormat(void);
+
+/*
+ *  Copy next part of the committed page to storage space
+ *
+ *  @return             DFU status code
+ */
+static uint8_t MCU_DFU_CommitRaw(void);
+
+/*
+ *  Decompress next part of the committed page to storage space
+ *
+ *  @return             DFU status code
+ */
+static uint8_t MCU_DFU_CommitCompressed(void);
+
+/*
+ *  Check running firmware against delta image header, then apply next part
+ *  of the committed page to storage space
+ *
+ *  @return             DFU status code
+ */
+static uint8_t MCU_DFU_CommitDelta(void);
+
+/*
+ *  Check if data starts with image header magic. Data shorter than magic
+ *  matches if it is the beginning of magic.
+ *
+ *  @param p_data       Pointer to data
+ *  @param len          Data len
+ *  @param magic        Image header magic
+ *  @return             True on match
+ */
+static bool MCU_DFU_IsMagic(const uint8_t *p_data, size_t len, uint32_t magic);
+
+/*
+ *  Read byte of running firmware
+ *
+ *  @param position     Position in running firmware
+ *  @return             Byte value
+ */
+static uint8_t MCU_DFU_BaseRead(uint32_t position);
+
+/*
+ *  Check decompressed or patched image in storage space
+ *
+ *  @return             True if image is complete and matches CRC from header
+ */
+static bool MCU_DFU_IsOutputValid(void);
+
+/*
+ *  Append byte to output image, full words are programmed to flash
+ *
+ *  @param data         Byte value
+ *  @return             True on success
+ */
+static bool MCU_DFU_OutputWrite(uint8_t data);
+
+/*
+ *  Read byte of decompressed image
+ *
+ *  @param position     Position in image
+ *  @return             Byte value
+ */
+static uint8_t MCU_DFU_OutputRead(uint32_t position);
+
+/*
+ *  Program word holding last output image bytes to flash. Its sector is erased
+ *  first even if the word has the erased value, so no stale data is left there.
+ *
+ *  @return             True on success
+ */
+static bool MCU_DFU_OutputFlush(void);
+
+/*
+ *  Erase storage space sectors overlapping given range, which are not erased yet
+ *
+ *  @param offset       Range offset from storage space start
+ *  @param len          Range len
+ *  @return             Flasher return code
+ */
+static int MCU_DFU_EraseRange(size_t offset, size_t len);
+
+/*
+ *  Get address of the sector holding progress records
+ *
+ *  @return             Progress sector address
+ */
+static uint32_t MCU_DFU_ProgressAddr(void);
+
+/*
+ *  Erase progress sector and write header of current image
+ *
+ *  @return             Flasher return code
+ */
+static int MCU_DFU_ProgressStart(void);
+
+/*
+ *  Append progress record of stored bytes, start new progress sector when full
+ */
+static void MCU_DFU_ProgressAppend(void);
+
+/*
+ *  Erase progress records, so the transfer cannot be resumed
+ */
+static void MCU_DFU_ProgressClear(void);
+
+/*
+ *  Restore state from progress records, if they were written for current image
+ *
+ *  @return             True if state was restored
+ */
+static bool MCU_DFU_ProgressResume(void);
+
+/*
+ *  Calculate CRC of data saved in flash and page buffers, CRC of flash data is kept in FirmwareCrc
  */
 static uint32_t MCU_DFU_CalcCRC(void);
 
@@ -95,6 +305,54 @@ bool MCU_DFU_IsInProgress(void)
     return (bool)DfuInProgress;
 }
 
+void LoopDFU(void)
+{
+    if (CommitSize == 0)
+    {
+        return;
+    }
+
+    uint8_t status = DFU_SUCCESS;
+    if ((FirmwareOffset == 0) && (CommitOffset == 0))
+    {
+        status = MCU_DFU_DetectFormat();
+    }
+
+    // Compressed or delta page is done when no pending match or copy is left
+    bool is_page_done = false;
+    if (status == DFU_SUCCESS)
+    {
+        switch (ImageFormat)
+        {
+            case DFU_FORMAT_RAW:
+                status       = MCU_DFU_CommitRaw();
+                is_page_done = (CommitOffset == CommitSize);
+                break;
+
+            case DFU_FORMAT_COMPRESSED:
+                status       = MCU_DFU_CommitCompressed();
+                is_page_done = (CommitOffset == CommitSize) && LZ4Decoder_IsWaitingForInput(&Decoder);
+                break;
+
+            case DFU_FORMAT_DELTA:
+                status       = MCU_DFU_CommitDelta();
+                is_page_done = (CommitOffset == CommitSize) && IsBaseChecked && DeltaPatcher_IsWaitingForInput(&Patcher);
+                break;
+        }
+    }
+
+    if (status != DFU_SUCCESS)
+    {
+        MCU_DFU_CommitFail(status);
+        return;
+    }
+
+    if (is_page_done)
+    {
+        MCU_DFU_CommitFinish();
+    }
+}
+
 void ProcessDfuInitRequest(uint8_t *p_payload, uint8_t len)
 {
     MCU_DFU_ClearStates();
@@ -105,6 +363,7 @@ void ProcessDfuInitRequest(uint8_t *p_payload, uint8_t len)
     FirmwareSize |= ((uint32_t)p_payload[index++] << 8);
     FirmwareSize |= ((uint32_t)p_payload[index++] << 16);
     FirmwareSize |= ((uint32_t)p_payload[index++] << 24);
+    ImageSize = FirmwareSize;
 
     for (size_t i = 0; i < SHA256_SIZE; i++)
     {
@@ -114,6 +373,18 @@ void ProcessDfuInitRequest(uint8_t *p_payload, uint8_t len)
     uint8_t  app_data_len = p_payload[index++];
     uint8_t *p_app_data   = p_payload + index;
 
+    if (index + app_data_len > len)
+    {
+        uint8_t response[] = {DFU_INVALID_PARAMETER};
+        UART_SendDfuInitResponse(response, sizeof(response));
+
+        MCU_DFU_ClearStates();
+
+        LOG_INFO("DFU Rejected, application data length exceeds payload");
+
+        return;
+    }
+
     uint8_t init_status = MCU_DFU_AppData_Validate(p_app_data, app_data_len);
     if (init_status != DFU_SUCCESS)
     {
@@ -126,10 +397,21 @@ void ProcessDfuInitRequest(uint8_t *p_payload, uint8_t len)
         return;
     }
 
-    size_t available = Flasher_GetSpaceSize();
+    // Last sector of storage space keeps progress records
+    size_t available = Flasher_GetSpaceSize() - FLASHER_SECTOR_SIZE;
     if (available > FirmwareSize)
     {
-        Flasher_EraseSpace();
+        // Storage space is erased sector by sector as pages are stored
+        Sha256_Init(&ImageSha256);
+
+        if (MCU_DFU_ProgressResume())
+        {
+            LOG_INFO("DFU Resumed at: %d", FirmwareOffset);
+        }
+        else if (MCU_DFU_ProgressStart() != FLASHER_SUCCESS)
+        {
+            LOG_INFO("DFU Progress records not available");
+        }
 
         uint8_t init_status[] = {DFU_SUCCESS};
         UART_SendDfuInitResponse(init_status, sizeof(init_status));
@@ -152,7 +434,7 @@ void ProcessDfuInitRequest(uint8_t *p_payload, uint8_t len)
 
 void ProcessDfuStatusRequest(uint8_t *p_payload, uint8_t len)
 {
-    uint32_t offset = FirmwareOffset + PageOffset;
+    uint32_t offset = FirmwareOffset + CommitSize + PageOffset;
     uint32_t crc    = MCU_DFU_CalcCRC();
 
     uint8_t response[] = {
@@ -200,10 +482,20 @@ void ProcessDfuPageCreateRequest(uint8_t *p_payload, uint8_t len)
     req_page_size |= ((uint32_t)p_payload[index++] << 16);
     req_page_size |= ((uint32_t)p_payload[index++] << 24);
 
+    // Single page buffer is busy until its page is committed
+    if (PageStoreQueued || ((DFU_PAGE_BUFFERS == 1) && (CommitSize != 0)))
+    {
+        uint8_t response[] = {DFU_INSUFFICIENT_RESOURCES};
+        UART_SendDfuPageCreateResponse(response, sizeof(response));
+        LOG_INFO("DFU Page buffers busy");
+        return;
+    }
+
     if (req_page_size <= MAX_PAGE_SIZE)
     {
-        PageOffset = 0;
-        PageSize   = req_page_size;
+        PageOffset   = 0;
+        PageSize     = req_page_size;
+        PageDataLost = false;
 
         uint8_t response[] = {DFU_SUCCESS};
         UART_SendDfuPageCreateResponse(response, sizeof(response));
@@ -232,9 +524,17 @@ void ProcessDfuWriteDataEvent(uint8_t *p_payload, uint8_t len)
     uint8_t  image_len = p_payload[index++];
     uint8_t *p_image   = p_payload + index;
 
+    if (index + image_len > len)
+    {
+        // Page cannot be completed without this data, so it is rejected on store as after lost bytes
+        PageDataLost = true;
+        LOG_INFO("DFU Write data, image length exceeds payload");
+        return;
+    }
+
     if (PageOffset + image_len <= PageSize)
     {
-        memcpy(PageBuffer + PageOffset, p_image, image_len);
+        memcpy(PageBuffer[RxPage] + PageOffset, p_image, image_len);
         PageOffset += image_len;
     }
 }
@@ -250,6 +550,18 @@ void ProcessDfuPageStoreRequest(uint8_t *p_payload, uint8_t len)
         return;
     }
 
+    if (PageDataLost)
+    {
+        PageOffset   = 0;
+        PageDataLost = false;
+
+        uint8_t response[] = {DFU_OPERATION_FAILED};
+        UART_SendDfuPageStoreResponse(response, sizeof(response));
+
+        LOG_INFO("DFU Page not stored, data lost");
+        return;
+    }
+
     if (PageOffset == 0)
     {
         uint8_t response[] = {DFU_SUCCESS};
@@ -267,41 +579,196 @@ void ProcessDfuPageStoreRequest(uint8_t *p_payload, uint8_t len)
         return;
     }
 
-    uint32_t page_store_address = Flasher_GetSpaceAddr() + FirmwareOffset;
-    uint8_t  ret_val            = Flasher_SaveMemoryToFlash(page_store_address, (uint32_t *)PageBuffer, PageSize / 4);
-    if (ret_val != FLASHER_SUCCESS)
+    if (CommitSize != 0)
     {
-        uint8_t response[] = {DFU_OPERATION_FAILED};
-        UART_SendDfuPageStoreResponse(response, sizeof(response));
-
-        LOG_INFO("DFU Page not stored, flasher fail");
+        // Response is sent when the previous page is committed and this one too
+        PageStoreQueued = true;
+        LOG_INFO("DFU Page store queued");
         return;
     }
 
-    FirmwareOffset += PageOffset;
-    PageOffset = 0;
-    PageSize   = 0;
+    MCU_DFU_CommitStart();
+}
+
+void ProcessDfuRxDataLoss(void)
+{
+    if (DfuInProgress)
+    {
+        PageDataLost = true;
+        LOG_INFO("DFU Page data lost");
+    }
+}
+
+void ProcessDfuStateCheckResponse(uint8_t *p_payload, uint8_t len)
+{
+    size_t  index  = 0;
+    uint8_t status = p_payload[index++];
+
+    if ((status == DFU_STATUS_IN_PROGRESS) != (DfuInProgress))
+    {
+        UART_SendDfuCancelRequest(NULL, 0);
+        LOG_INFO("DFU Canceling");
+    }
+}
+
+void ProcessDfuCancelResponse(uint8_t *p_payload, uint8_t len)
+{
+    MCU_DFU_ProgressClear();
+    MCU_DFU_ClearStates();
+    LOG_INFO("DFU Cancelled");
+}
+
+static uint8_t MCU_DFU_AppData_Validate(uint8_t *p_app_data, uint8_t app_data_len)
+{
+    LOG_INFO("Application Data length: %d", app_data_len);
+    LOG_INFO_HEXBUF("Application Data:", p_app_data, app_data_len);
+
+    if (app_data_len == strlen(DFU_VALIDATION_IGNORE_STRING) && memcmp(p_app_data, DFU_VALIDATION_IGNORE_STRING, app_data_len) == 0)
+    {
+        /* Application Data contains special string that always validates the package */
+        return DFU_SUCCESS;
+    }
+
+    /* Valid Application Data is in format: DFU_VALIDATION_STRING/BUILD_NUMBER */
+    uint8_t *delimiter = (uint8_t *)memchr(p_app_data, '/', app_data_len);
+    if (delimiter == NULL)
+    {
+        /* Application Data does not contain delimiter */
+        return DFU_INVALID_OBJECT;
+    }
+    uint8_t *fw_type      = p_app_data;
+    uint8_t  fw_type_len  = delimiter - p_app_data;
+    uint8_t *fw_build     = &p_app_data[fw_type_len + 1];
+    uint8_t  fw_build_len = app_data_len - fw_type_len - 1;
+
+    if (strncmp((char *)fw_type, DFU_VALIDATION_STRING, fw_type_len) || (fw_type_len != strlen(DFU_VALIDATION_STRING)))
+    {
+        /* DFU package contains different type of firmware */
+        return DFU_INVALID_OBJECT;
+    }
+
+    if (!strncmp((char *)fw_build, BUILD_NUMBER, fw_build_len) && (fw_build_len == strlen(BUILD_NUMBER)))
+    {
+        /* Application Data contains the same firmware that exists on the device */
+        return DFU_FIRMWARE_ALREADY_UP_TO_DATE;
+    }
+
+    return DFU_SUCCESS;
+}
+
+
+static void MCU_DFU_ClearStates(void)
+{
+    DfuInProgress   = 0;
+    FirmwareSize    = 0;
+    FirmwareOffset  = 0;
+    FirmwareCrc     = ~CRC32_INIT_VAL;
+    PageOffset      = 0;
+    PageSize        = 0;
+    PageDataLost    = false;
+    PageStoreQueued = false;
+    ImageFormat     = DFU_FORMAT_RAW;
+    ImageSize       = 0;
+    ImageCrc        = 0;
+    OutputLen       = 0;
+    OutputWord      = DFU_ERASED_WORD;
+    BaseHashLen     = 0;
+    IsBaseChecked   = false;
+    RxPage          = 0;
+    CommitSize      = 0;
+    CommitOffset    = 0;
+
+    memset(Sha256, 0, SHA256_SIZE);
+    Sha256_Init(&ImageSha256);
+    memset(ErasedSectors, 0, sizeof(ErasedSectors));
+    memset(PageBuffer, 0, sizeof(PageBuffer));
+}
+
+static uint32_t MCU_DFU_CalcCRC(void)
+{
+    uint32_t crc = FirmwareCrc;
+    if (CommitSize != 0)
+    {
+        crc = CalcCRC32(PageBuffer[COMMIT_PAGE], CommitSize, ~crc);
+    }
+    if (PageOffset != 0)
+    {
+        crc = CalcCRC32(PageBuffer[RxPage], PageOffset, ~crc);
+    }
+    return crc;
+}
+
+static void MCU_DFU_CommitStart(void)
+{
+    CommitSize   = PageSize;
+    CommitOffset = 0;
+    RxPage       = COMMIT_PAGE;
+    PageOffset   = 0;
+    PageSize     = 0;
+}
+
+static void MCU_DFU_CommitFinish(void)
+{
+    // Raw page is hashed as read back from flash, so the final check covers what was really programmed.
+    // Page is split at sector boundaries, where progress records are written.
+    for (size_t page_pos = 0; page_pos < CommitSize;)
+    {
+        uint8_t *p_data = (uint8_t *)((uintptr_t)(Flasher_GetSpaceAddr() + FirmwareOffset));
+        size_t   len    = FLASHER_SECTOR_SIZE - (FirmwareOffset % FLASHER_SECTOR_SIZE);
+        if (len > CommitSize - page_pos)
+        {
+            len = CommitSize - page_pos;
+        }
+        if (ImageFormat != DFU_FORMAT_RAW)
+        {
+            p_data = PageBuffer[COMMIT_PAGE] + page_pos;
+        }
+
+        Sha256_Update(&ImageSha256, p_data, len);
+        FirmwareCrc = CalcCRC32(p_data, len, ~FirmwareCrc);
+
+        FirmwareOffset += len;
+        page_pos += len;
+
+        // Decoder state is not recorded, so compressed and delta transfers always start from the beginning
+        if ((ImageFormat == DFU_FORMAT_RAW) && (FirmwareOffset % FLASHER_SECTOR_SIZE == 0) && (FirmwareOffset != FirmwareSize))
+        {
+            MCU_DFU_ProgressAppend();
+        }
+    }
+    CommitSize = 0;
 
     if (FirmwareOffset != FirmwareSize)
     {
         uint8_t response[] = {DFU_SUCCESS};
         UART_SendDfuPageStoreResponse(response, sizeof(response));
 
-        uint32_t crc = CalcCRC32((uint8_t *)((uintptr_t)Flasher_GetSpaceAddr()), FirmwareOffset, CRC_INIT_VAL);
-        LOG_INFO("DFU Page store success, CRC %08X", crc);
+        LOG_INFO("DFU Page store success, CRC %08X", FirmwareCrc);
+
+        if (PageStoreQueued)
+        {
+            PageStoreQueued = false;
+            MCU_DFU_CommitStart();
+        }
         return;
     }
 
     uint8_t calculated_sha256[SHA256_SIZE];
-    CalcSHA256((uint8_t *)((uintptr_t)Flasher_GetSpaceAddr()), FirmwareOffset, calculated_sha256);
+    Sha256_Final(&ImageSha256, calculated_sha256);
     bool is_object_valid = (0 == memcmp(calculated_sha256, Sha256, SHA256_SIZE));
 
+    if (is_object_valid && (ImageFormat != DFU_FORMAT_RAW))
+    {
+        is_object_valid = MCU_DFU_IsOutputValid();
+    }
+
     if (!is_object_valid)
     {
         uint8_t response[] = {DFU_INVALID_OBJECT};
         UART_SendDfuPageStoreResponse(response, sizeof(response));
 
         LOG_INFO("DFU Invalid object");
+        MCU_DFU_ProgressClear();
         MCU_DFU_ClearStates();
         return;
     }
@@ -309,11 +776,16 @@ void ProcessDfuPageStoreRequest(uint8_t *p_payload, uint8_t len)
     uint8_t response[] = {DFU_FIRMWARE_SUCCESSFULLY_UPDATED};
     UART_SendDfuPageStoreResponse(response, sizeof(response));
 
-    LOG_INFO("DFU Firmware updated");
-    DEBUG_INTERFACE.flush();
+    size_t FwSizeWords = ImageSize / sizeof(uint32_t);
+
+    // Flasher_UpdateFirmware copies one word past the image, make sure it is not stale data
+    MCU_DFU_EraseRange(FwSizeWords * sizeof(uint32_t), sizeof(uint32_t));
 
-    size_t FwSizeWords = FirmwareSize / sizeof(uint32_t);
+    uint32_t changed_sectors = Flasher_CountChangedSectors(FwSizeWords);
+    LOG_INFO("DFU Firmware updated, sectors to rewrite: %d", changed_sectors);
+    DEBUG_INTERFACE.flush();
 
+    MCU_DFU_ProgressClear();
     MCU_DFU_ClearStates();
     Flasher_UpdateFirmware(FwSizeWords);
 
@@ -327,85 +799,435 @@ void ProcessDfuPageStoreRequest(uint8_t *p_payload, uint8_t len)
     }
 }
 
-void ProcessDfuStateCheckResponse(uint8_t *p_payload, uint8_t len)
+
+static void MCU_DFU_CommitFail(uint8_t status)
 {
-    size_t  index  = 0;
-    uint8_t status = p_payload[index++];
+    uint8_t response[] = {status};
+    UART_SendDfuPageStoreResponse(response, sizeof(response));
+    CommitSize = 0;
 
-    if ((status == DFU_STATUS_IN_PROGRESS) != (DfuInProgress))
+    if (PageStoreQueued)
     {
-        UART_SendDfuCancelRequest(NULL, 0);
-        LOG_INFO("DFU Canceling");
+        // Queued page was meant to follow the failed one
+        UART_SendDfuPageStoreResponse(response, sizeof(response));
+        PageStoreQueued = false;
+        PageOffset      = 0;
     }
+
+    LOG_INFO("DFU Page not stored, status %02X", status);
+
+    if (ImageFormat != DFU_FORMAT_RAW)
+    {
+        // Decoder state cannot be rolled back to retry the page
+        MCU_DFU_ProgressClear();
+        MCU_DFU_ClearStates();
+        return;
+    }
+
+    MCU_DFU_CommitRollback();
 }
 
-void ProcessDfuCancelResponse(uint8_t *p_payload, uint8_t len)
+static void MCU_DFU_CommitRollback(void)
 {
-    MCU_DFU_ClearStates();
-    LOG_INFO("DFU Cancelled");
+    // Failed page may have left programmed words, which cannot be programmed again without erase. Bytes stored
+    // before the page in its first sector are erased with them, so transfer continues from the last progress record.
+    FirmwareOffset = 0;
+    FirmwareCrc    = ~CRC32_INIT_VAL;
+    Sha256_Init(&ImageSha256);
+    memset(ErasedSectors, 0, sizeof(ErasedSectors));
+
+    MCU_DFU_ProgressResume();
+
+    LOG_INFO("DFU Rolled back to: %d", FirmwareOffset);
 }
 
-static uint8_t MCU_DFU_AppData_Validate(uint8_t *p_app_data, uint8_t app_data_len)
+static uint8_t MCU_DFU_DetectFormat(void)
 {
-    LOG_INFO("Application Data length: %d", app_data_len);
-    LOG_INFO_HEXBUF("Application Data:", p_app_data, app_data_len);
+    const uint8_t *p_page = PageBuffer[COMMIT_PAGE];
+    size_t         header_size;
 
-    if (app_data_len == strlen(DFU_VALIDATION_IGNORE_STRING) && memcmp(p_app_data, DFU_VALIDATION_IGNORE_STRING, app_data_len) == 0)
+    ImageFormat = DFU_FORMAT_RAW;
+    ImageSize   = FirmwareSize;
+
+    // Raw image starts with initial stack pointer, which is word aligned and never matches the magic
+    if (MCU_DFU_IsMagic(p_page, CommitSize, DFU_COMPRESSED_MAGIC))
+    {
+        header_size = sizeof(MCU_DFU_CompressedHeader_T);
+    }
+    else if (MCU_DFU_IsMagic(p_page, CommitSize, DFU_DELTA_MAGIC))
+    {
+        header_size = sizeof(MCU_DFU_DeltaHeader_T);
+    }
+    else
     {
-        /* Application Data contains special string that always validates the package */
         return DFU_SUCCESS;
     }
 
-    /* Valid Application Data is in format: DFU_VALIDATION_STRING/BUILD_NUMBER */
-    uint8_t *delimiter = (uint8_t *)memchr(p_app_data, '/', app_data_len);
-    if (delimiter == NULL)
+    if (CommitSize < header_size)
     {
-        /* Application Data does not contain delimiter */
+        LOG_INFO("DFU Image header does not fit the first page");
         return DFU_INVALID_OBJECT;
     }
-    uint8_t *fw_type      = p_app_data;
-    uint8_t  fw_type_len  = delimiter - p_app_data;
-    uint8_t *fw_build     = &p_app_data[fw_type_len + 1];
-    uint8_t  fw_build_len = app_data_len - fw_type_len - 1;
 
-    if (strncmp((char *)fw_type, DFU_VALIDATION_STRING, fw_type_len) || (fw_type_len != strlen(DFU_VALIDATION_STRING)))
+    // Compressed and delta headers start with the same fields
+    const MCU_DFU_CompressedHeader_T *p_header = (const MCU_DFU_CompressedHeader_T *)p_page;
+
+    ImageFormat = (p_header->magic == DFU_COMPRESSED_MAGIC) ? DFU_FORMAT_COMPRESSED : DFU_FORMAT_DELTA;
+    ImageSize   = p_header->image_size;
+    ImageCrc    = p_header->image_crc;
+
+    LOG_INFO("DFU Image format: %d, size: %d", ImageFormat, ImageSize);
+
+    if (ImageSize >= Flasher_GetSpaceSize() - FLASHER_SECTOR_SIZE)
     {
-        /* DFU package contains different type of firmware */
+        return DFU_INSUFFICIENT_RESOURCES;
+    }
+
+    OutputLen    = 0;
+    OutputWord   = DFU_ERASED_WORD;
+    CommitOffset = header_size;
+
+    if (ImageFormat == DFU_FORMAT_COMPRESSED)
+    {
+        LZ4Decoder_Init(&Decoder, ImageSize, MCU_DFU_OutputRead, MCU_DFU_OutputWrite);
+        return DFU_SUCCESS;
+    }
+
+    const MCU_DFU_DeltaHeader_T *p_delta = (const MCU_DFU_DeltaHeader_T *)p_page;
+    if (p_delta->base_size > Flasher_GetSpaceAddr() - Flasher_GetFirmwareAddr())
+    {
+        LOG_INFO("DFU Delta base size exceeds running firmware");
         return DFU_INVALID_OBJECT;
     }
 
-    if (!strncmp((char *)fw_build, BUILD_NUMBER, fw_build_len) && (fw_build_len == strlen(BUILD_NUMBER)))
+    Sha256_Init(&BaseSha256);
+    BaseHashLen   = 0;
+    IsBaseChecked = false;
+    DeltaPatcher_Init(&Patcher, p_delta->base_size, ImageSize, MCU_DFU_BaseRead, MCU_DFU_OutputWrite);
+
+    return DFU_SUCCESS;
+}
+
+static uint8_t MCU_DFU_CommitRaw(void)
+{
+    size_t len = CommitSize - CommitOffset;
+    if (len > DFU_COMMIT_WORDS_PER_LOOP * sizeof(uint32_t))
     {
-        /* Application Data contains the same firmware that exists on the device */
-        return DFU_FIRMWARE_ALREADY_UP_TO_DATE;
+        len = DFU_COMMIT_WORDS_PER_LOOP * sizeof(uint32_t);
     }
 
+    size_t offset  = FirmwareOffset + CommitOffset;
+    int    ret_val = MCU_DFU_EraseRange(offset, len);
+    if (ret_val == FLASHER_SUCCESS)
+    {
+        ret_val = Flasher_SaveMemoryToFlash(Flasher_GetSpaceAddr() + offset, (uint32_t *)(PageBuffer[COMMIT_PAGE] + CommitOffset), len / 4);
+    }
+    if (ret_val != FLASHER_SUCCESS)
+    {
+        return DFU_OPERATION_FAILED;
+    }
+
+    CommitOffset += len;
     return DFU_SUCCESS;
 }
 
+static uint8_t MCU_DFU_CommitCompressed(void)
+{
+    size_t used    = 0;
+    int    ret_val = LZ4Decoder_Process(&Decoder, PageBuffer[COMMIT_PAGE] + CommitOffset, CommitSize - CommitOffset, DFU_COMMIT_WORDS_PER_LOOP * sizeof(uint32_t), &used);
+
+    CommitOffset += used;
 
-static void MCU_DFU_ClearStates(void)
+    if (ret_val == LZ4DECODER_ERROR_OUTPUT)
+    {
+        return DFU_OPERATION_FAILED;
+    }
+    if (ret_val != LZ4DECODER_SUCCESS)
+    {
+        return DFU_INVALID_OBJECT;
+    }
+
+    return DFU_SUCCESS;
+}
+
+static uint8_t MCU_DFU_CommitDelta(void)
 {
-    DfuInProgress  = 0;
-    FirmwareSize   = 0;
-    FirmwareOffset = 0;
-    PageOffset     = 0;
-    PageSize       = 0;
+    if (!IsBaseChecked)
+    {
+        // Running firmware is hashed in steps too, header stays in the page buffer until the page is done
+        const MCU_DFU_DeltaHeader_T *p_delta = (const MCU_DFU_DeltaHeader_T *)PageBuffer[COMMIT_PAGE];
+
+        size_t len = p_delta->base_size - BaseHashLen;
+        if (len > DFU_COMMIT_WORDS_PER_LOOP * sizeof(uint32_t))
+        {
+            len = DFU_COMMIT_WORDS_PER_LOOP * sizeof(uint32_t);
+        }
+
+        Sha256_Update(&BaseSha256, (uint8_t *)((uintptr_t)(Flasher_GetFirmwareAddr() + BaseHashLen)), len);
+        BaseHashLen += len;
+
+        if (BaseHashLen == p_delta->base_size)
+        {
+            uint8_t base_sha256[SHA256_SIZE];
+            Sha256_Final(&BaseSha256, base_sha256);
+
+            if (0 != memcmp(base_sha256, p_delta->base_sha256, SHA256_SIZE))
+            {
+                LOG_INFO("DFU Delta base does not match running firmware");
+                return DFU_INVALID_OBJECT;
+            }
+            IsBaseChecked = true;
+        }
+        return DFU_SUCCESS;
+    }
 
-    memset(Sha256, 0, SHA256_SIZE);
-    memset(PageBuffer, 0, MAX_PAGE_SIZE);
+    size_t used    = 0;
+    int    ret_val = DeltaPatcher_Process(&Patcher, PageBuffer[COMMIT_PAGE] + CommitOffset, CommitSize - CommitOffset, DFU_COMMIT_WORDS_PER_LOOP * sizeof(uint32_t), &used);
+
+    CommitOffset += used;
+
+    if (ret_val == DELTAPATCHER_ERROR_OUTPUT)
+    {
+        return DFU_OPERATION_FAILED;
+    }
+    if (ret_val != DELTAPATCHER_SUCCESS)
+    {
+        return DFU_INVALID_OBJECT;
+    }
+
+    return DFU_SUCCESS;
 }
 
-static uint32_t MCU_DFU_CalcCRC(void)
+static bool MCU_DFU_IsMagic(const uint8_t *p_data, size_t len, uint32_t magic)
 {
-    uint32_t crc = ~CRC32_INIT_VAL;
-    if (FirmwareOffset != 0)
+    if (len > sizeof(magic))
     {
-        crc = CalcCRC32((uint8_t *)((uintptr_t)Flasher_GetSpaceAddr()), FirmwareOffset, ~crc);
+        len = sizeof(magic);
     }
-    if (PageOffset != 0)
+
+    return 0 == memcmp(p_data, &magic, len);
+}
+
+static uint8_t MCU_DFU_BaseRead(uint32_t position)
+{
+    return *(uint8_t *)((uintptr_t)(Flasher_GetFirmwareAddr() + position));
+}
+
+static bool MCU_DFU_IsOutputValid(void)
+{
+    bool is_done = (ImageFormat == DFU_FORMAT_COMPRESSED) ? LZ4Decoder_IsDone(&Decoder) : DeltaPatcher_IsDone(&Patcher);
+    if (!is_done)
     {
-        crc = CalcCRC32(PageBuffer, PageOffset, ~crc);
+        return false;
     }
-    return crc;
+
+    // Full words are flushed as they are completed, only the image tail can wait
+    if ((OutputLen % sizeof(uint32_t) != 0) && !MCU_DFU_OutputFlush())
+    {
+        return false;
+    }
+
+    uint32_t crc = CalcCRC32((uint8_t *)((uintptr_t)Flasher_GetSpaceAddr()), ImageSize, CRC32_INIT_VAL);
+    LOG_INFO("DFU Output image CRC %08X, expected %08X", crc, ImageCrc);
+
+    return crc == ImageCrc;
+}
+
+static bool MCU_DFU_OutputWrite(uint8_t data)
+{
+    uint32_t shift = 8 * (OutputLen % sizeof(uint32_t));
+
+    OutputWord = (OutputWord & ~(0xFFUL << shift)) | ((uint32_t)data << shift);
+    OutputLen++;
+
+    if (OutputLen % sizeof(uint32_t) != 0)
+    {
+        return true;
+    }
+
+    return MCU_DFU_OutputFlush();
+}
+
+static uint8_t MCU_DFU_OutputRead(uint32_t position)
+{
+    size_t flushed_len = OutputLen & ~(sizeof(uint32_t) - 1);
+
+    if (position < flushed_len)
+    {
+        return *(uint8_t *)((uintptr_t)(Flasher_GetSpaceAddr() + position));
+    }
+
+    return (uint8_t)(OutputWord >> (8 * (position % sizeof(uint32_t))));
+}
+
+static bool MCU_DFU_OutputFlush(void)
+{
+    size_t offset  = (OutputLen - 1) & ~(sizeof(uint32_t) - 1);
+    int    ret_val = MCU_DFU_EraseRange(offset, sizeof(uint32_t));
+
+    // Erased flash already holds the word value, so programming is skipped
+    if ((ret_val == FLASHER_SUCCESS) && (OutputWord != DFU_ERASED_WORD))
+    {
+        ret_val = Flasher_SaveMemoryToFlash(Flasher_GetSpaceAddr() + offset, &OutputWord, 1);
+    }
+
+    OutputWord = DFU_ERASED_WORD;
+    return ret_val == FLASHER_SUCCESS;
+}
+
+static int MCU_DFU_EraseRange(size_t offset, size_t len)
+{
+    if (len == 0)
+    {
+        return FLASHER_SUCCESS;
+    }
+
+    size_t last_sector = (offset + len - 1) / FLASHER_SECTOR_SIZE;
+
+    for (size_t sector = offset / FLASHER_SECTOR_SIZE; sector <= last_sector; sector++)
+    {
+        uint32_t mask = 1UL << (sector % 32);
+        if ((ErasedSectors[sector / 32] & mask) != 0)
+        {
+            continue;
+        }
+
+        int ret_val = Flasher_EraseSpaceSector(Flasher_GetSpaceAddr() + sector * FLASHER_SECTOR_SIZE);
+        if (ret_val != FLASHER_SUCCESS)
+        {
+            return ret_val;
+        }
+
+        ErasedSectors[sector / 32] |= mask;
+    }
+
+    return FLASHER_SUCCESS;
+}
+
+static uint32_t MCU_DFU_ProgressAddr(void)
+{
+    return Flasher_GetSpaceAddr() + Flasher_GetSpaceSize() - FLASHER_SECTOR_SIZE;
+}
+
+static int MCU_DFU_ProgressStart(void)
+{
+    MCU_DFU_ProgressHeader_T header;
+    uint32_t                 address = MCU_DFU_ProgressAddr();
+
+    ProgressRecordOffset = FLASHER_SECTOR_SIZE;
+
+    int ret_val = Flasher_EraseSpaceSector(address);
+    if (ret_val != FLASHER_SUCCESS)
+    {
+        return ret_val;
+    }
+
+    header.firmware_size = FirmwareSize;
+    header.magic         = DFU_PROGRESS_MAGIC;
+    memcpy(header.sha256, Sha256, SHA256_SIZE);
+
+    // Magic goes last, so header is not valid until fully written
+    ret_val = Flasher_SaveMemoryToFlash(address, (uint32_t *)&header, sizeof(header) / 4 - 1);
+    if (ret_val == FLASHER_SUCCESS)
+    {
+        ret_val = Flasher_SaveMemoryToFlash(address + offsetof(MCU_DFU_ProgressHeader_T, magic), &header.magic, 1);
+    }
+    if (ret_val == FLASHER_SUCCESS)
+    {
+        ProgressRecordOffset = sizeof(header);
+    }
+
+    return ret_val;
+}
+
+static void MCU_DFU_ProgressAppend(void)
+{
+    if (ProgressRecordOffset + sizeof(MCU_DFU_ProgressRecord_T) > FLASHER_SECTOR_SIZE)
+    {
+        // Sector is full, older records are not needed any more
+        if (MCU_DFU_ProgressStart() != FLASHER_SUCCESS)
+        {
+            return;
+        }
+    }
+
+    MCU_DFU_ProgressRecord_T record;
+    uint32_t                 address = MCU_DFU_ProgressAddr() + ProgressRecordOffset;
+
+    record.offset = FirmwareOffset;
+    record.crc    = FirmwareCrc;
+    record.magic  = DFU_PROGRESS_MAGIC;
+    memcpy(record.sha256_state, ImageSha256.state, sizeof(record.sha256_state));
+
+    // Slot is used even if write fails, so a torn record is never overwritten
+    ProgressRecordOffset += sizeof(record);
+
+    int ret_val = Flasher_SaveMemoryToFlash(address, (uint32_t *)&record, sizeof(record) / 4 - 1);
+    if (ret_val == FLASHER_SUCCESS)
+    {
+        ret_val = Flasher_SaveMemoryToFlash(address + offsetof(MCU_DFU_ProgressRecord_T, magic), &record.magic, 1);
+    }
+    if (ret_val != FLASHER_SUCCESS)
+    {
+        LOG_INFO("DFU Progress record not stored, flasher fail");
+    }
+}
+
+static void MCU_DFU_ProgressClear(void)
+{
+    const MCU_DFU_ProgressHeader_T *p_header = (const MCU_DFU_ProgressHeader_T *)((uintptr_t)MCU_DFU_ProgressAddr());
+
+    if (p_header->magic != DFU_ERASED_WORD)
+    {
+        Flasher_EraseSpaceSector(MCU_DFU_ProgressAddr());
+    }
+    ProgressRecordOffset = FLASHER_SECTOR_SIZE;
+}
+
+static bool MCU_DFU_ProgressResume(void)
+{
+    const MCU_DFU_ProgressHeader_T *p_header = (const MCU_DFU_ProgressHeader_T *)((uintptr_t)MCU_DFU_ProgressAddr());
+
+    if ((p_header->magic != DFU_PROGRESS_MAGIC) || (p_header->firmware_size != FirmwareSize) || (memcmp(p_header->sha256, Sha256, SHA256_SIZE) != 0))
+    {
+        return false;
+    }
+
+    const MCU_DFU_ProgressRecord_T *p_last = NULL;
+    size_t                          offset = sizeof(MCU_DFU_ProgressHeader_T);
+
+    for (; offset + sizeof(MCU_DFU_ProgressRecord_T) <= FLASHER_SECTOR_SIZE; offset += sizeof(MCU_DFU_ProgressRecord_T))
+    {
+        const MCU_DFU_ProgressRecord_T *p_record = (const MCU_DFU_ProgressRecord_T *)((uintptr_t)(MCU_DFU_ProgressAddr() + offset));
+
+        if (p_record->magic == DFU_PROGRESS_MAGIC)
+        {
+            p_last = p_record;
+            continue;
+        }
+
+        // Record torn by reset is skipped, scan ends at first free slot
+        const uint32_t *p_word  = (const uint32_t *)p_record;
+        bool            is_free = true;
+        for (size_t i = 0; i < sizeof(MCU_DFU_ProgressRecord_T) / 4; i++)
+        {
+            is_free &= (p_word[i] == DFU_ERASED_WORD);
+        }
+        if (is_free)
+        {
+            break;
+        }
+    }
+
+    ProgressRecordOffset = offset;
+
+    if (p_last != NULL)
+    {
+        // Data after the last record may be a partially programmed page, so that sector is erased again
+        FirmwareOffset = p_last->offset;
+        FirmwareCrc    = p_last->crc;
+        Sha256_Resume(&ImageSha256, p_last->sha256_state, p_last->offset);
+    }
+
+    return true;
 }
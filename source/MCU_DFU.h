@@ -33,6 +33,11 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 void SetupDFU(void);
 
+/*
+ * Commit stored DFU page to flash, a few words per call
+ */
+void LoopDFU(void);
+
 /*
  * Get DFU state
  */
@@ -157,6 +157,15 @@ typedef struct
     uint32_t  dispatch_time;
 } EnqueuedMsg_T;
 
+typedef void (*MeshInternal_SensorHandler_T)(uint8_t *p_payload, uint16_t src_addr);
+
+typedef struct
+{
+    uint16_t                     property_id; /**< Sensor property ID */
+    uint8_t                      len;         /**< Length of property value */
+    MeshInternal_SensorHandler_T handler;     /**< Passes decoded value to SensorOutput */
+} MeshInternal_SensorEntry_T;
+
 EnqueuedMsg_T *MeshMsgsQueue[MESH_MESSAGES_QUEUE_LENGTH];
 
 
@@ -266,65 +275,69 @@ static void MeshInternal_ProcessSensorProperty(uint16_t property_id, uint8_t *p_
 /*
  *  Process PIR update
  *
- *  @param * p_payload    Pointer to message p_payload
- *  @param len            Payload length
+ *  @param * p_payload    Pointer to property value
  *  @param src_addr       Source address
  */
-static void MeshInternal_ProcessPresenceDetected(uint8_t *p_payload, size_t len, uint16_t src_addr);
+static void MeshInternal_ProcessPresenceDetected(uint8_t *p_payload, uint16_t src_addr);
 
 /*
  *  Process ALS update
  *
- *  @param * p_payload    Pointer to message p_payload
- *  @param len            Payload length
+ *  @param * p_payload    Pointer to property value
  *  @param src_addr       Source address
  */
-static void MeshInternal_ProcessPresentAmbientLightLevel(uint8_t *p_payload, size_t len, uint16_t src_addr);
+static void MeshInternal_ProcessPresentAmbientLightLevel(uint8_t *p_payload, uint16_t src_addr);
 
 /*
  *  Process Power Sensor update
  *
- *  @param * p_payload    Pointer to message p_payload
- *  @param len            Payload length
+ *  @param * p_payload    Pointer to property value
  *  @param src_addr       Source address
  */
-static void MeshInternal_ProcessDeviceInputPower(uint8_t *p_payload, size_t len, uint16_t src_addr);
+static void MeshInternal_ProcessDeviceInputPower(uint8_t *p_payload, uint16_t src_addr);
 
 /*
  *  Process Current Sensor update
  *
- *  @param * p_payload    Pointer to message p_payload
- *  @param len            Payload length
+ *  @param * p_payload    Pointer to property value
  *  @param src_addr       Source address
  */
-static void MeshInternal_ProcessPresentInputCurrent(uint8_t *p_payload, size_t len, uint16_t src_addr);
+static void MeshInternal_ProcessPresentInputCurrent(uint8_t *p_payload, uint16_t src_addr);
 
 /*
  *  Process Voltage Sensor update
  *
- *  @param * p_payload    Pointer to message p_payload
- *  @param len            Payload length
+ *  @param * p_payload    Pointer to property value
  *  @param src_addr       Source address
  */
-static void MeshInternal_ProcessPresentInputVoltage(uint8_t *p_payload, size_t len, uint16_t src_addr);
+static void MeshInternal_ProcessPresentInputVoltage(uint8_t *p_payload, uint16_t src_addr);
 
 /*
  *  Process Energy Sensor update
  *
- *  @param * p_payload    Pointer to message p_payload
- *  @param len            Payload length
+ *  @param * p_payload    Pointer to property value
  *  @param src_addr       Source address
  */
-static void MeshInternal_ProcessTotalDeviceEnergyUse(uint8_t *p_payload, size_t len, uint16_t src_addr);
+static void MeshInternal_ProcessTotalDeviceEnergyUse(uint8_t *p_payload, uint16_t src_addr);
 
 /*
  *  Process Precise Energy Sensor update
  *
- *  @param * p_payload    Pointer to message p_payload
- *  @param len            Payload length
+ *  @param * p_payload    Pointer to property value
  *  @param src_addr       Source address
  */
-static void MeshInternal_ProcessPreciseTotalDeviceEnergyUse(uint8_t *p_payload, size_t len, uint16_t src_addr);
+static void MeshInternal_ProcessPreciseTotalDeviceEnergyUse(uint8_t *p_payload, uint16_t src_addr);
+
+/**< Handlers of sensor properties received in Sensor Status messages, value length is checked before the handler runs */
+static constexpr MeshInternal_SensorEntry_T SensorHandlers[] = {
+    {PRESENCE_DETECTED, 1, MeshInternal_ProcessPresenceDetected},
+    {PRESENT_AMBIENT_LIGHT_LEVEL, 3, MeshInternal_ProcessPresentAmbientLightLevel},
+    {PRESENT_DEVICE_INPUT_POWER, 3, MeshInternal_ProcessDeviceInputPower},
+    {PRESENT_INPUT_CURRENT, 2, MeshInternal_ProcessPresentInputCurrent},
+    {PRESENT_INPUT_VOLTAGE, 2, MeshInternal_ProcessPresentInputVoltage},
+    {TOTAL_DEVICE_ENERGY_USE, 3, MeshInternal_ProcessTotalDeviceEnergyUse},
+    {PRECISE_TOTAL_DEVICE_ENERGY_USE, 4, MeshInternal_ProcessPreciseTotalDeviceEnergyUse},
+};
 
 
 bool Mesh_IsModelAvailable(uint8_t *p_payload, uint8_t len, uint16_t expected_model_id)
@@ -988,139 +1001,75 @@ static void MeshInternal_ProcessSensorStatus(uint8_t *p_payload, size_t len)
 
 static void MeshInternal_ProcessSensorProperty(uint16_t property_id, uint8_t *p_payload, size_t len, uint16_t src_addr)
 {
-    switch (property_id)
+    for (size_t i = 0; i < ARRAY_SIZE(SensorHandlers); i++)
     {
-        case PRESENCE_DETECTED:
-        {
-            MeshInternal_ProcessPresenceDetected(p_payload, len, src_addr);
-            break;
-        }
-        case PRESENT_AMBIENT_LIGHT_LEVEL:
-        {
-            MeshInternal_ProcessPresentAmbientLightLevel(p_payload, len, src_addr);
-            break;
-        }
-        case PRESENT_DEVICE_INPUT_POWER:
-        {
-            MeshInternal_ProcessDeviceInputPower(p_payload, len, src_addr);
-            break;
-        }
-        case PRESENT_INPUT_CURRENT:
-        {
-            MeshInternal_ProcessPresentInputCurrent(p_payload, len, src_addr);
-            break;
-        }
-        case PRESENT_INPUT_VOLTAGE:
-        {
-            MeshInternal_ProcessPresentInputVoltage(p_payload, len, src_addr);
-            break;
-        }
-        case TOTAL_DEVICE_ENERGY_USE:
-        {
-            MeshInternal_ProcessTotalDeviceEnergyUse(p_payload, len, src_addr);
-            break;
-        }
-        case PRECISE_TOTAL_DEVICE_ENERGY_USE:
+        const MeshInternal_SensorEntry_T *p_entry = &SensorHandlers[i];
+
+        if (p_entry->property_id != property_id)
         {
-            MeshInternal_ProcessPreciseTotalDeviceEnergyUse(p_payload, len, src_addr);
-            break;
+            continue;
         }
-        default:
+
+        if (len != p_entry->len)
         {
-            LOG_INFO("Invalid property id");
+            LOG_INFO("Invalid Length Sensor Status message");
+            return;
         }
-    }
-}
 
-static void MeshInternal_ProcessPresenceDetected(uint8_t *p_payload, size_t len, uint16_t src_addr)
-{
-    if (len != 1)
-    {
-        LOG_INFO("Invalid Length Sensor Status message");
+        p_entry->handler(p_payload, src_addr);
         return;
     }
 
+    LOG_INFO("Invalid property id");
+}
+
+static void MeshInternal_ProcessPresenceDetected(uint8_t *p_payload, uint16_t src_addr)
+{
     SensorValue_T sensor_value = {.pir = p_payload[0]};
 
     SensorOutput_ProcessPresenceDetected(src_addr, sensor_value);
 }
 
-static void MeshInternal_ProcessPresentAmbientLightLevel(uint8_t *p_payload, size_t len, uint16_t src_addr)
+static void MeshInternal_ProcessPresentAmbientLightLevel(uint8_t *p_payload, uint16_t src_addr)
 {
-    if (len != 3)
-    {
-        LOG_INFO("Invalid Length Sensor Status message");
-        return;
-    }
-
     SensorValue_T sensor_value = {.als = ((uint32_t)p_payload[0]) | ((uint32_t)p_payload[1] << 8) | ((uint32_t)p_payload[2] << 16)};
 
     SensorOutput_ProcessPresentAmbientLightLevel(src_addr, sensor_value);
 }
 
-static void MeshInternal_ProcessDeviceInputPower(uint8_t *p_payload, size_t len, uint16_t src_addr)
+static void MeshInternal_ProcessDeviceInputPower(uint8_t *p_payload, uint16_t src_addr)
 {
-    if (len != 3)
-    {
-        LOG_INFO("Invalid Length Sensor Status message");
-        return;
-    }
-
     SensorValue_T sensor_value = {.power = ((uint32_t)p_payload[0]) | ((uint32_t)p_payload[1] << 8) | ((uint32_t)p_payload[2] << 16)};
 
     SensorOutput_ProcessPresentDeviceInputPower(src_addr, sensor_value);
 }
 
-static void MeshInternal_ProcessPresentInputCurrent(uint8_t *p_payload, size_t len, uint16_t src_addr)
+static void MeshInternal_ProcessPresentInputCurrent(uint8_t *p_payload, uint16_t src_addr)
 {
-    if (len != 2)
-    {
-        LOG_INFO("Invalid Length Sensor Status message");
-        return;
-    }
-
     SensorValue_T sensor_value;
     sensor_value.current = ((uint16_t)p_payload[0]) | ((uint16_t)p_payload[1] << 8);
 
     SensorOutput_ProcessPresentInputCurrent(src_addr, sensor_value);
 }
 
-static void MeshInternal_ProcessPresentInputVoltage(uint8_t *p_payload, size_t len, uint16_t src_addr)
+static void MeshInternal_ProcessPresentInputVoltage(uint8_t *p_payload, uint16_t src_addr)
 {
-    if (len != 2)
-    {
-        LOG_INFO("Invalid Length Sensor Status message");
-        return;
-    }
-
     SensorValue_T sensor_value;
     sensor_value.voltage = ((uint16_t)p_payload[0]) | ((uint16_t)p_payload[1] << 8);
 
     SensorOutput_ProcessPresentInputVoltage(src_addr, sensor_value);
 }
 
-static void MeshInternal_ProcessTotalDeviceEnergyUse(uint8_t *p_payload, size_t len, uint16_t src_addr)
+static void MeshInternal_ProcessTotalDeviceEnergyUse(uint8_t *p_payload, uint16_t src_addr)
 {
-    if (len != 3)
-    {
-        LOG_INFO("Invalid Length Sensor Status message");
-        return;
-    }
-
     SensorValue_T sensor_value;
     sensor_value.energy = (((uint32_t)p_payload[0]) | ((uint32_t)p_payload[1] << 8) | ((uint32_t)p_payload[2] << 16));
 
     SensorOutput_ProcessTotalDeviceEnergyUse(src_addr, sensor_value);
 }
 
-static void MeshInternal_ProcessPreciseTotalDeviceEnergyUse(uint8_t *p_payload, size_t len, uint16_t src_addr)
+static void MeshInternal_ProcessPreciseTotalDeviceEnergyUse(uint8_t *p_payload, uint16_t src_addr)
 {
-    if (len != 4)
-    {
-        LOG_INFO("Invalid Length Sensor Status message");
-        return;
-    }
-
     SensorValue_T sensor_value = {.precise_energy = ((uint32_t)p_payload[0]) | ((uint32_t)p_payload[1] << 8) | ((uint32_t)p_payload[2] << 16) |
                                                     ((uint32_t)p_payload[3] << 24)};
 
@@ -24,6 +24,7 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Log.h"
 #include "Timestamp.h"
 #include "UARTProtocol.h"
+#include "Utils.h"
 
 #define SYNC_TIME_PERIOD_MS (1000 * 60)
 
@@ -77,10 +78,7 @@ static bool ValidateTimeValuesRange(TimeDate *time_date)
 
 void MeshTime_ProcessTimeSourceSetRequest(uint8_t *p_payload, uint8_t len)
 {
-    if ((p_payload == NULL) || (len != sizeof(TimeSourceSetReq_T)))
-    {
-        return;
-    }
+    UNUSED(len);
 
     TimeSourceSetReq_T *msg = (TimeSourceSetReq_T *)p_payload;
 
@@ -98,10 +96,7 @@ void MeshTime_ProcessTimeSourceSetRequest(uint8_t *p_payload, uint8_t len)
 
 void MeshTime_ProcessTimeSourceGetRequest(uint8_t *p_payload, uint8_t len)
 {
-    if ((p_payload == NULL) || (len != sizeof(TimeSourceGetReq_T)))
-    {
-        return;
-    }
+    UNUSED(len);
 
     TimeSourceGetReq_T *msg = (TimeSourceGetReq_T *)p_payload;
 
@@ -115,10 +110,7 @@ void MeshTime_ProcessTimeSourceGetRequest(uint8_t *p_payload, uint8_t len)
 
 void MeshTime_ProcessTimeGetResponse(uint8_t *p_payload, uint8_t len)
 {
-    if ((p_payload == NULL) || (len != sizeof(TimeGetResp_T)))
-    {
-        return;
-    }
+    UNUSED(len);
 
     TimeGetResp_T *msg = (TimeGetResp_T *)p_payload;
 
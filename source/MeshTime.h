@@ -80,10 +80,28 @@ static_assert(sizeof(TimeSourceSetResp_T) == 1, "Wrong size of the struct TimeSo
 static_assert(sizeof(TimeGetReq_T) == 1, "Wrong size of the struct TimeGetReq_T");
 static_assert(sizeof(TimeGetResp_T) == 10, "Wrong size of the struct TimeGetResp_T");
 
+/*
+ *  Process Time Source Set Request command
+ *
+ *  @param p_payload    Command payload
+ *  @param len          Payload len, must be sizeof(TimeSourceSetReq_T) as checked by UART command dispatch
+ */
 void MeshTime_ProcessTimeSourceSetRequest(uint8_t *p_payload, uint8_t len);
 
+/*
+ *  Process Time Source Get Request command
+ *
+ *  @param p_payload    Command payload
+ *  @param len          Payload len, must be sizeof(TimeSourceGetReq_T) as checked by UART command dispatch
+ */
 void MeshTime_ProcessTimeSourceGetRequest(uint8_t *p_payload, uint8_t len);
 
+/*
+ *  Process Time Get Response command
+ *
+ *  @param p_payload    Command payload
+ *  @param len          Payload len, must be sizeof(TimeGetResp_T) as checked by UART command dispatch
+ */
 void MeshTime_ProcessTimeGetResponse(uint8_t *p_payload, uint8_t len);
 
 MeshTimeLastSync_T *MeshTime_GetLastSyncTime(void);
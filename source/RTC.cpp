@@ -48,6 +48,7 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define HEALTH_FAULT_ID_RTC_ERROR 0xA1
 
 volatile static bool                 ReceivedTimeGet = false;
+volatile static bool                 IsSecondElapsed = false;
 static SendTimeSourceGetRespCallback TimeSourceGetRespCallback;
 static SendTimeSourceSetRespCallback TimeSourceSetRespCallback;
 static uint8_t                       LastBatteryLevelPercent    = 0;
@@ -79,6 +80,7 @@ static struct
 } TimeSetParams;
 
 static void OnSecondElapsed(void);
+static void ProcessSecondElapsed(void);
 static void MeasureBatteryLevel(void);
 static void UpdateBatteryStatus(void);
 static void UpdateHealthFaultStatus(void);
@@ -200,6 +202,12 @@ void LoopRTC(void)
         return;
     }
 
+    if (IsSecondElapsed)
+    {
+        IsSecondElapsed = false;
+        ProcessSecondElapsed();
+    }
+
     MeasureBatteryLevel();
 
     if (TimeSetParams.set_time_valid == false)
@@ -219,11 +227,12 @@ void LoopRTC(void)
 
 static void OnSecondElapsed(void)
 {
-    if ((TimeServerInstanceIdx == INSTANCE_INDEX_UNKNOWN) || (PCF8523_Drv_IsInitialized() == false))
-    {
-        return;
-    }
+    // Runs in the pin interrupt, UART senders may only be called from the main loop
+    IsSecondElapsed = true;
+}
 
+static void ProcessSecondElapsed(void)
+{
     if (ReceivedTimeGet)
     {
         struct TimeDate date;
@@ -21,30 +21,30 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "RingBuffer.h"
 
+/**< Index accessors, see ownership rules in RingBuffer.h */
+#define LOAD_ACQUIRE(p_index) __atomic_load_n((p_index), __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(p_index, value) __atomic_store_n((p_index), (value), __ATOMIC_RELEASE)
+
 static bool     IsOverflow(RingBuffer_T *p_ring_buffer, uint16_t len);
-static uint16_t MaxQueueBufferLen(RingBuffer_T *p_ring_buffer, uint16_t table_len);
+static uint16_t ContinuousLen(RingBuffer_T *p_ring_buffer, size_t index, uint16_t len);
 
 void RingBuffer_Init(RingBuffer_T *p_ring_buffer, uint8_t *p_buf_pointer, size_t buf_len)
 {
     p_ring_buffer->p_buf   = p_buf_pointer;
     p_ring_buffer->buf_len = buf_len;
+    p_ring_buffer->mask    = buf_len - 1;
     p_ring_buffer->wr      = 0;
     p_ring_buffer->rd      = 0;
 }
 
 bool RingBuffer_isEmpty(RingBuffer_T *p_ring_buffer)
 {
-    return p_ring_buffer->wr == p_ring_buffer->rd;
-}
-
-void RingBuffer_SetWrIndex(RingBuffer_T *p_ring_buffer, uint16_t value)
-{
-    p_ring_buffer->wr = (value) % p_ring_buffer->buf_len;
+    return RingBuffer_DataLen(p_ring_buffer) == 0;
 }
 
 void RingBuffer_IncrementRdIndex(RingBuffer_T *p_ring_buffer, uint16_t value)
 {
-    p_ring_buffer->rd = (p_ring_buffer->rd + value) % p_ring_buffer->buf_len;
+    STORE_RELEASE(&p_ring_buffer->rd, p_ring_buffer->rd + value);
 }
 
 bool RingBuffer_DequeueByte(RingBuffer_T *p_ring_buffer, uint8_t *read_byte)
@@ -53,54 +53,85 @@ bool RingBuffer_DequeueByte(RingBuffer_T *p_ring_buffer, uint8_t *read_byte)
     {
         return false;
     }
-    *read_byte = p_ring_buffer->p_buf[(p_ring_buffer->rd)++];
 
-    if (p_ring_buffer->rd >= p_ring_buffer->buf_len)
-    {
-        p_ring_buffer->rd = 0;
-    }
+    *read_byte = p_ring_buffer->p_buf[p_ring_buffer->rd & p_ring_buffer->mask];
+    STORE_RELEASE(&p_ring_buffer->rd, p_ring_buffer->rd + 1);
 
     return true;
 }
 
 bool RingBuffer_QueueBytes(RingBuffer_T *p_ring_buffer, uint8_t *table, uint16_t table_len)
 {
-    if (IsOverflow(p_ring_buffer, table_len))
+    RingBuffer_View_T view;
+
+    if (!RingBuffer_Reserve(p_ring_buffer, table_len, &view))
     {
         return false;
     }
 
-    uint16_t cpy_len = MaxQueueBufferLen(p_ring_buffer, table_len);
-    memcpy(&p_ring_buffer->p_buf[p_ring_buffer->wr], table, cpy_len);
-
-    if (cpy_len != table_len)
-    {
-        uint16_t rest_of_table_len = table_len - cpy_len;
-        memcpy(p_ring_buffer->p_buf, &table[cpy_len], rest_of_table_len);
-    }
+    memcpy(view.p_first, table, view.first_len);
+    memcpy(view.p_second, &table[view.first_len], view.second_len);
 
-    RingBuffer_SetWrIndex(p_ring_buffer, p_ring_buffer->wr + table_len);
+    RingBuffer_Commit(p_ring_buffer, table_len);
 
     return true;
 }
 
 uint8_t *RingBuffer_GetMaxContinuousBuffer(RingBuffer_T *p_ring_buffer, uint16_t *buf_len)
 {
-    if (p_ring_buffer->rd + RingBuffer_DataLen(p_ring_buffer) > p_ring_buffer->buf_len)
+    *buf_len = ContinuousLen(p_ring_buffer, p_ring_buffer->rd, RingBuffer_DataLen(p_ring_buffer));
+
+    return &p_ring_buffer->p_buf[p_ring_buffer->rd & p_ring_buffer->mask];
+}
+
+uint8_t RingBuffer_PeekByte(RingBuffer_T *p_ring_buffer, uint16_t offset)
+{
+    return p_ring_buffer->p_buf[(p_ring_buffer->rd + offset) & p_ring_buffer->mask];
+}
+
+bool RingBuffer_Peek(RingBuffer_T *p_ring_buffer, uint16_t offset, uint16_t len, RingBuffer_View_T *p_view)
+{
+    if (offset + len > RingBuffer_DataLen(p_ring_buffer))
     {
-        *buf_len = p_ring_buffer->buf_len - p_ring_buffer->rd;
+        return false;
     }
-    else
+
+    size_t start = p_ring_buffer->rd + offset;
+
+    p_view->p_first    = &p_ring_buffer->p_buf[start & p_ring_buffer->mask];
+    p_view->first_len  = ContinuousLen(p_ring_buffer, start, len);
+    p_view->p_second   = p_ring_buffer->p_buf;
+    p_view->second_len = len - p_view->first_len;
+
+    return true;
+}
+
+bool RingBuffer_Reserve(RingBuffer_T *p_ring_buffer, uint16_t len, RingBuffer_View_T *p_view)
+{
+    if (IsOverflow(p_ring_buffer, len))
     {
-        *buf_len = RingBuffer_DataLen(p_ring_buffer);
+        return false;
     }
 
-    return &p_ring_buffer->p_buf[p_ring_buffer->rd];
+    p_view->p_first    = &p_ring_buffer->p_buf[p_ring_buffer->wr & p_ring_buffer->mask];
+    p_view->first_len  = ContinuousLen(p_ring_buffer, p_ring_buffer->wr, len);
+    p_view->p_second   = p_ring_buffer->p_buf;
+    p_view->second_len = len - p_view->first_len;
+
+    return true;
+}
+
+void RingBuffer_Commit(RingBuffer_T *p_ring_buffer, uint16_t len)
+{
+    STORE_RELEASE(&p_ring_buffer->wr, p_ring_buffer->wr + len);
 }
 
 uint16_t RingBuffer_DataLen(RingBuffer_T *p_ring_buffer)
 {
-    return (p_ring_buffer->wr - p_ring_buffer->rd) % p_ring_buffer->buf_len;
+    size_t rd = LOAD_ACQUIRE(&p_ring_buffer->rd);
+    size_t wr = LOAD_ACQUIRE(&p_ring_buffer->wr);
+
+    return wr - rd;
 }
 
 static bool IsOverflow(RingBuffer_T *p_ring_buffer, uint16_t len)
@@ -108,19 +139,9 @@ static bool IsOverflow(RingBuffer_T *p_ring_buffer, uint16_t len)
     return (len + RingBuffer_DataLen(p_ring_buffer)) > p_ring_buffer->buf_len;
 }
 
-static uint16_t MaxQueueBufferLen(RingBuffer_T *p_ring_buffer, uint16_t table_len)
+static uint16_t ContinuousLen(RingBuffer_T *p_ring_buffer, size_t index, uint16_t len)
 {
-    if (IsOverflow(p_ring_buffer, table_len))
-    {
-        return 0;
-    }
+    size_t to_end = p_ring_buffer->buf_len - (index & p_ring_buffer->mask);
 
-    if (p_ring_buffer->wr + table_len > p_ring_buffer->buf_len)
-    {
-        return p_ring_buffer->buf_len - p_ring_buffer->wr;
-    }
-    else
-    {
-        return table_len;
-    }
+    return (len > to_end) ? to_end : len;
 }
@@ -28,20 +28,59 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "Config.h"
 
+/**< Checks at compile time if buffer length is a power of two */
+#define RINGBUFFER_IS_POWER_OF_TWO(len) (((len) != 0) && (((len) & ((len)-1)) == 0))
+
+/*
+ *  Initialize ring buffer over statically sized uint8_t[] buffer.
+ *  Buffer length is validated at compile time.
+ *
+ *  @param p_ring_buffer  Pointer to ring buffer instance @def RingBuffer_T
+ *  @param buf            uint8_t[] buffer, its length must be a power of two
+ */
+#define RINGBUFFER_INIT(p_ring_buffer, buf)                                                                  \
+    do                                                                                                        \
+    {                                                                                                         \
+        static_assert(RINGBUFFER_IS_POWER_OF_TWO(sizeof(buf)), "Ring buffer length must be a power of two"); \
+        RingBuffer_Init((p_ring_buffer), (buf), sizeof(buf));                                                \
+    } while (0)
+
+/*
+ *  Ring buffer with power of two length. Indexes are free running and are
+ *  reduced to buffer offsets with a mask, so no division is needed and the
+ *  whole buffer can be filled.
+ *
+ *  Buffer is safe for a single producer and a single consumer running in different
+ *  contexts (e.g. main loop and ISR) without disabling interrupts:
+ *  - wr is written only by the producer (RingBuffer_QueueBytes, RingBuffer_Commit)
+ *    and published with release ordering,
+ *  - rd is written only by the consumer (RingBuffer_DequeueByte,
+ *    RingBuffer_IncrementRdIndex) and published with release ordering,
+ *  - each side reads the other side's index with acquire ordering.
+ */
 typedef struct RingBuffer_Tag
 {
     uint8_t *p_buf;
     size_t   buf_len;
+    size_t   mask;
     size_t   wr;
     size_t   rd;
 } RingBuffer_T;
 
+typedef struct RingBuffer_View_Tag
+{
+    uint8_t *p_first;
+    uint16_t first_len;
+    uint8_t *p_second;
+    uint16_t second_len;
+} RingBuffer_View_T;
+
 /*
- *  Initialize ring buffer.
+ *  Initialize ring buffer. Prefer RINGBUFFER_INIT for statically sized buffers.
  *
  *  @param p_ring_buffer  Pointer to ring buffer instance @def RingBuffer_T
  *  @param bufPointer     Pointer to initialized uint8_t[] buffer
- *  @param bufLen         Length of the buffer.
+ *  @param bufLen         Length of the buffer, must be a power of two
  *  @return               void
  */
 void RingBuffer_Init(RingBuffer_T *p_ring_buffer, uint8_t *bufPointer, size_t bufLen);
@@ -55,7 +94,9 @@ void RingBuffer_Init(RingBuffer_T *p_ring_buffer, uint8_t *bufPointer, size_t bu
 bool RingBuffer_isEmpty(RingBuffer_T *ring_buffer);
 
 /*
- *  Write bytes from table to ring buffer
+ *  Write bytes from table to ring buffer. Copying wrapper of RingBuffer_Reserve and
+ *  RingBuffer_Commit; firmware writes in place instead, host test doubles feed
+ *  received bytes with it.
  *
  *  @param p_ring_buffer  Pointer to ring buffer instance @def RingBuffer_T
  *  @param table          pointer to table with bytes to be queued
@@ -66,22 +107,14 @@ bool RingBuffer_isEmpty(RingBuffer_T *ring_buffer);
 bool RingBuffer_QueueBytes(RingBuffer_T *p_ring_buffer, uint8_t *table, uint16_t table_len);
 
 /*
- *  Get byte from ring buffer.
+ *  Get byte from ring buffer. Firmware consumers use RingBuffer_Peek and
+ *  RingBuffer_IncrementRdIndex, this is the byte-wise reader of host test doubles.
  *
  *  @param p_ring_buffer    Pointer to ring buffer instance @def RingBuffer_T
  *  @return                 True if success, false if empty
  */
 bool RingBuffer_DequeueByte(RingBuffer_T *p_ring_buffer, uint8_t *read_byte);
 
-/*
- *  Set RingBuffer wr index (needed for DMA).
- *
- *  @param p_ring_buffer  Pointer to ring buffer instance @def RingBuffer_T
- *  @param value          number of queued bytes
- *  @return               True if success, false if buffer is overflowed
- */
-void RingBuffer_SetWrIndex(RingBuffer_T *p_ring_buffer, uint16_t value);
-
 /*
  *  Inform Ring Buffer how many bytes were dequeued from it without using
  *  RingBuffer_DequeueByte (needed for DMA).
@@ -111,4 +144,47 @@ uint16_t RingBuffer_DataLen(RingBuffer_T *p_ring_buffer);
  */
 uint8_t *RingBuffer_GetMaxContinuousBuffer(RingBuffer_T *p_ring_buffer, uint16_t *buf_len);
 
+/*
+ *  Get byte from ring buffer without dequeuing it.
+ *
+ *  @param p_ring_buffer  Pointer to ring buffer instance @def RingBuffer_T
+ *  @param offset         Offset from the oldest queued byte, must be lower
+ *                        than RingBuffer_DataLen
+ *  @return               Byte at given offset
+ */
+uint8_t RingBuffer_PeekByte(RingBuffer_T *p_ring_buffer, uint16_t offset);
+
+/*
+ *  Get view of queued data without dequeuing it. Data that wraps around the end
+ *  of the buffer is described by two segments. The data stays valid until it is
+ *  released with RingBuffer_IncrementRdIndex.
+ *
+ *  @param p_ring_buffer  Pointer to ring buffer instance @def RingBuffer_T
+ *  @param offset         Offset from the oldest queued byte
+ *  @param len            Length of the data
+ *  @param p_view         [out] Segments of the data
+ *  @return               True if success, false if less data is queued
+ */
+bool RingBuffer_Peek(RingBuffer_T *p_ring_buffer, uint16_t offset, uint16_t len, RingBuffer_View_T *p_view);
+
+/*
+ *  Reserve space for data that will be written in place, without copying it
+ *  through an intermediate buffer. Space that wraps around the end of the buffer
+ *  is described by two segments. Reserved data is queued with RingBuffer_Commit.
+ *
+ *  @param p_ring_buffer  Pointer to ring buffer instance @def RingBuffer_T
+ *  @param len            Length of space to reserve
+ *  @param p_view         [out] Segments of reserved space
+ *  @return               True if success, false if reservation could cause overflow
+ */
+bool RingBuffer_Reserve(RingBuffer_T *p_ring_buffer, uint16_t len, RingBuffer_View_T *p_view);
+
+/*
+ *  Queue data written to space obtained with RingBuffer_Reserve.
+ *
+ *  @param p_ring_buffer  Pointer to ring buffer instance @def RingBuffer_T
+ *  @param len            Length of written data, not bigger than reserved length
+ */
+void RingBuffer_Commit(RingBuffer_T *p_ring_buffer, uint16_t len);
+
 #endif    //RINGBUFFER_H
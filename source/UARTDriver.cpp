@@ -25,24 +25,38 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "Config.h"
 #include "RingBuffer.h"
+#include "UARTStats.h"
 #include "kinetis.h"
 
 #define RX_BUFFER_LEN 512
 #define TX_BUFFER_LEN 512
 
-#define C2_RX_ENABLE (UART_C2_TE | UART_C2_RE | UART_C2_RIE)
+#define C2_RX_ENABLE (UART_C2_TE | UART_C2_RE | UART_C2_RIE | UART_C2_ILIE)
+#define C2_RX_IDLE_ARMED (UART_C2_ILIE)
 #define C2_TX_ACTIVE (UART_C2_TIE)
 #define C2_TX_INACTIVE (~C2_TX_ACTIVE)
-#define C3_ERROR_ISR_ENABLED (UART_C3_ORIE | UART_C3_NEIE | UART_C3_FEIE | UART_C3_PEIE)
 #define C4_UART_DMA_ENABLED (UART_C5_TDMAS | UART_C5_RDMAS)
+#define S1_RX_ERROR_FLAGS (UART_S1_OR | UART_S1_NF | UART_S1_FE | UART_S1_PF)
 
-#define COUNTER_SIZE (DMA_DSR_BCR_BCR(RX_BUFFER_LEN))
+/*
+ *  RX DMA runs through the circular buffer many times before it has to be re-armed, so it keeps
+ *  receiving while interrupts are disabled for long flash operations. Counter must be a multiple
+ *  of RX_BUFFER_LEN to keep the byte counter in sync with the buffer position.
+ *
+ *  Idle-line interrupt at the end of each burst is only a hint that a frame may be complete, and
+ *  wakes the core from a low-power wait. Main loop still polls the DMA position, which costs two
+ *  register reads when nothing was received, because a continuous stream longer than the buffer
+ *  has no idle line, and a half-buffer DMA completion would stop RX while interrupts are disabled
+ *  for flash operations.
+ */
+#define RX_DMA_MAX_TRANSFER_COUNT 0xFFFFFu
+#define COUNTER_SIZE (DMA_DSR_BCR_BCR(RX_DMA_MAX_TRANSFER_COUNT & ~(RX_BUFFER_LEN - 1u)))
 
 static DMAChannel rx_dma;
 static DMAChannel tx_dma;
 
-static RingBuffer_T rx_dma_buffer;
-static RingBuffer_T tx_dma_buffer;
+static RingBuffer_T rx_dma_buffer; /**< Written by RX DMA (wr updated in UARTDriver_RxDMAPoll), read by main loop */
+static RingBuffer_T tx_dma_buffer; /**< Written by main loop, read by TX DMA (rd updated in DMA_OnTXCompletion ISR) */
 
 /*
  *  According to http://cache.freescale.com/files/microcontrollers/doc/ref_manual/KL26P121M48SF4RM.pdf
@@ -51,11 +65,20 @@ static RingBuffer_T tx_dma_buffer;
 static __attribute__((section(".dmabuffers"), aligned(TX_BUFFER_LEN))) uint8_t tx_buf[TX_BUFFER_LEN];
 static __attribute__((section(".dmabuffers"), aligned(RX_BUFFER_LEN))) uint8_t rx_buf[RX_BUFFER_LEN];
 
-static uint16_t cur_tx_message_len = 0;
+static uint16_t cur_tx_message_len = 0; /**< Length of ongoing DMA transfer, owned by code running with IRQs disabled */
+
+static volatile bool     rx_data_lost         = false; /**< Set when received bytes were overwritten or not received at all */
+static volatile bool     rx_line_idle         = false; /**< Set by idle-line interrupt, cleared by UARTDriver_RxLineIdle */
+static volatile uint32_t rx_dma_completed_len = 0;     /**< Number of bytes received by completed RX DMA transfers, written in ISR */
+static uint32_t          rx_received_len      = 0;     /**< Number of received bytes seen by UARTDriver_RxDMAPoll */
 
 static void DMA_TransmitRequest();
+static void DMA_StartTransmission();
 static void DMA_OnTXCompletion();
 static void DMA_OnRXCompletion();
+static void UART_OnStatusInterrupt();
+static void UART_CheckRxErrors(uint8_t status);
+static void UART_ArmRxIdle(uint8_t status);
 static bool IsTXActive();
 
 void UARTDriver_Init()
@@ -73,7 +96,7 @@ void UARTDriver_Init()
     CORE_PIN10_CONFIG = PORT_PCR_DSE | PORT_PCR_SRE | PORT_PCR_MUX(3);
 
     // TX DMA configuration
-    RingBuffer_Init(&tx_dma_buffer, tx_buf, TX_BUFFER_LEN);
+    RINGBUFFER_INIT(&tx_dma_buffer, tx_buf);
     tx_dma.destination(UART1_D);
     tx_dma.interruptAtCompletion();
     tx_dma.disableOnCompletion();
@@ -81,7 +104,7 @@ void UARTDriver_Init()
     tx_dma.triggerAtHardwareEvent(DMAMUX_SOURCE_UART1_TX);
 
     // RX DMA configuration
-    RingBuffer_Init(&rx_dma_buffer, rx_buf, RX_BUFFER_LEN);
+    RINGBUFFER_INIT(&rx_dma_buffer, rx_buf);
     rx_dma.source(UART1_D);
     rx_dma.destinationCircular(rx_buf, RX_BUFFER_LEN);
     rx_dma.disableOnCompletion();
@@ -91,56 +114,142 @@ void UARTDriver_Init()
     rx_dma.triggerAtHardwareEvent(DMAMUX_SOURCE_UART1_RX);
     rx_dma.enable();
 
-    // UART Register settings
-    UART1_C1 = 0;
+    // UART Register settings, idle line is counted after stop bit so it is detected only between frames
+    UART1_C1 = UART_C1_ILT;
     UART1_C2 = C2_RX_ENABLE;
-    UART1_C3 = C3_ERROR_ISR_ENABLED;
+    UART1_C3 = 0;    // Receive errors are polled in UARTDriver_RxDMAPoll
     UART1_MA1 |= C4_UART_DMA_ENABLED;    // UART1_MA1 is UART1_C4 register (bug with address mapping in teensyduino libraries)
+
+    attachInterruptVector(IRQ_UART1_STATUS, UART_OnStatusInterrupt);
+    NVIC_ENABLE_IRQ(IRQ_UART1_STATUS);
 }
 
-bool UARTDriver_WriteBytes(uint8_t *table, uint16_t table_len)
+bool UARTDriver_TxReserve(uint16_t len, RingBuffer_View_T *p_view)
 {
-    if (!RingBuffer_QueueBytes(&tx_dma_buffer, table, table_len))
-    {
-        return false;
-    }
+    return RingBuffer_Reserve(&tx_dma_buffer, len, p_view);
+}
+
+uint16_t UARTDriver_TxFreeSpace(void)
+{
+    return TX_BUFFER_LEN - RingBuffer_DataLen(&tx_dma_buffer);
+}
 
+void UARTDriver_TxCommit(uint16_t len)
+{
+    RingBuffer_Commit(&tx_dma_buffer, len);
+    UARTStats_TxBytes(len, RingBuffer_DataLen(&tx_dma_buffer));
     DMA_TransmitRequest();
-    return true;
 }
 
-void DMA_TransmitRequest()
+static void DMA_TransmitRequest()
 {
+    // Only the check and start of the DMA transfer has to be atomic, TX ring indexes are safe without locking
     __disable_irq();
-    if (IsTXActive())
+    if (!IsTXActive())
     {
-        __enable_irq();
-        return;
+        DMA_StartTransmission();
     }
+    __enable_irq();
+}
 
+static void DMA_StartTransmission()
+{
     uint8_t *tx_begin_pointer = RingBuffer_GetMaxContinuousBuffer(&tx_dma_buffer, &cur_tx_message_len);
     if (cur_tx_message_len == 0)
     {
-        __enable_irq();
         return;
     }
 
     tx_dma.sourceBuffer(tx_begin_pointer, cur_tx_message_len);
     UART1_C2 |= C2_TX_ACTIVE;
     tx_dma.enable();
-    __enable_irq();
 }
 
-bool UARTDriver_ReadByte(uint8_t *read_byte)
+uint16_t UARTDriver_RxDataLen(void)
 {
-    return RingBuffer_DequeueByte(&rx_dma_buffer, read_byte);
+    return RingBuffer_DataLen(&rx_dma_buffer);
 }
 
-void UARTDriver_RxDMAPoll()
+uint8_t UARTDriver_RxPeekByte(uint16_t offset)
 {
-    __disable_irq();
-    RingBuffer_SetWrIndex(&rx_dma_buffer, COUNTER_SIZE - DMA_DSR_BCR_BCR(DMA_DSR_BCR0));
-    __enable_irq();
+    return RingBuffer_PeekByte(&rx_dma_buffer, offset);
+}
+
+bool UARTDriver_RxPeek(uint16_t offset, uint16_t len, RingBuffer_View_T *p_view)
+{
+    return RingBuffer_Peek(&rx_dma_buffer, offset, len, p_view);
+}
+
+void UARTDriver_RxRelease(uint16_t len)
+{
+    RingBuffer_IncrementRdIndex(&rx_dma_buffer, len);
+}
+
+bool UARTDriver_RxDataLost()
+{
+    if (!rx_data_lost)
+    {
+        return false;
+    }
+
+    rx_data_lost = false;
+    return true;
+}
+
+bool UARTDriver_RxLineIdle()
+{
+    if (!rx_line_idle)
+    {
+        return false;
+    }
+
+    // Clear before polling, so idle line signalled after this point is seen next time
+    rx_line_idle = false;
+    return true;
+}
+
+bool UARTDriver_RxDMAPoll()
+{
+    uint32_t completed_len;
+    uint32_t bytes_left;
+    uint8_t  status = UART1_S1;
+
+    UART_CheckRxErrors(status);
+    UART_ArmRxIdle(status);
+
+    // Retry if RX DMA completion interrupt came in between the reads
+    do
+    {
+        completed_len = rx_dma_completed_len;
+        bytes_left    = DMA_DSR_BCR_BCR(DMA_DSR_BCR0);
+    } while (completed_len != rx_dma_completed_len);
+
+    uint32_t received_len = completed_len + COUNTER_SIZE - bytes_left;
+    uint32_t new_len      = received_len - rx_received_len;
+    rx_received_len       = received_len;
+
+    if (new_len == 0)
+    {
+        return false;
+    }
+
+    if (new_len + RingBuffer_DataLen(&rx_dma_buffer) >= RX_BUFFER_LEN)
+    {
+        // DMA has overwritten unread bytes, or overwrites them with the next byte, so whole buffer
+        // content is unreliable. Write index is moved by the received length modulo buffer size
+        // to stay at the position DMA writes to
+        RingBuffer_IncrementRdIndex(&rx_dma_buffer, RingBuffer_DataLen(&rx_dma_buffer));
+        RingBuffer_Commit(&rx_dma_buffer, new_len & (RX_BUFFER_LEN - 1u));
+        RingBuffer_IncrementRdIndex(&rx_dma_buffer, RingBuffer_DataLen(&rx_dma_buffer));
+        rx_data_lost = true;
+        UARTStats_RxBytes(new_len, 0);
+        UARTStats_RxOverwrite();
+        return true;
+    }
+
+    RingBuffer_Commit(&rx_dma_buffer, new_len);
+    UARTStats_RxBytes(new_len, RingBuffer_DataLen(&rx_dma_buffer));
+    return true;
 }
 
 static bool IsTXActive()
@@ -154,21 +263,65 @@ static void DMA_OnTXCompletion()
     UART1_C2 &= C2_TX_INACTIVE;
     RingBuffer_IncrementRdIndex(&tx_dma_buffer, cur_tx_message_len);
 
-    if (!RingBuffer_isEmpty(&tx_dma_buffer))
-    {
-        DMA_TransmitRequest();
-    }
+    DMA_StartTransmission();
 }
 
 static void DMA_OnRXCompletion()
 {
     rx_dma.clearInterrupt();
     rx_dma.transferCount(COUNTER_SIZE);
+    rx_dma_completed_len += COUNTER_SIZE;
+    rx_dma.enable();
+}
 
-    if ((UART1_S1 & UART_S1_OR) != 0)
+static void UART_OnStatusInterrupt()
+{
+    // IDLE is cleared by reading S1 followed by D. Reading D here could take a byte from RX DMA,
+    // so the interrupt is disabled instead and the next RX DMA read of D completes the sequence.
+    (void)UART1_S1;
+    UART1_C2 &= ~C2_RX_IDLE_ARMED;
+    rx_line_idle = true;
+}
+
+static void UART_ArmRxIdle(uint8_t status)
+{
+    // Idle-line interrupt is enabled again only after a received byte has cleared IDLE, otherwise it
+    // would fire at once. Burst received entirely between two polls does not raise the interrupt,
+    // it is found by the DMA position check.
+    if (((status & UART_S1_IDLE) != 0) || ((UART1_C2 & C2_RX_IDLE_ARMED) != 0))
     {
-        (void)UART1_D;
+        return;
     }
 
-    rx_dma.enable();
+    __disable_irq();
+    UART1_C2 |= C2_RX_IDLE_ARMED;
+    __enable_irq();
+}
+
+static void UART_CheckRxErrors(uint8_t status)
+{
+    if ((status & S1_RX_ERROR_FLAGS) == 0)
+    {
+        return;
+    }
+
+    // Byte received with noise, framing or parity error is already in the RX buffer and cannot be told
+    // apart, so every error is reported as loss. Flags are cleared by reading S1 followed by D.
+    rx_data_lost = true;
+
+    if ((status & UART_S1_OR) != 0)
+    {
+        UARTStats_RxOverrun();
+    }
+    else
+    {
+        UARTStats_RxLineError();
+    }
+
+    // Next RX DMA read of D completes the sequence, reading D here could take a byte from DMA. Only
+    // overrun with D already emptied has to be cleared here, as no byte reaches D while OR is set.
+    if ((status & (UART_S1_OR | UART_S1_RDRF)) == UART_S1_OR)
+    {
+        (void)UART1_D;
+    }
 }
@@ -26,34 +26,97 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <stddef.h>
 #include <stdint.h>
 
+#include "RingBuffer.h"
+
 /*
  *  Initialize UART Driver.
  */
 void UARTDriver_Init(void);
 
 /*
- *  Write bytes from table to transmit buffer.
+ *  Reserve space in transmit buffer, to be filled in place by the caller.
+ *
+ *  @param len          length of space to reserve
+ *  @param p_view       [out] segments of reserved space
  *
- *  @param table        pointer to table with bytes that 
- *                      you want to write to transmit buffer 
- *  @param len          length of table
- *  
- *  @return             False if overflow in TX buffer occured, true otherwise
+ *  @return             False if reservation could overflow TX buffer, true otherwise
  */
-bool UARTDriver_WriteBytes(uint8_t *table, uint16_t len);
+bool UARTDriver_TxReserve(uint16_t len, RingBuffer_View_T *p_view);
 
 /*
- *  Read Byte from Receive Buffer.
+ *  Get free space in transmit buffer.
  *
- *  @param read_byte        pointer for received byte 
- *  
- *  @return                 False if RX buffer is empty, true otherwise 
+ *  @return             Number of bytes that can be reserved
  */
-bool UARTDriver_ReadByte(uint8_t *read_byte);
+uint16_t UARTDriver_TxFreeSpace(void);
 
 /*
- *  Function for polling received bytes from UART DMA buffer
+ *  Queue bytes written to space obtained with UARTDriver_TxReserve and start transmission.
+ *
+ *  @param len          length of written data
+ */
+void UARTDriver_TxCommit(uint16_t len);
+
+/*
+ *  Get number of received bytes waiting in Receive Buffer.
+ *
+ *  @return                 Number of received bytes
+ */
+uint16_t UARTDriver_RxDataLen(void);
+
+/*
+ *  Get received byte without removing it from Receive Buffer.
+ *
+ *  @param offset           Offset from the oldest received byte
+ *
+ *  @return                 Received byte
+ */
+uint8_t UARTDriver_RxPeekByte(uint16_t offset);
+
+/*
+ *  Get view of received data in place, without copying it out of the
+ *  Receive Buffer.
+ *
+ *  @param offset           Offset from the oldest received byte
+ *  @param len              Length of the data
+ *  @param p_view           [out] Segments of the data
+ *
+ *  @return                 False if less data was received, true otherwise
+ */
+bool UARTDriver_RxPeek(uint16_t offset, uint16_t len, RingBuffer_View_T *p_view);
+
+/*
+ *  Release bytes from Receive Buffer. Views of released bytes are no longer valid.
+ *
+ *  @param len              Number of bytes to release
+ */
+void UARTDriver_RxRelease(uint16_t len);
+
+/*
+ *  Check if received bytes were lost since the last call, either by UART overrun,
+ *  noise, framing or parity error, or because RX DMA overwrote bytes not yet released. Pending bytes are discarded
+ *  when loss is detected.
+ *
+ *  @return                 True if bytes were lost
+ */
+bool UARTDriver_RxDataLost(void);
+
+/*
+ *  Check if RX line went idle since the last call. Flag is set by idle-line interrupt
+ *  at the end of a received burst, which also wakes the core from a low-power wait.
+ *  It is only a hint, UARTDriver_RxDMAPoll still has to be called on every main loop pass.
+ *
+ *  @return                 True if a received frame may be complete
+ */
+bool UARTDriver_RxLineIdle(void);
+
+/*
+ *  Function for polling received bytes from UART DMA buffer. Idle-line interrupt is not raised
+ *  during a continuous stream or for a burst received between two calls, so it has to be called
+ *  on every main loop pass. It only reads the DMA position, so it is cheap when nothing was received.
+ *
+ *  @return                 True if new bytes were received since the last call
  */
-void UARTDriver_RxDMAPoll(void);
+bool UARTDriver_RxDMAPoll(void);
 
 #endif    //UARTDRIVER_H
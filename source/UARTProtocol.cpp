@@ -25,70 +25,21 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "CRC.h"
 #include "Log.h"
 #include "MeshTime.h"
+#include "RingBuffer.h"
 #include "UARTDriver.h"
+#include "UARTStats.h"
 #include "Utils.h"
 
-/**< UART Command Codes definitions */
-#define UART_CMD_PING_REQUEST 0x01u
-#define UART_CMD_PONG_RESPONSE 0x02u
-#define UART_CMD_INIT_DEVICE_EVENT 0x03u
-#define UART_CMD_CREATE_INSTANCES_REQUEST 0x04u
-#define UART_CMD_CREATE_INSTANCES_RESPONSE 0x05u
-#define UART_CMD_INIT_NODE_EVENT 0x06u
-#define UART_CMD_MESH_MESSAGE_REQUEST 0x07u
-#define UART_CMD_START_NODE_REQUEST 0x09u
-#define UART_CMD_START_NODE_RESPONSE 0x0Bu
-#define UART_CMD_FACTORY_RESET_REQUEST 0x0Cu
-#define UART_CMD_FACTORY_RESET_RESPONSE 0x0Du
-#define UART_CMD_FACTORY_RESET_EVENT 0x0Eu
-#define UART_CMD_MESH_MESSAGE_RESPONSE 0x0Fu
-#define UART_CMD_CURRENT_STATE_REQUEST 0x10u
-#define UART_CMD_CURRENT_STATE_RESPONSE 0x11u
-#define UART_CMD_ERROR 0x12u
-#define UART_CMD_MODEM_FIRMWARE_VERSION_REQUEST 0x13u
-#define UART_CMD_MODEM_FIRMWARE_VERSION_RESPONSE 0x14u
-#define UART_CMD_SENSOR_UPDATE_REQUEST 0x15u
-#define UART_CMD_ATTENTION_EVENT 0x16u
-#define UART_CMD_SOFTWARE_RESET_REQUEST 0x17u
-#define UART_CMD_SOFTWARE_RESET_RESPONSE 0x18u
-#define UART_CMD_SENSOR_UPDATE_RESPONSE 0x19u
-#define UART_CMD_DEVICE_UUID_REQUEST 0x1Au
-#define UART_CMD_DEVICE_UUID_RESPONSE 0x1Bu
-#define UART_CMD_SET_FAULT_REQUEST 0x1Cu
-#define UART_CMD_SET_FAULT_RESPONSE 0x1Du
-#define UART_CMD_CLEAR_FAULT_REQUEST 0x1Eu
-#define UART_CMD_CLEAR_FAULT_RESPONSE 0x1Fu
-#define UART_CMD_START_TEST_REQ 0x20u
-#define UART_CMD_START_TEST_RESP 0x21u
-#define UART_CMD_TEST_FINISHED_REQ 0x22u
-#define UART_CMD_TEST_FINISHED_RESP 0x23u
-#define UART_CMD_FIRMWARE_VERSION_SET_REQ 0x24u
-#define UART_CMD_FIRMWARE_VERSION_SET_RESP 0x25u
-#define UART_CMD_BATTERY_STATUS_SET_REQ 0x26u
-#define UART_CMD_BATTERY_STATUS_SET_RESP 0x27u
-#define UART_CMD_MESH_MESSAGE_REQUEST_1 0x28u
-#define UART_CMD_TIME_SOURCE_SET_REQ 0x29u
-#define UART_CMD_TIME_SOURCE_SET_RESP 0x2Au
-#define UART_CMD_TIME_SOURCE_GET_REQ 0x2Bu
-#define UART_CMD_TIME_SOURCE_GET_RESP 0x2Cu
-#define UART_CMD_TIME_GET_REQ 0x2Du
-#define UART_CMD_TIME_GET_RESP 0x2Eu
-
-#define UART_CMD_DFU_INIT_REQ 0x80u
-#define UART_CMD_DFU_INIT_RESP 0x81u
-#define UART_CMD_DFU_STATUS_REQ 0x82u
-#define UART_CMD_DFU_STATUS_RESP 0x83u
-#define UART_CMD_DFU_PAGE_CREATE_REQ 0x84u
-#define UART_CMD_DFU_PAGE_CREATE_RESP 0x85u
-#define UART_CMD_DFU_WRITE_DATA_EVENT 0x86u
-#define UART_CMD_DFU_PAGE_STORE_REQ 0x87u
-#define UART_CMD_DFU_PAGE_STORE_RESP 0x88u
-#define UART_CMD_DFU_STATE_CHECK_REQ 0x89u
-#define UART_CMD_DFU_STATE_CHECK_RESP 0x8Au
-#define UART_CMD_DFU_CANCEL_REQ 0x8Bu
-#define UART_CMD_DFU_CANCEL_RESP 0x8Cu
-
-#define UART_CMD_DFU_OFFSET 0x80
+/**< Minimal payload lengths of received commands */
+#define DFU_INIT_REQ_MIN_LEN 37u /**< Firmware size, SHA256 and application data length */
+#define DFU_PAGE_CREATE_REQ_MIN_LEN 4u
+#define DFU_WRITE_DATA_EVENT_MIN_LEN 1u
+#define DFU_STATE_CHECK_RESP_MIN_LEN 1u
+#define MESH_MESSAGE_REQUEST_MIN_LEN 4u   /**< Instance index, subindex and 2 bytes of opcode */
+#define MESH_MESSAGE_REQUEST_1_MIN_LEN 3u /**< Instance index, subindex and first opcode byte */
+#define ATTENTION_EVENT_MIN_LEN 1u
+#define ERROR_MIN_LEN 1u
+#define START_TEST_REQ_MAX_LEN 4u
 
 /**< Preamble definition */
 #define PREAMBLE_BYTE_1 0xAAu
@@ -106,32 +57,197 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define CRC_BYTE_1_OFFSET(len) (PAYLOAD_OFFSET + (len))
 #define CRC_BYTE_2_OFFSET(len) (PAYLOAD_OFFSET + (len) + 1)
 
+/**< Control backlog record description */
+#define RECORD_HEADER_LEN 2u
+#define RECORD_LEN(len) (RECORD_HEADER_LEN + len)
+#define RECORD_LEN_OFFSET 0u
+#define RECORD_CMD_OFFSET 1u
+
 
 typedef struct RxFrame_tag
 {
-    uint8_t len;
-    uint8_t cmd;
-    uint8_t p_payload[MAX_PAYLOAD_SIZE];
+    uint8_t           len;
+    uint8_t           cmd;
+    uint16_t          crc;
+    RingBuffer_View_T payload; /**< Payload segments, valid until the frame is released from the RX buffer */
 } RxFrame_t;
 
+typedef struct TxFrameWriter_tag
+{
+    RingBuffer_View_T view;   /**< Space reserved in the TX buffer or control backlog */
+    uint16_t          offset; /**< Number of bytes already written */
+} TxFrameWriter_t;
+
+typedef void (*UART_CommandHandler_T)(uint8_t *p_payload, uint8_t len);
+
+typedef struct UART_CommandEntry_tag
+{
+    UART_CommandHandler_T handler; /**< NULL if command is not handled */
+    uint8_t               min_len; /**< Minimal accepted payload length */
+    uint8_t               max_len; /**< Maximal accepted payload length */
+} UART_CommandEntry_T;
+
+typedef struct TxDeferredFrame_tag
+{
+    bool    used;
+    uint8_t cmd;
+    uint8_t len;
+    uint8_t payload[UART_TX_DEFERRED_PAYLOAD_MAX];
+} TxDeferredFrame_t;
+
 static bool UART_PingsEnabled = true; /**< If true, device will send and respond to pings. Default it should work */
 
+static uint16_t RxFrameCRC    = CRC16_INIT_VAL; /**< CRC16 of the frame at the beginning of the RX buffer, updated as bytes arrive */
+static uint16_t RxFrameCRCLen = 0;              /**< Number of frame bytes already included in RxFrameCRC */
+
+static bool RxBacklog = false; /**< True if frames may be left in the RX buffer after the last loop pass */
+
+static uint8_t      TxControlBuf[UART_TX_CONTROL_BACKLOG_LEN];
+static RingBuffer_T TxControlBacklog; /**< Control frames waiting for TX buffer space, oldest first */
+
+static TxDeferredFrame_t TxDeferredFrames[UART_TX_DEFERRED_SLOTS]; /**< Telemetry frames waiting for TX buffer space, oldest first */
+static uint32_t          TxDropCount = 0;                          /**< Number of dropped frames */
+
 /*
- *  Received data from UART
+ *  Find next valid frame in the RX buffer. The frame is validated in place and stays
+ *  in the RX buffer until released with UARTDriver_RxRelease. Bytes that do not form
+ *  a valid frame are released.
  *
- *  @param rx_frame    Pointer to frame to be filled with received data
+ *  @param rx_frame    Pointer to frame to be filled with received frame description
  *  @return            True if frame's CRC is valid, false otherwise
  */
 static bool ExtractFrameFromBuffer(RxFrame_t *rx_frame);
 
 /*
- *  Send message over UART
+ *  Dispatch received frame to its command handler
+ *
+ *  @param rx_frame    Pointer to received frame
+ */
+static void UARTInternal_ProcessFrame(RxFrame_t *rx_frame);
+
+/*
+ *  Dispatch received frame that wraps around the end of the RX buffer.
+ *  Payload is linearized on the stack before being passed to the handler.
+ *
+ *  @param rx_frame    Pointer to received frame
+ */
+static void UARTInternal_ProcessWrappedFrame(RxFrame_t *rx_frame);
+
+/*
+ *  Dispatch command to its handler, if payload length is in the range accepted by the handler
+ *
+ *  @param cmd         Command code
+ *  @param p_payload   Pointer to command payload
+ *  @param len         Payload len
+ */
+static void UARTInternal_DispatchCommand(uint8_t cmd, uint8_t *p_payload, uint8_t len);
+
+/*
+ *  Process Ping Request command
+ *
+ *  @param p_payload   Pointer to command payload
+ *  @param len         Payload len
+ */
+static void UARTInternal_ProcessPingRequest(uint8_t *p_payload, uint8_t len);
+
+/*
+ *  Process Firmware Version Set Response command
+ *
+ *  @param p_payload   Pointer to command payload
+ *  @param len         Payload len
+ */
+static void UARTInternal_ProcessFirmwareVersionSetResponse(uint8_t *p_payload, uint8_t len);
+
+/*
+ *  Process Factory Reset Event command
+ *
+ *  @param p_payload   Pointer to command payload
+ *  @param len         Payload len
+ */
+static void UARTInternal_ProcessFactoryResetEvent(uint8_t *p_payload, uint8_t len);
+
+/*
+ *  Send control message over UART. Message that does not fit in TX buffer is queued
+ *  in control backlog and sent from the main loop, it is dropped only if the backlog
+ *  is full too. Must only be called from the main loop, the TX buffer has a single producer.
  *
  *  @param len        Message length
  *  @param cmd        Message command
  *  @param p_payload  Message payload
+ *  @return           TX status
  */
-static void UARTInternal_Send(uint8_t len, uint8_t cmd, uint8_t *p_payload);
+static UART_TxStatus_T UARTInternal_Send(uint8_t len, uint8_t cmd, uint8_t *p_payload);
+
+/*
+ *  Store control message in control backlog to be sent later
+ *
+ *  @param len        Message length
+ *  @param cmd        Message command
+ *  @param p_payload  Message payload
+ *  @return           TX status
+ */
+static UART_TxStatus_T UARTInternal_DeferControl(uint8_t len, uint8_t cmd, uint8_t *p_payload);
+
+/*
+ *  Send control messages from control backlog, oldest first, while TX buffer space allows
+ */
+static void UARTInternal_SendDeferredControl(void);
+
+/*
+ *  Send telemetry message over UART. Message is sent only if it leaves
+ *  UART_TX_CONTROL_RESERVE bytes free in TX buffer, otherwise it is deferred.
+ *
+ *  @param len        Message length
+ *  @param cmd        Message command
+ *  @param p_payload  Message payload
+ *  @param key_len    Number of leading payload bytes identifying the value, deferred
+ *                    message with the same cmd and key is replaced
+ *  @return           TX status
+ */
+static UART_TxStatus_T UARTInternal_SendTelemetry(uint8_t len, uint8_t cmd, uint8_t *p_payload, uint8_t key_len);
+
+/*
+ *  Check if telemetry message fits in TX buffer without using control reserve
+ *
+ *  @param len        Message length
+ *  @return           True if message can be sent
+ */
+static bool UARTInternal_IsTelemetryAllowed(uint8_t len);
+
+/*
+ *  Store telemetry message to be sent later
+ *
+ *  @param len        Message length
+ *  @param cmd        Message command
+ *  @param p_payload  Message payload
+ *  @param key_len    Number of leading payload bytes identifying the value
+ *  @return           TX status
+ */
+static UART_TxStatus_T UARTInternal_DeferTelemetry(uint8_t len, uint8_t cmd, uint8_t *p_payload, uint8_t key_len);
+
+/*
+ *  Send deferred telemetry messages, oldest first, while TX buffer space allows
+ */
+static void UARTInternal_SendDeferredTelemetry(void);
+
+/*
+ *  Write message to TX buffer
+ *
+ *  @param len        Message length
+ *  @param cmd        Message command
+ *  @param p_payload  Message payload
+ *  @return           False if there is no space in TX buffer, true otherwise
+ */
+static bool UARTInternal_TryWriteFrame(uint8_t len, uint8_t cmd, uint8_t *p_payload);
+
+/*
+ *  Write data to space reserved in the TX buffer or control backlog
+ *
+ *  @param p_writer   Pointer to frame writer
+ *  @param p_data     Data to write
+ *  @param len        Data length
+ */
+static void UARTInternal_TxWrite(TxFrameWriter_t *p_writer, const uint8_t *p_data, uint16_t len);
 
 /*
  *  Print debug message
@@ -153,9 +269,114 @@ static void PrintDebug(const char *dir, uint8_t len, uint8_t cmd, uint8_t *buf,
  */
 static uint16_t UARTInternal_CalcCRC16(uint8_t len, uint8_t cmd, uint8_t *data);
 
+/*
+ *  Update CRC16 of the frame at the beginning of the RX buffer with bytes
+ *  received since the last call
+ *
+ *  @param len        Frame payload length
+ *  @param available  Number of bytes available in the RX buffer
+ */
+static void UARTInternal_UpdateRxFrameCRC16(uint8_t len, uint16_t available);
+
+/*
+ *  Release bytes from the RX buffer and restart frame CRC calculation
+ *
+ *  @param len        Number of bytes to release
+ */
+static void UARTInternal_RxRelease(uint16_t len);
+
+/*
+ *  Drop the first preamble byte of a frame that turned out to be invalid. Following
+ *  bytes are scanned again, as they may hold the start of a valid frame.
+ */
+static void UARTInternal_RxResync(void);
+
+/*
+ *  Release bytes preceding the next candidate preamble byte, searching contiguous
+ *  part of the RX buffer with memchr
+ *
+ *  @param available  Number of bytes available in the RX buffer
+ */
+static void UARTInternal_RxSkipToPreamble(uint16_t available);
+
+#define HANDLER(handler, min_len, max_len) {(handler), (min_len), (max_len)}
+#define NO_HANDLER {NULL, 0, 0}
+
+/**< Handlers of received commands, indexed by command code */
+static constexpr UART_CommandEntry_T CommandHandlers[] = {
+    NO_HANDLER,                                                                                                 /* 0x00 */
+    HANDLER(UARTInternal_ProcessPingRequest, 0, MAX_PAYLOAD_SIZE),                                              /* 0x01 PingRequest */
+    NO_HANDLER,                                                                                                 /* 0x02 */
+    HANDLER(ProcessEnterInitDevice, 0, MAX_PAYLOAD_SIZE),                                                       /* 0x03 InitDeviceEvent */
+    NO_HANDLER,                                                                                                 /* 0x04 */
+    HANDLER(ProcessEnterDevice, 0, MAX_PAYLOAD_SIZE),                                                           /* 0x05 CreateInstancesResponse */
+    HANDLER(ProcessEnterInitNode, 0, MAX_PAYLOAD_SIZE),                                                         /* 0x06 InitNodeEvent */
+    HANDLER(ProcessMeshCommand, MESH_MESSAGE_REQUEST_MIN_LEN, MAX_PAYLOAD_SIZE),                                /* 0x07 MeshMessageRequest */
+    NO_HANDLER,                                                                                                 /* 0x08 */
+    NO_HANDLER,                                                                                                 /* 0x09 */
+    NO_HANDLER,                                                                                                 /* 0x0A */
+    HANDLER(ProcessEnterNode, 0, MAX_PAYLOAD_SIZE),                                                             /* 0x0B StartNodeResponse */
+    NO_HANDLER,                                                                                                 /* 0x0C */
+    NO_HANDLER,                                                                                                 /* 0x0D */
+    HANDLER(UARTInternal_ProcessFactoryResetEvent, 0, MAX_PAYLOAD_SIZE),                                        /* 0x0E FactoryResetEvent */
+    NO_HANDLER,                                                                                                 /* 0x0F */
+    NO_HANDLER,                                                                                                 /* 0x10 */
+    NO_HANDLER,                                                                                                 /* 0x11 */
+    HANDLER(ProcessError, ERROR_MIN_LEN, MAX_PAYLOAD_SIZE),                                                     /* 0x12 Error */
+    NO_HANDLER,                                                                                                 /* 0x13 */
+    HANDLER(ProcessModemFirmwareVersion, 0, MAX_PAYLOAD_SIZE),                                                  /* 0x14 ModemFirmwareVersionResponse */
+    NO_HANDLER,                                                                                                 /* 0x15 */
+    HANDLER(ProcessAttention, ATTENTION_EVENT_MIN_LEN, MAX_PAYLOAD_SIZE),                                       /* 0x16 AttentionEvent */
+    NO_HANDLER,                                                                                                 /* 0x17 */
+    NO_HANDLER,                                                                                                 /* 0x18 */
+    NO_HANDLER,                                                                                                 /* 0x19 */
+    NO_HANDLER,                                                                                                 /* 0x1A */
+    NO_HANDLER,                                                                                                 /* 0x1B */
+    NO_HANDLER,                                                                                                 /* 0x1C */
+    NO_HANDLER,                                                                                                 /* 0x1D */
+    NO_HANDLER,                                                                                                 /* 0x1E */
+    NO_HANDLER,                                                                                                 /* 0x1F */
+    HANDLER(ProcessStartTest, 0, START_TEST_REQ_MAX_LEN),                                                       /* 0x20 StartTestRequest */
+    NO_HANDLER,                                                                                                 /* 0x21 */
+    NO_HANDLER,                                                                                                 /* 0x22 */
+    NO_HANDLER,                                                                                                 /* 0x23 */
+    NO_HANDLER,                                                                                                 /* 0x24 */
+    HANDLER(UARTInternal_ProcessFirmwareVersionSetResponse, 0, MAX_PAYLOAD_SIZE),                               /* 0x25 FirmwareVersionSetResponse */
+    NO_HANDLER,                                                                                                 /* 0x26 */
+    NO_HANDLER,                                                                                                 /* 0x27 */
+    HANDLER(ProcessMeshMessageRequest1, MESH_MESSAGE_REQUEST_1_MIN_LEN, MAX_PAYLOAD_SIZE),                      /* 0x28 MeshMessageRequest1 */
+    HANDLER(MeshTime_ProcessTimeSourceSetRequest, sizeof(TimeSourceSetReq_T), sizeof(TimeSourceSetReq_T)),     /* 0x29 TimeSourceSetRequest */
+    NO_HANDLER,                                                                                                 /* 0x2A */
+    HANDLER(MeshTime_ProcessTimeSourceGetRequest, sizeof(TimeSourceGetReq_T), sizeof(TimeSourceGetReq_T)),     /* 0x2B TimeSourceGetRequest */
+    NO_HANDLER,                                                                                                 /* 0x2C */
+    NO_HANDLER,                                                                                                 /* 0x2D */
+    HANDLER(MeshTime_ProcessTimeGetResponse, sizeof(TimeGetResp_T), sizeof(TimeGetResp_T)),                     /* 0x2E TimeGetResponse */
+};
+
+/**< Handlers of received DFU commands, indexed by command code - UART_CMD_DFU_OFFSET */
+static constexpr UART_CommandEntry_T DfuCommandHandlers[] = {
+    HANDLER(ProcessDfuInitRequest, DFU_INIT_REQ_MIN_LEN, MAX_PAYLOAD_SIZE),                /* 0x80 DfuInitRequest */
+    NO_HANDLER,                                                                            /* 0x81 */
+    HANDLER(ProcessDfuStatusRequest, 0, MAX_PAYLOAD_SIZE),                                 /* 0x82 DfuStatusRequest */
+    NO_HANDLER,                                                                            /* 0x83 */
+    HANDLER(ProcessDfuPageCreateRequest, DFU_PAGE_CREATE_REQ_MIN_LEN, MAX_PAYLOAD_SIZE),   /* 0x84 DfuPageCreateRequest */
+    NO_HANDLER,                                                                            /* 0x85 */
+    HANDLER(ProcessDfuWriteDataEvent, DFU_WRITE_DATA_EVENT_MIN_LEN, MAX_PAYLOAD_SIZE),     /* 0x86 DfuWriteDataEvent */
+    HANDLER(ProcessDfuPageStoreRequest, 0, MAX_PAYLOAD_SIZE),                              /* 0x87 DfuPageStoreRequest */
+    NO_HANDLER,                                                                            /* 0x88 */
+    NO_HANDLER,                                                                            /* 0x89 */
+    HANDLER(ProcessDfuStateCheckResponse, DFU_STATE_CHECK_RESP_MIN_LEN, MAX_PAYLOAD_SIZE), /* 0x8A DfuStateCheckResponse */
+    NO_HANDLER,                                                                            /* 0x8B */
+    HANDLER(ProcessDfuCancelResponse, 0, MAX_PAYLOAD_SIZE),                                /* 0x8C DfuCancelResponse */
+};
+
+static_assert(ARRAY_SIZE(CommandHandlers) == UART_CMD_TIME_GET_RESP + 1, "CommandHandlers must cover all command codes");
+static_assert(ARRAY_SIZE(DfuCommandHandlers) == UART_CMD_DFU_CANCEL_RESP - UART_CMD_DFU_OFFSET + 1, "DfuCommandHandlers must cover all DFU command codes");
+
 void UART_Init(void)
 {
     UARTDriver_Init();
+    RINGBUFFER_INIT(&TxControlBacklog, TxControlBuf);
 }
 
 void UART_EnablePings(void)
@@ -170,372 +391,538 @@ void UART_DisablePings(void)
     UART_PingsEnabled = false;
 }
 
-void UART_SendPingRequest(void)
+UART_TxStatus_T UART_SendPingRequest(void)
 {
     if (UART_PingsEnabled)
     {
-        UARTInternal_Send(0, UART_CMD_PING_REQUEST, NULL);
+        return UARTInternal_SendTelemetry(0, UART_CMD_PING_REQUEST, NULL, 0);
     }
+
+    return UART_TX_STATUS_DROPPED;
 }
 
-void UART_SendPongResponse(uint8_t *p_payload, uint8_t len)
+UART_TxStatus_T UART_SendPongResponse(uint8_t *p_payload, uint8_t len)
 {
     if (UART_PingsEnabled)
     {
-        UARTInternal_Send(len, UART_CMD_PONG_RESPONSE, p_payload);
+        return UARTInternal_Send(len, UART_CMD_PONG_RESPONSE, p_payload);
     }
+
+    return UART_TX_STATUS_DROPPED;
 }
 
-void UART_SendSoftwareResetRequest(void)
+UART_TxStatus_T UART_SendSoftwareResetRequest(void)
 {
-    UARTInternal_Send(0, UART_CMD_SOFTWARE_RESET_REQUEST, NULL);
+    return UARTInternal_Send(0, UART_CMD_SOFTWARE_RESET_REQUEST, NULL);
 }
 
-void UART_SendCreateInstancesRequest(uint8_t *model_id, uint8_t len)
+UART_TxStatus_T UART_SendCreateInstancesRequest(uint8_t *model_id, uint8_t len)
 {
-    UARTInternal_Send(len, UART_CMD_CREATE_INSTANCES_REQUEST, model_id);
+    return UARTInternal_Send(len, UART_CMD_CREATE_INSTANCES_REQUEST, model_id);
 }
 
-void UART_SendMeshMessageRequest(uint8_t *p_payload, uint8_t len)
+UART_TxStatus_T UART_SendMeshMessageRequest(uint8_t *p_payload, uint8_t len)
 {
-    UARTInternal_Send(len, UART_CMD_MESH_MESSAGE_REQUEST, p_payload);
+    return UARTInternal_Send(len, UART_CMD_MESH_MESSAGE_REQUEST, p_payload);
 }
 
-void UART_SendMeshMessageRequest1(uint8_t *p_payload, uint8_t len)
+UART_TxStatus_T UART_SendMeshMessageRequest1(uint8_t *p_payload, uint8_t len)
 {
-    UARTInternal_Send(len, UART_CMD_MESH_MESSAGE_REQUEST_1, p_payload);
+    return UARTInternal_Send(len, UART_CMD_MESH_MESSAGE_REQUEST_1, p_payload);
 }
 
-void UART_SendSensorUpdateRequest(uint8_t *p_payload, uint8_t len)
+UART_TxStatus_T UART_SendSensorUpdateRequest(uint8_t *p_payload, uint8_t len)
 {
-    UARTInternal_Send(len, UART_CMD_SENSOR_UPDATE_REQUEST, p_payload);
+    // Instance index and property ID identify the sensor value
+    return UARTInternal_SendTelemetry(len, UART_CMD_SENSOR_UPDATE_REQUEST, p_payload, 3);
 }
 
-void UART_StartNodeRequest(void)
+UART_TxStatus_T UART_StartNodeRequest(void)
 {
-    UARTInternal_Send(0, UART_CMD_START_NODE_REQUEST, NULL);
+    return UARTInternal_Send(0, UART_CMD_START_NODE_REQUEST, NULL);
 }
 
-void UART_ModemFirmwareVersionRequest(void)
+UART_TxStatus_T UART_ModemFirmwareVersionRequest(void)
 {
-    UARTInternal_Send(0, UART_CMD_MODEM_FIRMWARE_VERSION_REQUEST, NULL);
+    return UARTInternal_Send(0, UART_CMD_MODEM_FIRMWARE_VERSION_REQUEST, NULL);
 }
 
-void UART_SendSetFaultRequest(uint8_t *p_payload, uint8_t len)
+UART_TxStatus_T UART_SendSetFaultRequest(uint8_t *p_payload, uint8_t len)
 {
-    UARTInternal_Send(len, UART_CMD_SET_FAULT_REQUEST, p_payload);
+    return UARTInternal_Send(len, UART_CMD_SET_FAULT_REQUEST, p_payload);
 }
 
-void UART_SendClearFaultRequest(uint8_t *p_payload, uint8_t len)
+UART_TxStatus_T UART_SendClearFaultRequest(uint8_t *p_payload, uint8_t len)
 {
-    UARTInternal_Send(len, UART_CMD_CLEAR_FAULT_REQUEST, p_payload);
+    return UARTInternal_Send(len, UART_CMD_CLEAR_FAULT_REQUEST, p_payload);
 }
 
-void UART_SendTestStartResponse(uint8_t *p_payload, uint8_t len)
+UART_TxStatus_T UART_SendTestStartResponse(uint8_t *p_payload, uint8_t len)
 {
-    UARTInternal_Send(len, UART_CMD_START_TEST_RESP, p_payload);
+    return UARTInternal_Send(len, UART_CMD_START_TEST_RESP, p_payload);
 }
 
-void UART_SendTestFinishedRequest(uint8_t *p_payload, uint8_t len)
+UART_TxStatus_T UART_SendTestFinishedRequest(uint8_t *p_payload, uint8_t len)
 {
-    UARTInternal_Send(len, UART_CMD_TEST_FINISHED_REQ, p_payload);
+    return UARTInternal_Send(len, UART_CMD_TEST_FINISHED_REQ, p_payload);
 }
 
-void UART_SendDfuInitResponse(uint8_t *p_payload, uint8_t len)
+UART_TxStatus_T UART_SendDfuInitResponse(uint8_t *p_payload, uint8_t len)
 {
-    UARTInternal_Send(len, UART_CMD_DFU_INIT_RESP, p_payload);
+    return UARTInternal_Send(len, UART_CMD_DFU_INIT_RESP, p_payload);
 }
 
-void UART_SendDfuStatusResponse(uint8_t *p_payload, uint8_t len)
+UART_TxStatus_T UART_SendDfuStatusResponse(uint8_t *p_payload, uint8_t len)
 {
-    UARTInternal_Send(len, UART_CMD_DFU_STATUS_RESP, p_payload);
+    return UARTInternal_Send(len, UART_CMD_DFU_STATUS_RESP, p_payload);
 }
 
-void UART_SendDfuPageCreateResponse(uint8_t *p_payload, uint8_t len)
+UART_TxStatus_T UART_SendDfuPageCreateResponse(uint8_t *p_payload, uint8_t len)
 {
-    UARTInternal_Send(len, UART_CMD_DFU_PAGE_CREATE_RESP, p_payload);
+    return UARTInternal_Send(len, UART_CMD_DFU_PAGE_CREATE_RESP, p_payload);
 }
 
-void UART_SendDfuPageStoreResponse(uint8_t *p_payload, uint8_t len)
+UART_TxStatus_T UART_SendDfuPageStoreResponse(uint8_t *p_payload, uint8_t len)
 {
-    UARTInternal_Send(len, UART_CMD_DFU_PAGE_STORE_RESP, p_payload);
+    return UARTInternal_Send(len, UART_CMD_DFU_PAGE_STORE_RESP, p_payload);
 }
 
-void UART_SendDfuStateCheckRequest(uint8_t *p_payload, uint8_t len)
+UART_TxStatus_T UART_SendDfuStateCheckRequest(uint8_t *p_payload, uint8_t len)
 {
-    UARTInternal_Send(len, UART_CMD_DFU_STATE_CHECK_REQ, p_payload);
+    return UARTInternal_Send(len, UART_CMD_DFU_STATE_CHECK_REQ, p_payload);
 }
 
-void UART_SendDfuCancelRequest(uint8_t *p_payload, uint8_t len)
+UART_TxStatus_T UART_SendDfuCancelRequest(uint8_t *p_payload, uint8_t len)
 {
-    UARTInternal_Send(len, UART_CMD_DFU_CANCEL_REQ, p_payload);
+    return UARTInternal_Send(len, UART_CMD_DFU_CANCEL_REQ, p_payload);
 }
 
-void UART_SendFirmwareVersionSetRequest(uint8_t *p_payload, uint8_t len)
+UART_TxStatus_T UART_SendFirmwareVersionSetRequest(uint8_t *p_payload, uint8_t len)
 {
-    UARTInternal_Send(len, UART_CMD_FIRMWARE_VERSION_SET_REQ, p_payload);
+    return UARTInternal_Send(len, UART_CMD_FIRMWARE_VERSION_SET_REQ, p_payload);
 }
 
 void UART_ProcessIncomingCommand(void)
 {
-    static RxFrame_t rx_frame;
+    RxFrame_t rx_frame;
 
-    UARTDriver_RxDMAPoll();
+    UARTInternal_SendDeferredControl();
+    UARTInternal_SendDeferredTelemetry();
 
-    if (!ExtractFrameFromBuffer(&rx_frame))
+    bool is_rx_line_idle = UARTDriver_RxLineIdle();
+    bool is_rx_new_data  = UARTDriver_RxDMAPoll();
+
+    if (UARTDriver_RxDataLost())
+    {
+        LOG_INFO("UART RX data lost");
+        RxFrameCRC    = CRC16_INIT_VAL;
+        RxFrameCRCLen = 0;
+        ProcessDfuRxDataLoss();
+    }
+
+    if (!is_rx_line_idle && !is_rx_new_data && !RxBacklog)
     {
         return;
     }
 
-    switch (rx_frame.cmd)
+    UARTStats_RxParsePass();
+    RxBacklog = false;
+
+    for (size_t frames = 0; frames < UART_RX_FRAMES_PER_LOOP; frames++)
     {
-        case UART_CMD_PING_REQUEST:
-        {
-            UART_SendPongResponse(rx_frame.p_payload, rx_frame.len);
-            break;
-        }
-        case UART_CMD_INIT_DEVICE_EVENT:
-        {
-            ProcessEnterInitDevice(rx_frame.p_payload, rx_frame.len);
-            break;
-        }
-        case UART_CMD_CREATE_INSTANCES_RESPONSE:
-        {
-            ProcessEnterDevice(rx_frame.p_payload, rx_frame.len);
-            break;
-        }
-        case UART_CMD_INIT_NODE_EVENT:
-        {
-            ProcessEnterInitNode(rx_frame.p_payload, rx_frame.len);
-            break;
-        }
-        case UART_CMD_START_NODE_RESPONSE:
-        {
-            ProcessEnterNode(rx_frame.p_payload, rx_frame.len);
-            break;
-        }
-        case UART_CMD_MESH_MESSAGE_REQUEST:
-        {
-            ProcessMeshCommand(rx_frame.p_payload, rx_frame.len);
-            break;
-        }
-        case UART_CMD_MESH_MESSAGE_REQUEST_1:
-        {
-            ProcessMeshMessageRequest1(rx_frame.p_payload, rx_frame.len);
-            break;
-        }
-        case UART_CMD_ATTENTION_EVENT:
-        {
-            ProcessAttention(rx_frame.p_payload, rx_frame.len);
-            break;
-        }
-        case UART_CMD_ERROR:
-        {
-            ProcessError(rx_frame.p_payload, rx_frame.len);
-            break;
-        }
-        case UART_CMD_MODEM_FIRMWARE_VERSION_RESPONSE:
-        {
-            ProcessModemFirmwareVersion(rx_frame.p_payload, rx_frame.len);
-            break;
-        }
-        case UART_CMD_START_TEST_REQ:
-        {
-            ProcessStartTest(rx_frame.p_payload, rx_frame.len);
-            break;
-        }
-        case UART_CMD_DFU_INIT_REQ:
-        {
-            ProcessDfuInitRequest(rx_frame.p_payload, rx_frame.len);
-            break;
-        }
-        case UART_CMD_DFU_STATUS_REQ:
-        {
-            ProcessDfuStatusRequest(rx_frame.p_payload, rx_frame.len);
-            break;
-        }
-        case UART_CMD_DFU_PAGE_CREATE_REQ:
-        {
-            ProcessDfuPageCreateRequest(rx_frame.p_payload, rx_frame.len);
-            break;
-        }
-        case UART_CMD_DFU_WRITE_DATA_EVENT:
+        if (!ExtractFrameFromBuffer(&rx_frame))
         {
-            ProcessDfuWriteDataEvent(rx_frame.p_payload, rx_frame.len);
-            break;
-        }
-        case UART_CMD_DFU_PAGE_STORE_REQ:
-        {
-            ProcessDfuPageStoreRequest(rx_frame.p_payload, rx_frame.len);
-            break;
-        }
-        case UART_CMD_DFU_STATE_CHECK_RESP:
-        {
-            ProcessDfuStateCheckResponse(rx_frame.p_payload, rx_frame.len);
-            break;
-        }
-        case UART_CMD_DFU_CANCEL_RESP:
-        {
-            ProcessDfuCancelResponse(rx_frame.p_payload, rx_frame.len);
-            break;
-        }
-        case UART_CMD_FIRMWARE_VERSION_SET_RESP:
-        {
-            ProcessFirmwareVersionSetResponse();
-            break;
-        }
-        case UART_CMD_FACTORY_RESET_EVENT:
-        {
-            ProcessFactoryResetEvent();
-            break;
-        }
-        case UART_CMD_TIME_SOURCE_SET_REQ:
-        {
-            MeshTime_ProcessTimeSourceSetRequest(rx_frame.p_payload, rx_frame.len);
-            break;
-        }
-        case UART_CMD_TIME_SOURCE_GET_REQ:
-        {
-            MeshTime_ProcessTimeSourceGetRequest(rx_frame.p_payload, rx_frame.len);
-            break;
-        }
-        case UART_CMD_TIME_GET_RESP:
-        {
-            MeshTime_ProcessTimeGetResponse(rx_frame.p_payload, rx_frame.len);
-            break;
+            return;
         }
+
+        UARTStats_RxFrame(rx_frame.cmd);
+        UARTInternal_ProcessFrame(&rx_frame);
+        UARTInternal_RxRelease(PACKET_LEN(rx_frame.len));
     }
+
+    RxBacklog = true;
 }
 
-static bool ExtractFrameFromBuffer(RxFrame_t *rx_frame)
+static void UARTInternal_ProcessFrame(RxFrame_t *rx_frame)
+{
+    if (rx_frame->payload.second_len != 0)
+    {
+        UARTInternal_ProcessWrappedFrame(rx_frame);
+        return;
+    }
+
+    PrintDebug("Received", rx_frame->len, rx_frame->cmd, rx_frame->payload.p_first, rx_frame->crc);
+    UARTInternal_DispatchCommand(rx_frame->cmd, rx_frame->payload.p_first, rx_frame->len);
+}
+
+static __attribute__((noinline)) void UARTInternal_ProcessWrappedFrame(RxFrame_t *rx_frame)
+{
+    uint8_t payload[MAX_PAYLOAD_SIZE];
+
+    memcpy(payload, rx_frame->payload.p_first, rx_frame->payload.first_len);
+    memcpy(payload + rx_frame->payload.first_len, rx_frame->payload.p_second, rx_frame->payload.second_len);
+
+    PrintDebug("Received", rx_frame->len, rx_frame->cmd, payload, rx_frame->crc);
+    UARTInternal_DispatchCommand(rx_frame->cmd, payload, rx_frame->len);
+}
+
+static void UARTInternal_DispatchCommand(uint8_t cmd, uint8_t *p_payload, uint8_t len)
 {
-    bool            isCRCValid = false;
-    static uint16_t crc        = 0;
-    static size_t   count      = 0;
-    uint8_t         received_byte;
+    const UART_CommandEntry_T *p_entry;
 
-    if (!UARTDriver_ReadByte(&received_byte))
+    if (cmd < ARRAY_SIZE(CommandHandlers))
     {
-        return isCRCValid;
+        p_entry = &CommandHandlers[cmd];
+    }
+    else if ((cmd >= UART_CMD_DFU_OFFSET) && (cmd < UART_CMD_DFU_OFFSET + ARRAY_SIZE(DfuCommandHandlers)))
+    {
+        p_entry = &DfuCommandHandlers[cmd - UART_CMD_DFU_OFFSET];
+    }
+    else
+    {
+        UARTStats_UnhandledCmd();
+        return;
     }
 
-    if (count == PREAMBLE_BYTE_1_OFFSET)
+    if (p_entry->handler == NULL)
+    {
+        UARTStats_UnhandledCmd();
+        return;
+    }
+
+    if ((len < p_entry->min_len) || (len > p_entry->max_len))
+    {
+        LOG_INFO("Invalid payload length %d of cmd 0x%02X", len, cmd);
+        UARTStats_RejectedLength();
+        return;
+    }
+
+    uint32_t start = UARTStats_HandlerStart();
+    p_entry->handler(p_payload, len);
+    UARTStats_HandlerEnd(cmd, start);
+}
+
+static void UARTInternal_ProcessPingRequest(uint8_t *p_payload, uint8_t len)
+{
+    UART_SendPongResponse(p_payload, len);
+}
+
+static void UARTInternal_ProcessFirmwareVersionSetResponse(uint8_t *p_payload, uint8_t len)
+{
+    UNUSED(p_payload);
+    UNUSED(len);
+
+    ProcessFirmwareVersionSetResponse();
+}
+
+static void UARTInternal_ProcessFactoryResetEvent(uint8_t *p_payload, uint8_t len)
+{
+    UNUSED(p_payload);
+    UNUSED(len);
+
+    ProcessFactoryResetEvent();
+}
+
+static bool ExtractFrameFromBuffer(RxFrame_t *rx_frame)
+{
+    uint16_t available;
+
+    while ((available = UARTDriver_RxDataLen()) > PREAMBLE_BYTE_1_OFFSET)
     {
-        if (received_byte == PREAMBLE_BYTE_1)
+        if (UARTDriver_RxPeekByte(PREAMBLE_BYTE_1_OFFSET) != PREAMBLE_BYTE_1)
         {
-            count++;
+            UARTInternal_RxSkipToPreamble(available);
+            continue;
         }
-        else
+
+        if (available <= PREAMBLE_BYTE_2_OFFSET)
         {
-            count = 0;
+            return false;
         }
-    }
-    else if (count == PREAMBLE_BYTE_2_OFFSET)
-    {
-        if (received_byte == PREAMBLE_BYTE_2)
+
+        if (UARTDriver_RxPeekByte(PREAMBLE_BYTE_2_OFFSET) != PREAMBLE_BYTE_2)
         {
-            count++;
+            UARTInternal_RxResync();
+            continue;
         }
-        else
+
+        if (available <= LEN_OFFSET)
         {
-            count = 0;
+            return false;
         }
-    }
-    else if (count == LEN_OFFSET)
-    {
-        if (received_byte <= MAX_PAYLOAD_SIZE)
+
+        rx_frame->len = UARTDriver_RxPeekByte(LEN_OFFSET);
+        if (rx_frame->len > MAX_PAYLOAD_SIZE)
         {
-            rx_frame->len = received_byte;
-            count++;
+            UARTStats_BadLength();
+            UARTInternal_RxResync();
+            continue;
         }
-        else
+
+        UARTInternal_UpdateRxFrameCRC16(rx_frame->len, available);
+
+        if (available < PACKET_LEN(rx_frame->len))
         {
-            count = 0;
+            UARTStats_RxPartialFrame();
+            return false;
         }
-    }
-    else if (count == CMD_OFFSET)
-    {
-        rx_frame->cmd = received_byte;
-        count++;
-    }
-    else if ((CMD_OFFSET < count) && (count < CRC_BYTE_1_OFFSET(rx_frame->len)))
-    {
-        rx_frame->p_payload[count - PAYLOAD_OFFSET] = received_byte;
-        count++;
-    }
-    else if (count == CRC_BYTE_1_OFFSET(rx_frame->len))
-    {
-        crc = received_byte;
-        count++;
-    }
-    else if (count == CRC_BYTE_2_OFFSET(rx_frame->len))
-    {
-        crc += ((uint16_t)received_byte) << 8;
-        isCRCValid = (crc == UARTInternal_CalcCRC16(rx_frame->len, rx_frame->cmd, rx_frame->p_payload));
-        count      = 0;
-    }
 
-    if (isCRCValid)
-    {
-        PrintDebug("Received", rx_frame->len, rx_frame->cmd, rx_frame->p_payload, crc);
+        rx_frame->cmd = UARTDriver_RxPeekByte(CMD_OFFSET);
+        rx_frame->crc = UARTDriver_RxPeekByte(CRC_BYTE_1_OFFSET(rx_frame->len));
+        rx_frame->crc += ((uint16_t)UARTDriver_RxPeekByte(CRC_BYTE_2_OFFSET(rx_frame->len))) << 8;
+        UARTDriver_RxPeek(PAYLOAD_OFFSET, rx_frame->len, &rx_frame->payload);
+
+        if (rx_frame->crc == RxFrameCRC)
+        {
+            return true;
+        }
+
+        UARTStats_CrcError();
+        UARTInternal_RxResync();
     }
 
-    return isCRCValid;
+    return false;
 }
 
-void UART_SendTimeSourceGetResponse(uint8_t instance_idx, TimeDate *time)
+UART_TxStatus_T UART_SendTimeSourceGetResponse(uint8_t instance_idx, TimeDate *time)
 {
-    TimeSourceGetResp_T msg = {0};
+    TimeSourceGetResp_T msg = {};
 
     msg.instance_index = instance_idx;
     msg.date           = *time;
 
-    UARTInternal_Send(sizeof(msg), UART_CMD_TIME_SOURCE_GET_RESP, (uint8_t *)&msg);
+    return UARTInternal_Send(sizeof(msg), UART_CMD_TIME_SOURCE_GET_RESP, (uint8_t *)&msg);
 }
 
-void UART_SendTimeSourceSetResponse(uint8_t instance_idx)
+UART_TxStatus_T UART_SendTimeSourceSetResponse(uint8_t instance_idx)
 {
     TimeSourceSetResp_T msg = {0};
 
     msg.instance_index = instance_idx;
 
-    UARTInternal_Send(sizeof(msg), UART_CMD_TIME_SOURCE_SET_RESP, (uint8_t *)&msg);
+    return UARTInternal_Send(sizeof(msg), UART_CMD_TIME_SOURCE_SET_RESP, (uint8_t *)&msg);
 }
 
-void UART_SendTimeGetRequest(uint8_t instance_idx)
+UART_TxStatus_T UART_SendTimeGetRequest(uint8_t instance_idx)
 {
     TimeGetReq_T msg = {0};
 
     msg.instance_index = instance_idx;
 
-    UARTInternal_Send(sizeof(msg), UART_CMD_TIME_GET_REQ, (uint8_t *)&msg);
+    return UARTInternal_Send(sizeof(msg), UART_CMD_TIME_GET_REQ, (uint8_t *)&msg);
 }
 
-void UART_SendBatteryStatusSetRequest(uint8_t *p_payload, uint8_t len)
+UART_TxStatus_T UART_SendBatteryStatusSetRequest(uint8_t *p_payload, uint8_t len)
 {
-    UARTInternal_Send(len, UART_CMD_BATTERY_STATUS_SET_REQ, p_payload);
+    // Instance index identifies the battery
+    return UARTInternal_SendTelemetry(len, UART_CMD_BATTERY_STATUS_SET_REQ, p_payload, 1);
+}
+
+uint32_t UART_GetTxDropCount(void)
+{
+    return TxDropCount;
 }
 
 
-static void UARTInternal_Send(uint8_t len, uint8_t cmd, uint8_t *p_payload)
+static UART_TxStatus_T UARTInternal_Send(uint8_t len, uint8_t cmd, uint8_t *p_payload)
 {
-    uint16_t crc;
-    uint8_t  msg[PACKET_LEN(len)];
+    UARTInternal_SendDeferredControl();
 
-    msg[PREAMBLE_BYTE_1_OFFSET] = PREAMBLE_BYTE_1;
-    msg[PREAMBLE_BYTE_2_OFFSET] = PREAMBLE_BYTE_2;
-    msg[LEN_OFFSET]             = len;
-    msg[CMD_OFFSET]             = cmd;
+    // Keep order of control messages, new message waits until older ones are sent
+    if (RingBuffer_isEmpty(&TxControlBacklog) && UARTInternal_TryWriteFrame(len, cmd, p_payload))
+    {
+        return UART_TX_STATUS_SENT;
+    }
 
-    memcpy(&msg[PAYLOAD_OFFSET], p_payload, len);
+    return UARTInternal_DeferControl(len, cmd, p_payload);
+}
 
-    crc                         = UARTInternal_CalcCRC16(len, cmd, p_payload);
-    msg[CRC_BYTE_1_OFFSET(len)] = lowByte(crc);
-    msg[CRC_BYTE_2_OFFSET(len)] = highByte(crc);
+static UART_TxStatus_T UARTInternal_DeferControl(uint8_t len, uint8_t cmd, uint8_t *p_payload)
+{
+    TxFrameWriter_t writer = {};
+
+    if (!RingBuffer_Reserve(&TxControlBacklog, RECORD_LEN(len), &writer.view))
+    {
+        TxDropCount++;
+        UARTStats_TxDrop();
+        LOG_INFO("UART TX control backlog full, cmd 0x%02X dropped", cmd);
+        return UART_TX_STATUS_DROPPED;
+    }
+
+    uint8_t header[] = {len, cmd};
+
+    UARTInternal_TxWrite(&writer, header, sizeof(header));
+    UARTInternal_TxWrite(&writer, p_payload, len);
+    RingBuffer_Commit(&TxControlBacklog, RECORD_LEN(len));
+
+    UARTStats_TxControlDeferred();
+    return UART_TX_STATUS_DEFERRED;
+}
+
+static void UARTInternal_SendDeferredControl(void)
+{
+    while (!RingBuffer_isEmpty(&TxControlBacklog))
+    {
+        uint8_t           len = RingBuffer_PeekByte(&TxControlBacklog, RECORD_LEN_OFFSET);
+        uint8_t           cmd = RingBuffer_PeekByte(&TxControlBacklog, RECORD_CMD_OFFSET);
+        uint8_t           payload[MAX_PAYLOAD_SIZE];
+        RingBuffer_View_T view;
 
-    UARTDriver_WriteBytes(msg, PACKET_LEN(len));
+        RingBuffer_Peek(&TxControlBacklog, RECORD_HEADER_LEN, len, &view);
+        memcpy(payload, view.p_first, view.first_len);
+        memcpy(payload + view.first_len, view.p_second, view.second_len);
+
+        if (!UARTInternal_TryWriteFrame(len, cmd, payload))
+        {
+            return;
+        }
+
+        RingBuffer_IncrementRdIndex(&TxControlBacklog, RECORD_LEN(len));
+    }
+}
+
+static UART_TxStatus_T UARTInternal_SendTelemetry(uint8_t len, uint8_t cmd, uint8_t *p_payload, uint8_t key_len)
+{
+    UARTInternal_SendDeferredTelemetry();
+
+    // Keep order of telemetry, new message waits until older ones are sent
+    if (!TxDeferredFrames[0].used && UARTInternal_IsTelemetryAllowed(len) && UARTInternal_TryWriteFrame(len, cmd, p_payload))
+    {
+        return UART_TX_STATUS_SENT;
+    }
 
+    return UARTInternal_DeferTelemetry(len, cmd, p_payload, key_len);
+}
+
+static bool UARTInternal_IsTelemetryAllowed(uint8_t len)
+{
+    return RingBuffer_isEmpty(&TxControlBacklog) && (UARTDriver_TxFreeSpace() >= PACKET_LEN(len) + UART_TX_CONTROL_RESERVE);
+}
+
+static UART_TxStatus_T UARTInternal_DeferTelemetry(uint8_t len, uint8_t cmd, uint8_t *p_payload, uint8_t key_len)
+{
+    if (len > UART_TX_DEFERRED_PAYLOAD_MAX || len < key_len)
+    {
+        TxDropCount++;
+        UARTStats_TxDrop();
+        LOG_INFO("UART TX buffer full, cmd 0x%02X dropped", cmd);
+        return UART_TX_STATUS_DROPPED;
+    }
+
+    TxDeferredFrame_t *p_slot = NULL;
+
+    for (size_t i = 0; i < UART_TX_DEFERRED_SLOTS; i++)
+    {
+        TxDeferredFrame_t *p_frame = &TxDeferredFrames[i];
+
+        if (!p_frame->used)
+        {
+            p_slot = p_frame;
+            break;
+        }
+
+        if ((p_frame->cmd == cmd) && (p_frame->len >= key_len) && (memcmp(p_frame->payload, p_payload, key_len) == 0))
+        {
+            // Newer value supersedes the deferred one
+            TxDropCount++;
+            UARTStats_TxDrop();
+            p_slot = p_frame;
+            break;
+        }
+    }
+
+    if (p_slot == NULL)
+    {
+        TxDropCount++;
+        UARTStats_TxDrop();
+        LOG_INFO("UART TX buffer full, cmd 0x%02X dropped", cmd);
+        return UART_TX_STATUS_DROPPED;
+    }
+
+    p_slot->used = true;
+    p_slot->cmd  = cmd;
+    p_slot->len  = len;
+    memcpy(p_slot->payload, p_payload, len);
+
+    UARTStats_TxDeferred();
+    return UART_TX_STATUS_DEFERRED;
+}
+
+static void UARTInternal_SendDeferredTelemetry(void)
+{
+    size_t sent = 0;
+
+    while ((sent < UART_TX_DEFERRED_SLOTS) && TxDeferredFrames[sent].used)
+    {
+        TxDeferredFrame_t *p_frame = &TxDeferredFrames[sent];
+
+        if (!UARTInternal_IsTelemetryAllowed(p_frame->len) || !UARTInternal_TryWriteFrame(p_frame->len, p_frame->cmd, p_frame->payload))
+        {
+            break;
+        }
+
+        sent++;
+    }
+
+    if (sent == 0)
+    {
+        return;
+    }
+
+    memmove(&TxDeferredFrames[0], &TxDeferredFrames[sent], (UART_TX_DEFERRED_SLOTS - sent) * sizeof(TxDeferredFrames[0]));
+    for (size_t i = UART_TX_DEFERRED_SLOTS - sent; i < UART_TX_DEFERRED_SLOTS; i++)
+    {
+        TxDeferredFrames[i].used = false;
+    }
+}
+
+static bool UARTInternal_TryWriteFrame(uint8_t len, uint8_t cmd, uint8_t *p_payload)
+{
+    TxFrameWriter_t writer = {};
+
+    if (!UARTDriver_TxReserve(PACKET_LEN(len), &writer.view))
+    {
+        return false;
+    }
+
+    uint16_t crc      = UARTInternal_CalcCRC16(len, cmd, p_payload);
+    uint8_t  header[] = {PREAMBLE_BYTE_1, PREAMBLE_BYTE_2, len, cmd};
+    uint8_t  footer[] = {lowByte(crc), highByte(crc)};
+
+    UARTInternal_TxWrite(&writer, header, sizeof(header));
+    UARTInternal_TxWrite(&writer, p_payload, len);
+    UARTInternal_TxWrite(&writer, footer, sizeof(footer));
+
+    UARTDriver_TxCommit(PACKET_LEN(len));
+
+    UARTStats_TxFrame(cmd);
     PrintDebug("Sent", len, cmd, p_payload, crc);
+    return true;
+}
+
+static void UARTInternal_TxWrite(TxFrameWriter_t *p_writer, const uint8_t *p_data, uint16_t len)
+{
+    RingBuffer_View_T *p_view = &p_writer->view;
+
+    if (p_writer->offset < p_view->first_len)
+    {
+        uint16_t first_len = p_view->first_len - p_writer->offset;
+        if (first_len > len)
+        {
+            first_len = len;
+        }
+
+        memcpy(p_view->p_first + p_writer->offset, p_data, first_len);
+        p_writer->offset += first_len;
+        p_data += first_len;
+        len -= first_len;
+    }
+
+    if (len != 0)
+    {
+        memcpy(p_view->p_second + p_writer->offset - p_view->first_len, p_data, len);
+        p_writer->offset += len;
+    }
 }
 
 static void PrintDebug(const char *dir, uint8_t len, uint8_t cmd, uint8_t *buf, uint16_t crc)
@@ -631,6 +1018,12 @@ static void PrintDebug(const char *dir, uint8_t len, uint8_t cmd, uint8_t *buf,
     LOG_DEBUG("\t Cmd: 0x%02X", cmd);
     LOG_DEBUG_HEXBUF("\t Data:", buf, len);
     LOG_DEBUG("\t CRC: 0x%02X%02X", lowByte(crc), highByte(crc));
+#else
+    UNUSED(dir);
+    UNUSED(len);
+    UNUSED(cmd);
+    UNUSED(buf);
+    UNUSED(crc);
 #endif
 }
 
@@ -642,3 +1035,54 @@ static uint16_t UARTInternal_CalcCRC16(uint8_t len, uint8_t cmd, uint8_t *data)
     crc          = CalcCRC16(data, len, crc);
     return crc;
 }
+
+static void UARTInternal_UpdateRxFrameCRC16(uint8_t len, uint16_t available)
+{
+    uint16_t start = LEN_OFFSET + RxFrameCRCLen;
+    uint16_t end   = CRC_BYTE_1_OFFSET(len);
+
+    if (available < end)
+    {
+        end = available;
+    }
+
+    if (end <= start)
+    {
+        return;
+    }
+
+    RingBuffer_View_T view;
+    UARTDriver_RxPeek(start, end - start, &view);
+
+    RxFrameCRC = CalcCRC16(view.p_first, view.first_len, RxFrameCRC);
+    RxFrameCRC = CalcCRC16(view.p_second, view.second_len, RxFrameCRC);
+    RxFrameCRCLen += end - start;
+}
+
+static void UARTInternal_RxResync(void)
+{
+    UARTInternal_RxRelease(PREAMBLE_BYTE_1_OFFSET + 1);
+    UARTStats_Resync(PREAMBLE_BYTE_1_OFFSET + 1);
+}
+
+static void UARTInternal_RxSkipToPreamble(uint16_t available)
+{
+    RingBuffer_View_T view;
+
+    UARTDriver_RxPeek(PREAMBLE_BYTE_1_OFFSET, available, &view);
+
+    // Only the contiguous part is searched, the rest is searched in the next pass of the caller's loop
+    uint8_t *p_preamble = (uint8_t *)memchr(view.p_first, PREAMBLE_BYTE_1, view.first_len);
+    uint16_t skip_len   = (p_preamble != NULL) ? (p_preamble - view.p_first) : view.first_len;
+
+    UARTInternal_RxRelease(skip_len);
+    UARTStats_Resync(skip_len);
+}
+
+static void UARTInternal_RxRelease(uint16_t len)
+{
+    RxFrameCRC    = CRC16_INIT_VAL;
+    RxFrameCRCLen = 0;
+
+    UARTDriver_RxRelease(len);
+}
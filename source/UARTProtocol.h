@@ -31,6 +31,82 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 /**< Defines maximum data length in frame */
 #define MAX_PAYLOAD_SIZE 127
 
+/**< UART Command Codes definitions */
+#define UART_CMD_PING_REQUEST 0x01u
+#define UART_CMD_PONG_RESPONSE 0x02u
+#define UART_CMD_INIT_DEVICE_EVENT 0x03u
+#define UART_CMD_CREATE_INSTANCES_REQUEST 0x04u
+#define UART_CMD_CREATE_INSTANCES_RESPONSE 0x05u
+#define UART_CMD_INIT_NODE_EVENT 0x06u
+#define UART_CMD_MESH_MESSAGE_REQUEST 0x07u
+#define UART_CMD_START_NODE_REQUEST 0x09u
+#define UART_CMD_START_NODE_RESPONSE 0x0Bu
+#define UART_CMD_FACTORY_RESET_REQUEST 0x0Cu
+#define UART_CMD_FACTORY_RESET_RESPONSE 0x0Du
+#define UART_CMD_FACTORY_RESET_EVENT 0x0Eu
+#define UART_CMD_MESH_MESSAGE_RESPONSE 0x0Fu
+#define UART_CMD_CURRENT_STATE_REQUEST 0x10u
+#define UART_CMD_CURRENT_STATE_RESPONSE 0x11u
+#define UART_CMD_ERROR 0x12u
+#define UART_CMD_MODEM_FIRMWARE_VERSION_REQUEST 0x13u
+#define UART_CMD_MODEM_FIRMWARE_VERSION_RESPONSE 0x14u
+#define UART_CMD_SENSOR_UPDATE_REQUEST 0x15u
+#define UART_CMD_ATTENTION_EVENT 0x16u
+#define UART_CMD_SOFTWARE_RESET_REQUEST 0x17u
+#define UART_CMD_SOFTWARE_RESET_RESPONSE 0x18u
+#define UART_CMD_SENSOR_UPDATE_RESPONSE 0x19u
+#define UART_CMD_DEVICE_UUID_REQUEST 0x1Au
+#define UART_CMD_DEVICE_UUID_RESPONSE 0x1Bu
+#define UART_CMD_SET_FAULT_REQUEST 0x1Cu
+#define UART_CMD_SET_FAULT_RESPONSE 0x1Du
+#define UART_CMD_CLEAR_FAULT_REQUEST 0x1Eu
+#define UART_CMD_CLEAR_FAULT_RESPONSE 0x1Fu
+#define UART_CMD_START_TEST_REQ 0x20u
+#define UART_CMD_START_TEST_RESP 0x21u
+#define UART_CMD_TEST_FINISHED_REQ 0x22u
+#define UART_CMD_TEST_FINISHED_RESP 0x23u
+#define UART_CMD_FIRMWARE_VERSION_SET_REQ 0x24u
+#define UART_CMD_FIRMWARE_VERSION_SET_RESP 0x25u
+#define UART_CMD_BATTERY_STATUS_SET_REQ 0x26u
+#define UART_CMD_BATTERY_STATUS_SET_RESP 0x27u
+#define UART_CMD_MESH_MESSAGE_REQUEST_1 0x28u
+#define UART_CMD_TIME_SOURCE_SET_REQ 0x29u
+#define UART_CMD_TIME_SOURCE_SET_RESP 0x2Au
+#define UART_CMD_TIME_SOURCE_GET_REQ 0x2Bu
+#define UART_CMD_TIME_SOURCE_GET_RESP 0x2Cu
+#define UART_CMD_TIME_GET_REQ 0x2Du
+#define UART_CMD_TIME_GET_RESP 0x2Eu
+
+#define UART_CMD_DFU_INIT_REQ 0x80u
+#define UART_CMD_DFU_INIT_RESP 0x81u
+#define UART_CMD_DFU_STATUS_REQ 0x82u
+#define UART_CMD_DFU_STATUS_RESP 0x83u
+#define UART_CMD_DFU_PAGE_CREATE_REQ 0x84u
+#define UART_CMD_DFU_PAGE_CREATE_RESP 0x85u
+#define UART_CMD_DFU_WRITE_DATA_EVENT 0x86u
+#define UART_CMD_DFU_PAGE_STORE_REQ 0x87u
+#define UART_CMD_DFU_PAGE_STORE_RESP 0x88u
+#define UART_CMD_DFU_STATE_CHECK_REQ 0x89u
+#define UART_CMD_DFU_STATE_CHECK_RESP 0x8Au
+#define UART_CMD_DFU_CANCEL_REQ 0x8Bu
+#define UART_CMD_DFU_CANCEL_RESP 0x8Cu
+
+#define UART_CMD_DFU_OFFSET 0x80
+
+/*
+ *  Result of queueing a frame for transmission. Control frames (responses, DFU,
+ *  configuration) that do not fit in TX buffer wait in control backlog of
+ *  UART_TX_CONTROL_BACKLOG_LEN bytes, and are dropped only if it is full too.
+ *  Periodic telemetry (pings, sensor and battery updates) is deferred when TX
+ *  buffer is near full and coalesced with newer updates of the same value.
+ */
+typedef enum
+{
+    UART_TX_STATUS_SENT,     /**< Frame queued in TX buffer */
+    UART_TX_STATUS_DEFERRED, /**< Frame will be queued when TX buffer space is available */
+    UART_TX_STATUS_DROPPED,  /**< Frame was not queued and will not be sent */
+} UART_TxStatus_T;
+
 /*
  *  Setup UART hardware
  */
@@ -48,192 +124,233 @@ void UART_DisablePings(void);
 
 /*
  *  Send Ping Request command
+ *
+ *  @return              TX status, dropped if pings are disabled
  */
-void UART_SendPingRequest(void);
+UART_TxStatus_T UART_SendPingRequest(void);
 
 /*
  *  Send Pong Response command
  *
  *  @param * p_payload   Pointer to command payload
  *  @param len           Payload len
+ *  @return              TX status, dropped if pings are disabled
  */
-void UART_SendPongResponse(uint8_t *p_payload, uint8_t len);
+UART_TxStatus_T UART_SendPongResponse(uint8_t *p_payload, uint8_t len);
 
 /*
  *  Send Create Instances Request command
  *
  *  @param * model_id   Pointer to model ids list
  *  @param len          Model ids list length
+ *  @return              TX status
  */
-void UART_SendCreateInstancesRequest(uint8_t *model_id, uint8_t len);
+UART_TxStatus_T UART_SendCreateInstancesRequest(uint8_t *model_id, uint8_t len);
 
 /*
  *  Send Mesh Message Request command
  *
  *  @param * p_payload   Command payload
  *  @param len           Payload len
+ *  @return              TX status
  */
-void UART_SendMeshMessageRequest(uint8_t *p_payload, uint8_t len);
+UART_TxStatus_T UART_SendMeshMessageRequest(uint8_t *p_payload, uint8_t len);
 
 /*
  *  Send Mesh Message Request1 command
  *
  *  @param * p_payload   Command payload
  *  @param len           Payload len
+ *  @return              TX status
  */
-void UART_SendMeshMessageRequest1(uint8_t *p_payload, uint8_t len);
+UART_TxStatus_T UART_SendMeshMessageRequest1(uint8_t *p_payload, uint8_t len);
 
 /*
  *  Send Sensor Update Request command
  *
  *  @param * p_payload   Command payload
  *  @param len           Payload len
+ *  @return              TX status
  */
-void UART_SendSensorUpdateRequest(uint8_t *p_payload, uint8_t len);
+UART_TxStatus_T UART_SendSensorUpdateRequest(uint8_t *p_payload, uint8_t len);
 
 /*
  *  Send Software Reset Request command
+ *
+ *  @return              TX status
  */
-void UART_SendSoftwareResetRequest(void);
+UART_TxStatus_T UART_SendSoftwareResetRequest(void);
 
 /*
  *  Send Firmware Version Set Request command
  *
  *  @param * p_payload   Command payload
  *  @param len           Payload len
+ *  @return              TX status
  */
-void UART_SendFirmwareVersionSetRequest(uint8_t *p_payload, uint8_t len);
+UART_TxStatus_T UART_SendFirmwareVersionSetRequest(uint8_t *p_payload, uint8_t len);
 
 /*
  *  Send Start Node Request command
+ *
+ *  @return              TX status
  */
-void UART_StartNodeRequest(void);
+UART_TxStatus_T UART_StartNodeRequest(void);
 
 /*
  *  Send Firmware Version Request command
+ *
+ *  @return              TX status
  */
-void UART_ModemFirmwareVersionRequest(void);
+UART_TxStatus_T UART_ModemFirmwareVersionRequest(void);
 
 /*
  *  Send Set Fault Request command
  *
  *  @param * p_payload   Command payload
  *  @param len           Payload len
+ *  @return              TX status
  */
-void UART_SendSetFaultRequest(uint8_t *p_payload, uint8_t len);
+UART_TxStatus_T UART_SendSetFaultRequest(uint8_t *p_payload, uint8_t len);
 
 /*
  *  Send Clear Fault Request command
  *
  *  @param * p_payload   Command payload
  *  @param len           Payload len
+ *  @return              TX status
  */
-void UART_SendClearFaultRequest(uint8_t *p_payload, uint8_t len);
+UART_TxStatus_T UART_SendClearFaultRequest(uint8_t *p_payload, uint8_t len);
 
 /*
  *  Send Test Start Response command
  *
  *  @param * p_payload   Command payload
  *  @param len           Payload len
+ *  @return              TX status
  */
-void UART_SendTestStartResponse(uint8_t *p_payload, uint8_t len);
+UART_TxStatus_T UART_SendTestStartResponse(uint8_t *p_payload, uint8_t len);
 
 /*
  *  Send Test Finished Request command
  *
  *  @param * p_payload   Command payload
  *  @param len           Payload len
+ *  @return              TX status
  */
-void UART_SendTestFinishedRequest(uint8_t *p_payload, uint8_t len);
+UART_TxStatus_T UART_SendTestFinishedRequest(uint8_t *p_payload, uint8_t len);
 
 /*
  *  Send Dfu Init Response command
  *
  *  @param * p_payload   Command payload
  *  @param len           Payload len
+ *  @return              TX status
  */
-void UART_SendDfuInitResponse(uint8_t *p_payload, uint8_t len);
+UART_TxStatus_T UART_SendDfuInitResponse(uint8_t *p_payload, uint8_t len);
 
 /*
  *  Send Dfu Status Response command
  *
  *  @param * p_payload   Command payload
  *  @param len           Payload len
+ *  @return              TX status
  */
-void UART_SendDfuStatusResponse(uint8_t *p_payload, uint8_t len);
+UART_TxStatus_T UART_SendDfuStatusResponse(uint8_t *p_payload, uint8_t len);
 
 /*
  *  Send Dfu Page Create command
  *
  *  @param * p_payload   Command payload
  *  @param len           Payload len
+ *  @return              TX status
  */
-void UART_SendDfuPageCreateResponse(uint8_t *p_payload, uint8_t len);
+UART_TxStatus_T UART_SendDfuPageCreateResponse(uint8_t *p_payload, uint8_t len);
 
 /*
  *  Send Dfu Page Store Response command
  *
  *  @param * p_payload   Command payload
  *  @param len           Payload len
+ *  @return              TX status
  */
-void UART_SendDfuPageStoreResponse(uint8_t *p_payload, uint8_t len);
+UART_TxStatus_T UART_SendDfuPageStoreResponse(uint8_t *p_payload, uint8_t len);
 
 /*
  *  Send Dfu State Check Request command
  *
  *  @param * p_payload   Command payload
  *  @param len           Payload len
+ *  @return              TX status
  */
-void UART_SendDfuStateCheckRequest(uint8_t *p_payload, uint8_t len);
+UART_TxStatus_T UART_SendDfuStateCheckRequest(uint8_t *p_payload, uint8_t len);
 
 /*
  *  Send Dfu Cancel Request command
  *
  *  @param * p_payload   Command payload
  *  @param len           Payload len
+ *  @return              TX status
  */
-void UART_SendDfuCancelRequest(uint8_t *p_payload, uint8_t len);
+UART_TxStatus_T UART_SendDfuCancelRequest(uint8_t *p_payload, uint8_t len);
 
 /*
  *  Send Firmware Version Set Request command
  *
  *  @param * p_payload   Command payload
  *  @param len           Payload len
+ *  @return              TX status
 */
-void UART_SendFirmwareVersionSetRequest(uint8_t *p_payload, uint8_t len);
+UART_TxStatus_T UART_SendFirmwareVersionSetRequest(uint8_t *p_payload, uint8_t len);
 
 /*
  *  Send Time Source Get Response command
  *
  *  @param TimeDate*    Time contained in TimeSourceGetResponse
  *  @param instance_idx instance index
+ *  @return              TX status
 */
-void UART_SendTimeSourceGetResponse(uint8_t instance_idx, TimeDate *time);
+UART_TxStatus_T UART_SendTimeSourceGetResponse(uint8_t instance_idx, TimeDate *time);
 
 /*
  *  Send Time Source Set Response command
  *
  *  @param instance_idx instance index
+ *  @return              TX status
  */
-void UART_SendTimeSourceSetResponse(uint8_t instance_idx);
+UART_TxStatus_T UART_SendTimeSourceSetResponse(uint8_t instance_idx);
 
 /*
  *  Send Time Get Request command
  *
  *  @param instance_idx instance index
+ *  @return              TX status
  */
-void UART_SendTimeGetRequest(uint8_t instance_idx);
+UART_TxStatus_T UART_SendTimeGetRequest(uint8_t instance_idx);
 
 /*
  *  Send Time BatteryStatusSetRequest command
  *
  *  @param * p_payload   Command payload
  *  @param len           Payload len
+ *  @return              TX status
+ */
+UART_TxStatus_T UART_SendBatteryStatusSetRequest(uint8_t *p_payload, uint8_t len);
+
+/*
+ *  Get number of frames dropped: telemetry superseded by newer value while
+ *  deferred or not fitting in the deferred frames queue, and control frames
+ *  not fitting in control backlog.
+ *
+ *  @return              Number of dropped frames
  */
-void UART_SendBatteryStatusSetRequest(uint8_t *p_payload, uint8_t len);
+uint32_t UART_GetTxDropCount(void);
 
 /*
- *  Receive and process incoming UART command
+ *  Receive and process incoming UART commands. Polls the RX DMA position on
+ *  every call and, if new bytes were received, RX line went idle or frames were
+ *  left over from the last call, dispatches up to UART_RX_FRAMES_PER_LOOP complete frames.
+ *  Queues deferred control and telemetry frames if TX buffer space is available.
  */
 void UART_ProcessIncomingCommand(void);
 
@@ -373,6 +490,11 @@ extern void ProcessDfuStateCheckResponse(uint8_t *p_payload, uint8_t len);
  */
 extern void ProcessDfuCancelResponse(uint8_t *p_payload, uint8_t len);
 
+/*
+ *  Process loss of received bytes, frames could have been dropped
+ */
+extern void ProcessDfuRxDataLoss(void);
+
 /*
  *  Process Firmware Version set response
  */
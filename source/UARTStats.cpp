@@ -0,0 +1,404 @@
+/*
+Copyright © 2021 Silvair Sp. z o.o. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "UARTStats.h"
+
+#if ENABLE_UART_STATS == 1
+
+#include <inttypes.h>
+#include <string.h>
+
+#include "Log.h"
+#include "Timestamp.h"
+#include "UARTProtocol.h"
+
+#define UART_STATS_CMD_UNKNOWN_IDX (UART_STATS_CMD_COUNT - 1)
+
+typedef struct
+{
+    uint8_t     request;  /**< Request command code */
+    uint8_t     response; /**< Response command code */
+    const char *name;
+} UARTStats_RttProbe_T;
+
+
+/**< Requests with known responses, round trip time is measured between them */
+static const UARTStats_RttProbe_T RttProbes[UART_STATS_RTT_PROBE_COUNT] = {
+    {UART_CMD_PING_REQUEST, UART_CMD_PONG_RESPONSE, "Ping"},
+    {UART_CMD_CREATE_INSTANCES_REQUEST, UART_CMD_CREATE_INSTANCES_RESPONSE, "CreateInstances"},
+    {UART_CMD_START_NODE_REQUEST, UART_CMD_START_NODE_RESPONSE, "StartNode"},
+    {UART_CMD_MODEM_FIRMWARE_VERSION_REQUEST, UART_CMD_MODEM_FIRMWARE_VERSION_RESPONSE, "ModemFirmwareVersion"},
+};
+
+static_assert(sizeof(UARTStats_T) <= 1792, "UART statistics take more RAM than budgeted in Config.h");
+
+static UARTStats_T Stats;
+static uint32_t    LastPrintTimestamp = 0;
+#if ENABLE_UART_STATS_PING == 1
+static uint32_t LastPingTimestamp = 0;
+#endif
+static uint32_t    RttStartUs[UART_STATS_RTT_PROBE_COUNT]; /**< Time of sending the last request */
+static bool        RttPending[UART_STATS_RTT_PROBE_COUNT]; /**< True if response to the last request was not received yet */
+
+
+/*
+ *  Map command code to index in per command counters
+ *
+ *  @param cmd          Command code
+ *  @return             Counter index
+ */
+static size_t UARTStats_CmdIdx(uint8_t cmd);
+
+/*
+ *  Map index in per command counters to command code
+ *
+ *  @param idx          Counter index
+ *  @return             Command code
+ */
+static uint8_t UARTStats_IdxCmd(size_t idx);
+
+/*
+ *  Add round trip time to statistics
+ *
+ *  @param p_rtt        Round trip time statistics
+ *  @param rtt_us       Measured round trip time
+ */
+static void UARTStats_RttAdd(UARTStats_Rtt_T *p_rtt, uint32_t rtt_us);
+
+/*
+ *  Print round trip time statistics
+ *
+ *  @param name         Name of the request
+ *  @param p_rtt        Round trip time statistics
+ */
+static void UARTStats_RttPrint(const char *name, const UARTStats_Rtt_T *p_rtt);
+
+
+void UARTStats_RxFrame(uint8_t cmd)
+{
+    Stats.rx_frames[UARTStats_CmdIdx(cmd)]++;
+
+    for (size_t i = 0; i < UART_STATS_RTT_PROBE_COUNT; i++)
+    {
+        if ((RttProbes[i].response == cmd) && RttPending[i])
+        {
+            RttPending[i] = false;
+            UARTStats_RttAdd(&Stats.rtt[i], micros() - RttStartUs[i]);
+        }
+    }
+}
+
+void UARTStats_TxFrame(uint8_t cmd)
+{
+    Stats.tx_frames[UARTStats_CmdIdx(cmd)]++;
+
+    for (size_t i = 0; i < UART_STATS_RTT_PROBE_COUNT; i++)
+    {
+        if (RttProbes[i].request == cmd)
+        {
+            // Unanswered request is not counted, the new one is measured instead
+            RttPending[i] = true;
+            RttStartUs[i] = micros();
+        }
+    }
+}
+
+void UARTStats_RxBytes(uint32_t len, uint16_t level)
+{
+    Stats.rx_bytes += len;
+    if (level > Stats.rx_high_water)
+    {
+        Stats.rx_high_water = level;
+    }
+}
+
+void UARTStats_TxBytes(uint32_t len, uint16_t level)
+{
+    Stats.tx_bytes += len;
+    if (level > Stats.tx_high_water)
+    {
+        Stats.tx_high_water = level;
+    }
+}
+
+uint32_t UARTStats_HandlerStart(void)
+{
+    return micros();
+}
+
+void UARTStats_HandlerEnd(uint8_t cmd, uint32_t start)
+{
+    UARTStats_Handler_T *p_handler = &Stats.handlers[UARTStats_CmdIdx(cmd)];
+    uint32_t             time_us   = micros() - start;
+
+    p_handler->count++;
+    p_handler->total_us += time_us;
+    if (time_us > p_handler->max_us)
+    {
+        p_handler->max_us = time_us;
+    }
+}
+
+void UARTStats_RxParsePass(void)
+{
+    Stats.rx_parse_passes++;
+}
+
+void UARTStats_RxPartialFrame(void)
+{
+    Stats.rx_partial_frames++;
+}
+
+void UARTStats_CrcError(void)
+{
+    Stats.crc_errors++;
+}
+
+void UARTStats_BadLength(void)
+{
+    Stats.bad_lengths++;
+}
+
+void UARTStats_UnhandledCmd(void)
+{
+    Stats.unhandled_cmds++;
+}
+
+void UARTStats_RejectedLength(void)
+{
+    Stats.rejected_lengths++;
+}
+
+void UARTStats_Resync(uint16_t len)
+{
+    Stats.resyncs += len;
+}
+
+void UARTStats_RxOverrun(void)
+{
+    Stats.rx_overruns++;
+}
+
+void UARTStats_RxLineError(void)
+{
+    Stats.rx_line_errors++;
+}
+
+void UARTStats_RxOverwrite(void)
+{
+    Stats.rx_overwrites++;
+}
+
+void UARTStats_TxControlDeferred(void)
+{
+    Stats.tx_control_deferred++;
+}
+
+void UARTStats_TxDeferred(void)
+{
+    Stats.tx_deferred++;
+}
+
+void UARTStats_TxDrop(void)
+{
+    Stats.tx_drops++;
+}
+
+const UARTStats_T *UARTStats_Get(void)
+{
+    return &Stats;
+}
+
+void UARTStats_Reset(void)
+{
+    memset(&Stats, 0, sizeof(Stats));
+    memset(RttPending, 0, sizeof(RttPending));
+}
+
+uint32_t UARTStats_RttPercentile(const UARTStats_Rtt_T *p_rtt, uint8_t percent)
+{
+    if (p_rtt->count == 0)
+    {
+        return 0;
+    }
+
+    uint32_t rank       = ((uint64_t)p_rtt->count * percent + 99) / 100;
+    uint32_t cumulative = 0;
+
+    if (rank == 0)
+    {
+        rank = 1;
+    }
+
+    for (size_t i = 0; i < UART_STATS_RTT_BUCKET_COUNT - 1; i++)
+    {
+        cumulative += p_rtt->buckets[i];
+        if (cumulative >= rank)
+        {
+            uint32_t upper_bound = (i == 0) ? 0 : ((1UL << i) - 1);
+            return (upper_bound < p_rtt->max_us) ? upper_bound : p_rtt->max_us;
+        }
+    }
+
+    return p_rtt->max_us;
+}
+
+void UARTStats_Print(void)
+{
+    _LOG("UART stats:");
+    _LOG("RX bytes: %" PRIu32 ", high water: %u", Stats.rx_bytes, Stats.rx_high_water);
+    _LOG("TX bytes: %" PRIu32 ", high water: %u", Stats.tx_bytes, Stats.tx_high_water);
+    _LOG("Parser passes: %" PRIu32 ", partial frames: %" PRIu32, Stats.rx_parse_passes, Stats.rx_partial_frames);
+    _LOG("CRC errors: %" PRIu32 ", bad lengths: %" PRIu32 ", resyncs: %" PRIu32, Stats.crc_errors, Stats.bad_lengths, Stats.resyncs);
+    _LOG("Unhandled cmds: %" PRIu32 ", rejected lengths: %" PRIu32, Stats.unhandled_cmds, Stats.rejected_lengths);
+    _LOG("RX overruns: %" PRIu32 ", line errors: %" PRIu32 ", overwrites: %" PRIu32, Stats.rx_overruns, Stats.rx_line_errors, Stats.rx_overwrites);
+    _LOG("TX control deferred: %" PRIu32 ", telemetry deferred: %" PRIu32 ", drops: %" PRIu32, Stats.tx_control_deferred, Stats.tx_deferred, Stats.tx_drops);
+
+    for (size_t i = 0; i < UART_STATS_CMD_COUNT; i++)
+    {
+        if ((Stats.rx_frames[i] != 0) || (Stats.tx_frames[i] != 0))
+        {
+            _LOG("Cmd 0x%02X: RX %" PRIu32 ", TX %" PRIu32, UARTStats_IdxCmd(i), Stats.rx_frames[i], Stats.tx_frames[i]);
+        }
+    }
+
+    for (size_t i = 0; i < UART_STATS_RTT_PROBE_COUNT; i++)
+    {
+        UARTStats_RttPrint(RttProbes[i].name, &Stats.rtt[i]);
+    }
+
+    _LOG("Handler execution time:");
+    for (size_t i = 0; i < UART_STATS_CMD_COUNT; i++)
+    {
+        const UARTStats_Handler_T *p_handler = &Stats.handlers[i];
+
+        if (p_handler->count != 0)
+        {
+            _LOG("Cmd 0x%02X: count %" PRIu32 ", total %" PRIu32 " us, avg %" PRIu32 " us, max %" PRIu32 " us",
+                 UARTStats_IdxCmd(i),
+                 p_handler->count,
+                 p_handler->total_us,
+                 p_handler->total_us / p_handler->count,
+                 p_handler->max_us);
+        }
+    }
+}
+
+void UARTStats_Loop(bool is_modem_initialized)
+{
+#if ENABLE_UART_STATS_PING == 1
+    if (is_modem_initialized && (Timestamp_GetTimeElapsed(LastPingTimestamp, Timestamp_GetCurrent()) >= UART_STATS_PING_INTV))
+    {
+        LastPingTimestamp = Timestamp_GetCurrent();
+        UART_SendPingRequest();
+    }
+#else
+    UNUSED(is_modem_initialized);
+#endif
+
+    if (Timestamp_GetTimeElapsed(LastPrintTimestamp, Timestamp_GetCurrent()) >= UART_STATS_PRINT_INTV)
+    {
+        LastPrintTimestamp = Timestamp_GetCurrent();
+        UARTStats_Print();
+    }
+}
+
+static size_t UARTStats_CmdIdx(uint8_t cmd)
+{
+    if (cmd < UART_STATS_CMD_BASE_COUNT)
+    {
+        return cmd;
+    }
+
+    if ((cmd >= UART_CMD_DFU_OFFSET) && (cmd < UART_CMD_DFU_OFFSET + UART_STATS_CMD_DFU_COUNT))
+    {
+        return UART_STATS_CMD_BASE_COUNT + cmd - UART_CMD_DFU_OFFSET;
+    }
+
+    return UART_STATS_CMD_UNKNOWN_IDX;
+}
+
+static uint8_t UARTStats_IdxCmd(size_t idx)
+{
+    if (idx < UART_STATS_CMD_BASE_COUNT)
+    {
+        return idx;
+    }
+
+    if (idx < UART_STATS_CMD_UNKNOWN_IDX)
+    {
+        return UART_CMD_DFU_OFFSET + idx - UART_STATS_CMD_BASE_COUNT;
+    }
+
+    return UINT8_MAX;
+}
+
+static void UARTStats_RttAdd(UARTStats_Rtt_T *p_rtt, uint32_t rtt_us)
+{
+    size_t bucket = (rtt_us == 0) ? 0 : (32 - __builtin_clz(rtt_us));
+    if (bucket >= UART_STATS_RTT_BUCKET_COUNT)
+    {
+        bucket = UART_STATS_RTT_BUCKET_COUNT - 1;
+    }
+
+    if ((p_rtt->count == 0) || (rtt_us < p_rtt->min_us))
+    {
+        p_rtt->min_us = rtt_us;
+    }
+    if (rtt_us > p_rtt->max_us)
+    {
+        p_rtt->max_us = rtt_us;
+    }
+
+    p_rtt->count++;
+    p_rtt->buckets[bucket]++;
+}
+
+static void UARTStats_RttPrint(const char *name, const UARTStats_Rtt_T *p_rtt)
+{
+    if (p_rtt->count == 0)
+    {
+        return;
+    }
+
+    _LOG("%s RTT: count %" PRIu32 ", min %" PRIu32 " us, max %" PRIu32 " us, p50 %" PRIu32 " us, p99 %" PRIu32 " us",
+         name,
+         p_rtt->count,
+         p_rtt->min_us,
+         p_rtt->max_us,
+         UARTStats_RttPercentile(p_rtt, 50),
+         UARTStats_RttPercentile(p_rtt, 99));
+
+    for (size_t i = 0; i < UART_STATS_RTT_BUCKET_COUNT - 1; i++)
+    {
+        if (p_rtt->buckets[i] != 0)
+        {
+            _LOG("\t< %" PRIu32 " us: %" PRIu32, (uint32_t)1 << i, p_rtt->buckets[i]);
+        }
+    }
+
+    if (p_rtt->buckets[UART_STATS_RTT_BUCKET_COUNT - 1] != 0)
+    {
+        _LOG("\t>= %" PRIu32 " us: %" PRIu32, (uint32_t)1 << (UART_STATS_RTT_BUCKET_COUNT - 2), p_rtt->buckets[UART_STATS_RTT_BUCKET_COUNT - 1]);
+    }
+}
+
+#endif
@@ -0,0 +1,292 @@
+/*
+Copyright © 2021 Silvair Sp. z o.o. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef UART_STATS_H_
+#define UART_STATS_H_
+
+#include <stdint.h>
+
+#include "Config.h"
+#include "UARTProtocol.h"
+#include "Utils.h"
+
+/**< Commands 0x00 - 0x2E, DFU commands 0x80 - 0x8C and one slot for unknown commands */
+#define UART_STATS_CMD_BASE_COUNT (UART_CMD_TIME_GET_RESP + 1)
+#define UART_STATS_CMD_DFU_COUNT (UART_CMD_DFU_CANCEL_RESP - UART_CMD_DFU_OFFSET + 1)
+#define UART_STATS_CMD_COUNT (UART_STATS_CMD_BASE_COUNT + UART_STATS_CMD_DFU_COUNT + 1)
+
+/**< Round trip time is measured for Ping, StartNode, CreateInstances and ModemFirmwareVersion requests */
+#define UART_STATS_RTT_PROBE_COUNT 4
+/**< Bucket n counts round trip times in range [2^(n-1), 2^n) us, last bucket counts longer times */
+#define UART_STATS_RTT_BUCKET_COUNT 24
+
+typedef struct
+{
+    uint32_t count;                                /**< Number of measured round trips */
+    uint32_t min_us;                               /**< Minimal round trip time */
+    uint32_t max_us;                               /**< Maximal round trip time */
+    uint32_t buckets[UART_STATS_RTT_BUCKET_COUNT]; /**< Log2 histogram of round trip time */
+} UARTStats_Rtt_T;
+
+typedef struct
+{
+    uint32_t count;    /**< Number of handler calls */
+    uint32_t total_us; /**< Total handler execution time */
+    uint32_t max_us;   /**< Maximal handler execution time */
+} UARTStats_Handler_T;
+
+typedef struct
+{
+    uint32_t rx_frames[UART_STATS_CMD_COUNT]; /**< Valid frames received, per command */
+    uint32_t tx_frames[UART_STATS_CMD_COUNT]; /**< Frames queued for transmission, per command */
+    uint32_t rx_bytes;                        /**< All bytes received, including invalid ones */
+    uint32_t tx_bytes;                        /**< All bytes queued for transmission */
+    uint32_t rx_parse_passes;                 /**< Parser runs over new RX data */
+    uint32_t rx_partial_frames;               /**< Parser runs ended waiting for the rest of a frame */
+    uint32_t crc_errors;                      /**< Frames dropped due to invalid CRC */
+    uint32_t bad_lengths;                     /**< Frames dropped due to length over MAX_PAYLOAD_SIZE */
+    uint32_t resyncs;                         /**< Bytes skipped while searching for frame start */
+    uint32_t unhandled_cmds;                  /**< Valid frames with no handler */
+    uint32_t rejected_lengths;                /**< Valid frames with payload length not accepted by handler */
+    uint32_t rx_overruns;                     /**< UART overruns, RX DMA did not take bytes in time */
+    uint32_t rx_line_errors;                  /**< Bytes received with noise, framing or parity error */
+    uint32_t rx_overwrites;                   /**< RX DMA overwrote bytes not yet processed */
+    uint32_t tx_control_deferred;             /**< Control frames queued in control backlog due to lack of TX buffer space */
+    uint32_t tx_deferred;                     /**< Telemetry frames deferred due to lack of TX buffer space */
+    uint32_t tx_drops;                        /**< Frames dropped, telemetry or control frames not fitting in control backlog */
+    uint16_t rx_high_water;                   /**< Maximum number of bytes waiting in RX buffer */
+    uint16_t tx_high_water;                   /**< Maximum number of bytes waiting in TX buffer */
+
+    UARTStats_Rtt_T     rtt[UART_STATS_RTT_PROBE_COUNT]; /**< Round trip time of requests with known response */
+    UARTStats_Handler_T handlers[UART_STATS_CMD_COUNT];  /**< Execution time of received command handlers, per command */
+} UARTStats_T;
+
+#if ENABLE_UART_STATS == 1
+
+/*
+ *  Count valid received frame. If it is a response to a measured request,
+ *  round trip time is added to the histogram.
+ *
+ *  @param cmd          Command code
+ */
+void UARTStats_RxFrame(uint8_t cmd);
+
+/*
+ *  Count frame queued for transmission. If it is a measured request, round
+ *  trip time measurement is started.
+ *
+ *  @param cmd          Command code
+ */
+void UARTStats_TxFrame(uint8_t cmd);
+
+/*
+ *  Count received bytes and update RX buffer high water mark
+ *
+ *  @param len          Number of new bytes
+ *  @param level        Number of bytes waiting in RX buffer
+ */
+void UARTStats_RxBytes(uint32_t len, uint16_t level);
+
+/*
+ *  Count bytes queued for transmission and update TX buffer high water mark
+ *
+ *  @param len          Number of new bytes
+ *  @param level        Number of bytes waiting in TX buffer
+ */
+void UARTStats_TxBytes(uint32_t len, uint16_t level);
+
+/*
+ *  Start measuring command handler execution time
+ *
+ *  @return             Start timestamp to pass to UARTStats_HandlerEnd
+ */
+uint32_t UARTStats_HandlerStart(void);
+
+/*
+ *  Finish measuring command handler execution time
+ *
+ *  @param cmd          Command code
+ *  @param start        Timestamp returned by UARTStats_HandlerStart
+ */
+void UARTStats_HandlerEnd(uint8_t cmd, uint32_t start);
+
+/*
+ *  Count parser run over new RX data
+ */
+void UARTStats_RxParsePass(void);
+
+/*
+ *  Count parser run ended on incomplete frame
+ */
+void UARTStats_RxPartialFrame(void);
+
+/*
+ *  Count frame with invalid CRC
+ */
+void UARTStats_CrcError(void);
+
+/*
+ *  Count frame with invalid length
+ */
+void UARTStats_BadLength(void);
+
+/*
+ *  Count valid frame with no handler
+ */
+void UARTStats_UnhandledCmd(void);
+
+/*
+ *  Count valid frame with payload length not accepted by handler
+ */
+void UARTStats_RejectedLength(void);
+
+/*
+ *  Count bytes skipped while searching for frame start
+ *
+ *  @param len          Number of skipped bytes
+ */
+void UARTStats_Resync(uint16_t len);
+
+/*
+ *  Count UART overrun
+ */
+void UARTStats_RxOverrun(void);
+
+/*
+ *  Count UART noise, framing or parity error
+ */
+void UARTStats_RxLineError(void);
+
+/*
+ *  Count overwrite of unprocessed bytes in RX buffer
+ */
+void UARTStats_RxOverwrite(void);
+
+/*
+ *  Count control frame queued in control backlog
+ */
+void UARTStats_TxControlDeferred(void);
+
+/*
+ *  Count deferred telemetry frame
+ */
+void UARTStats_TxDeferred(void);
+
+/*
+ *  Count dropped frame
+ */
+void UARTStats_TxDrop(void);
+
+/*
+ *  Get collected statistics
+ *
+ *  @return             Pointer to statistics
+ */
+const UARTStats_T *UARTStats_Get(void);
+
+/*
+ *  Clear collected statistics
+ */
+void UARTStats_Reset(void);
+
+/*
+ *  Print collected statistics over DEBUG_INTERFACE
+ */
+void UARTStats_Print(void);
+
+/*
+ *  Estimate round trip time percentile from histogram
+ *
+ *  @param p_rtt        Round trip time statistics
+ *  @param percent      Percentile to estimate, 0 - 100
+ *  @return             Upper bound of the bucket holding the percentile, in us
+ */
+uint32_t UARTStats_RttPercentile(const UARTStats_Rtt_T *p_rtt, uint8_t percent);
+
+/*
+ *  Print collected statistics every UART_STATS_PRINT_INTV ms. If ENABLE_UART_STATS_PING
+ *  is set, also send pings every UART_STATS_PING_INTV ms to measure round trip time.
+ *
+ *  @param is_modem_initialized  True if modem finished initialization, pings are sent only then
+ */
+void UARTStats_Loop(bool is_modem_initialized);
+
+#else
+
+static inline void UARTStats_RxFrame(uint8_t cmd)
+{
+    UNUSED(cmd);
+}
+
+static inline void UARTStats_TxFrame(uint8_t cmd)
+{
+    UNUSED(cmd);
+}
+
+static inline void UARTStats_RxBytes(uint32_t len, uint16_t level)
+{
+    UNUSED(len);
+    UNUSED(level);
+}
+
+static inline void UARTStats_TxBytes(uint32_t len, uint16_t level)
+{
+    UNUSED(len);
+    UNUSED(level);
+}
+
+static inline void UARTStats_Resync(uint16_t len)
+{
+    UNUSED(len);
+}
+
+static inline uint32_t UARTStats_HandlerStart(void)
+{
+    return 0;
+}
+
+static inline void UARTStats_HandlerEnd(uint8_t cmd, uint32_t start)
+{
+    UNUSED(cmd);
+    UNUSED(start);
+}
+
+static inline void UARTStats_RxParsePass(void) {}
+static inline void UARTStats_RxPartialFrame(void) {}
+static inline void UARTStats_CrcError(void) {}
+static inline void UARTStats_BadLength(void) {}
+static inline void UARTStats_UnhandledCmd(void) {}
+static inline void UARTStats_RejectedLength(void) {}
+static inline void UARTStats_RxOverrun(void) {}
+static inline void UARTStats_RxLineError(void) {}
+static inline void UARTStats_RxOverwrite(void) {}
+static inline void UARTStats_TxControlDeferred(void) {}
+static inline void UARTStats_TxDeferred(void) {}
+static inline void UARTStats_TxDrop(void) {}
+static inline void UARTStats_Print(void) {}
+static inline void UARTStats_Loop(bool is_modem_initialized)
+{
+    UNUSED(is_modem_initialized);
+}
+
+#endif
+
+#endif    // UART_STATS_H_
@@ -39,6 +39,7 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "SensorInput.h"
 #include "SensorOutput.h"
 #include "UARTProtocol.h"
+#include "UARTStats.h"
 
 #define RTC_TIME_ACCURACY_PPB 10000 /**<  Accuracy of PCF8253 RTC */
 
@@ -841,6 +842,8 @@ void loop()
         LoopAttention();
     }
     UART_ProcessIncomingCommand();
+    LoopDFU();
+    UARTStats_Loop((ModemState == MODEM_STATE_DEVICE) || (ModemState == MODEM_STATE_NODE));
     LoopHealth();
     LoopLightnessServer();
     LoopSDM();
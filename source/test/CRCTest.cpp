@@ -0,0 +1,228 @@
+/*
+Copyright © 2021 Silvair Sp. z o.o. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <time.h>
+
+#include "Arduino.h"
+#include "CRC.h"
+#include "TestCheck.h"
+
+#define CRC16_POLY 0x8005u
+#define CRC32_POLY_REFLECTED 0xEDB88320u
+#define TEST_DATA_LEN 4096
+#define BENCH_ROUNDS 200
+
+static uint8_t TestData[TEST_DATA_LEN];
+
+
+/*
+ *  Reference bitwise CRC16 with polynomial 0x8005, as calculated before lookup tables
+ */
+static uint16_t BitwiseCRC16(const uint8_t *data, size_t len, uint16_t crc)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000u) ? (uint16_t)((crc << 1) ^ CRC16_POLY) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static uint8_t ReflectByte(uint8_t value)
+{
+    uint8_t result = 0;
+    for (int bit = 0; bit < 8; bit++)
+    {
+        result = (result << 1) | ((value >> bit) & 1u);
+    }
+    return result;
+}
+
+/*
+ *  Reference bitwise CRC16 MODBUS, as calculated before lookup tables. Result has
+ *  bytes swapped, so that MODBUS.cpp sending high byte first puts low byte on the wire first.
+ */
+static uint16_t BitwiseCRC16_Modbus(const uint8_t *data, size_t len)
+{
+    uint16_t crc = CRC16_INIT_VAL;
+    for (size_t i = 0; i < len; i++)
+    {
+        uint8_t byte = ReflectByte(data[i]);
+        crc          = BitwiseCRC16(&byte, 1, crc);
+    }
+    return (uint16_t)ReflectByte(lowByte(crc)) | ((uint16_t)ReflectByte(highByte(crc)) << 8);
+}
+
+/*
+ *  Reference bitwise CRC32, as calculated before lookup tables
+ */
+static uint32_t BitwiseCRC32(const uint8_t *data, size_t len, uint32_t crc)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        crc = crc ^ data[i];
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (CRC32_POLY_REFLECTED & ((crc & 1) ? 0xFFFFFFFFu : 0));
+        }
+    }
+    return ~crc;
+}
+
+static void TestKnownAnswers(void)
+{
+    uint8_t check[] = "123456789";
+
+    CHECK_EQUAL(0xAEE7u, CalcCRC16(check, 9, CRC16_INIT_VAL));
+    CHECK_EQUAL(0x374Bu, CalcCRC16_Modbus(check, 9, CRC16_INIT_VAL));
+    CHECK_EQUAL(0xCBF43926u, CalcCRC32(check, 9, CRC32_INIT_VAL));
+    CHECK_EQUAL(CRC16_INIT_VAL, CalcCRC16(check, 0, CRC16_INIT_VAL));
+    CHECK_EQUAL(0u, CalcCRC32(check, 0, CRC32_INIT_VAL));
+}
+
+static void TestTableMatchesBitwise(void)
+{
+    for (size_t len = 0; len <= 300; len++)
+    {
+        size_t   offset = rand() % (TEST_DATA_LEN - len + 1);
+        uint16_t init   = rand();
+
+        CHECK_EQUAL(BitwiseCRC16(&TestData[offset], len, init), CalcCRC16(&TestData[offset], len, init));
+        CHECK_EQUAL(BitwiseCRC16_Modbus(&TestData[offset], len), CalcCRC16_Modbus(&TestData[offset], len, CRC16_INIT_VAL));
+        CHECK_EQUAL(BitwiseCRC32(&TestData[offset], len, CRC32_INIT_VAL), CalcCRC32(&TestData[offset], len, CRC32_INIT_VAL));
+    }
+
+    // Every byte value against 256 different CRC states reaches all table entries
+    for (unsigned value = 0; value < 256; value++)
+    {
+        uint8_t byte = value;
+        for (unsigned init = 0; init < 0x10000u; init += 0x0101u)
+        {
+            CHECK_EQUAL(BitwiseCRC16(&byte, 1, init), CalcCRC16(&byte, 1, init));
+        }
+        for (uint32_t init = 0; init < 0xFF000000u; init += 0x01010101u)
+        {
+            CHECK_EQUAL(BitwiseCRC32(&byte, 1, init), CalcCRC32(&byte, 1, init));
+        }
+    }
+
+    // Slicing-by-4 handles 4 byte blocks, check all alignments and tail lengths
+    for (size_t offset = 0; offset < 4; offset++)
+    {
+        for (size_t len = 0; len <= 12; len++)
+        {
+            uint32_t init = rand();
+            CHECK_EQUAL(BitwiseCRC32(&TestData[offset], len, init), CalcCRC32(&TestData[offset], len, init));
+        }
+    }
+}
+
+static void TestIncrementalFolding(void)
+{
+    // RX parser extends the frame CRC with each batch of received bytes
+    for (int round = 0; round < 200; round++)
+    {
+        size_t   len      = 1 + rand() % 300;
+        uint16_t expected = CalcCRC16(TestData, len, CRC16_INIT_VAL);
+        uint16_t crc      = CRC16_INIT_VAL;
+        size_t   folded   = 0;
+
+        while (folded < len)
+        {
+            size_t batch = rand() % (len - folded + 1);
+            crc          = CalcCRC16(&TestData[folded], batch, crc);
+            folded += batch;
+        }
+
+        CHECK_EQUAL(expected, crc);
+    }
+
+    // DFU extends the image CRC32 with each stored page, passing inverted result as init value
+    for (int round = 0; round < 200; round++)
+    {
+        size_t   len      = 1 + rand() % 3000;
+        uint32_t expected = CalcCRC32(TestData, len, CRC32_INIT_VAL);
+        uint32_t crc      = CalcCRC32(TestData, 0, CRC32_INIT_VAL);
+        size_t   folded   = 0;
+
+        while (folded < len)
+        {
+            size_t batch = rand() % (len - folded + 1);
+            crc          = CalcCRC32(&TestData[folded], batch, ~crc);
+            folded += batch;
+        }
+
+        CHECK_EQUAL(expected, crc);
+    }
+}
+
+/*
+ *  Time CRC function over test data
+ *
+ *  @return             Time in ns per byte
+ */
+template <typename T, typename F>
+static double BenchmarkOne(F calc, T init)
+{
+    volatile T sink  = 0;
+    clock_t    start = clock();
+    for (int round = 0; round < BENCH_ROUNDS; round++)
+    {
+        sink = sink + calc(TestData, TEST_DATA_LEN, init);
+    }
+    return 1e9 * (clock() - start) / CLOCKS_PER_SEC / BENCH_ROUNDS / TEST_DATA_LEN;
+}
+
+static void Benchmark(void)
+{
+    printf("CRC16 (%d entry table): %.2f ns/byte, bitwise: %.2f ns/byte\n",
+           CRC16_TABLE_SIZE,
+           BenchmarkOne<uint16_t>(CalcCRC16, CRC16_INIT_VAL),
+           BenchmarkOne<uint16_t>(BitwiseCRC16, CRC16_INIT_VAL));
+    printf("CRC16 MODBUS (%d entry table): %.2f ns/byte, bitwise: %.2f ns/byte\n",
+           CRC16_MODBUS_TABLE_SIZE,
+           BenchmarkOne<uint16_t>(CalcCRC16_Modbus, CRC16_INIT_VAL),
+           BenchmarkOne<uint16_t>([](const uint8_t *data, size_t len, uint16_t) { return BitwiseCRC16_Modbus(data, len); }, CRC16_INIT_VAL));
+    printf("CRC32 (%d entry table): %.2f ns/byte, bitwise: %.2f ns/byte\n",
+           CRC32_TABLE_SIZE,
+           BenchmarkOne<uint32_t>(CalcCRC32, CRC32_INIT_VAL),
+           BenchmarkOne<uint32_t>(BitwiseCRC32, CRC32_INIT_VAL));
+}
+
+int main(void)
+{
+    srand(1);
+    for (size_t i = 0; i < TEST_DATA_LEN; i++)
+    {
+        TestData[i] = rand();
+    }
+
+    TestKnownAnswers();
+    TestTableMatchesBitwise();
+    TestIncrementalFolding();
+    Benchmark();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,247 @@
+/*
+Copyright © 2021 Silvair Sp. z o.o. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+ *  Checks shared by host tests of streaming decoders. LZ4Decoder and DeltaPatcher
+ *  have the same interface: input is fed in parts of any size, output is limited
+ *  per call and written byte by byte through a callback. Functions are defined
+ *  here, so failed checks are counted by TestCheck.h of the including test.
+ */
+
+#ifndef DECODER_FIXTURE_H_
+#define DECODER_FIXTURE_H_
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "TestCheck.h"
+
+
+#define DECODER_FIXTURE_MAX_OUTPUT_LEN 8192 /**< Output accepted by DecoderFixture_Write */
+#define DECODER_FIXTURE_NO_WRITE_FAIL 0xFFFFFFFFu
+
+typedef struct
+{
+    void (*init)(uint32_t out_size); /**< Initialize decoder writing through DecoderFixture_Write */
+    int (*process)(const uint8_t *p_data, size_t len, size_t max_out, size_t *p_used);
+    bool (*is_done)(void);
+    int  success; /**< Process return code on success */
+} DecoderFixture_Decoder_T;
+
+
+static const DecoderFixture_Decoder_T *DecoderFixture_Decoder = NULL;
+static uint8_t                         DecoderFixture_Output[DECODER_FIXTURE_MAX_OUTPUT_LEN];
+static uint32_t                        DecoderFixture_OutputLen   = 0;
+static uint32_t                        DecoderFixture_WriteFailAt = DECODER_FIXTURE_NO_WRITE_FAIL; /**< Output position at which write callback fails */
+
+/*
+ *  Clear output, then initialize decoder used by the following calls
+ *
+ *  @param p_decoder    Decoder under test
+ *  @param out_size     Declared output size
+ */
+static inline void DecoderFixture_Init(const DecoderFixture_Decoder_T *p_decoder, uint32_t out_size)
+{
+    DecoderFixture_Decoder     = p_decoder;
+    DecoderFixture_OutputLen   = 0;
+    DecoderFixture_WriteFailAt = DECODER_FIXTURE_NO_WRITE_FAIL;
+    DecoderFixture_Decoder->init(out_size);
+}
+
+/*
+ *  Make output write fail at given position, until the next DecoderFixture_Init
+ *
+ *  @param position     Output position
+ */
+static inline void DecoderFixture_SetWriteFail(uint32_t position)
+{
+    DecoderFixture_WriteFailAt = position;
+}
+
+/*
+ *  Output write callback
+ *
+ *  @param data         Byte value
+ *  @return             True on success
+ */
+static inline bool DecoderFixture_Write(uint8_t data)
+{
+    if ((DecoderFixture_OutputLen == DecoderFixture_WriteFailAt) || (DecoderFixture_OutputLen == DECODER_FIXTURE_MAX_OUTPUT_LEN))
+    {
+        return false;
+    }
+
+    DecoderFixture_Output[DecoderFixture_OutputLen++] = data;
+    return true;
+}
+
+/*
+ *  Output read callback, for decoders copying from their own output
+ *
+ *  @param position     Position in output, below output len
+ *  @return             Byte value
+ */
+static inline uint8_t DecoderFixture_Read(uint32_t position)
+{
+    CHECK(position < DecoderFixture_OutputLen);
+    return DecoderFixture_Output[position];
+}
+
+/*
+ *  Get output written since DecoderFixture_Init
+ *
+ *  @return             Pointer to output
+ */
+static inline const uint8_t *DecoderFixture_GetOutput(void)
+{
+    return DecoderFixture_Output;
+}
+
+/*
+ *  Get output len
+ *
+ *  @return             Number of bytes written since DecoderFixture_Init
+ */
+static inline uint32_t DecoderFixture_GetOutputLen(void)
+{
+    return DecoderFixture_OutputLen;
+}
+
+/*
+ *  Feed data in chunks of given size, with output limited per call. Input is fed only
+ *  when decoder needs it, as LoopDFU does with committed pages.
+ *
+ *  @param p_data       Encoded data
+ *  @param len          Data len
+ *  @param chunk        Maximal input len per call
+ *  @param max_out      Maximal output len per call
+ *  @return             Decoder return code of the last call
+ */
+static inline int DecoderFixture_Feed(const uint8_t *p_data, size_t len, size_t chunk, size_t max_out)
+{
+    size_t pos    = 0;
+    int    status = DecoderFixture_Decoder->success;
+
+    for (int idle = 0; (status == DecoderFixture_Decoder->success) && (idle < 2);)
+    {
+        size_t avail = len - pos;
+        size_t used  = 0;
+        size_t start = DecoderFixture_OutputLen;
+
+        if (avail > chunk)
+        {
+            avail = chunk;
+        }
+
+        status = DecoderFixture_Decoder->process(&p_data[pos], avail, max_out, &used);
+        CHECK(used <= avail);
+        CHECK(DecoderFixture_OutputLen - start <= max_out);
+        pos += used;
+
+        idle = ((used == 0) && (DecoderFixture_OutputLen == start)) ? idle + 1 : 0;
+    }
+
+    CHECK((status != DecoderFixture_Decoder->success) || (pos == len));
+    return status;
+}
+
+/*
+ *  Check output against expected data
+ *
+ *  @param p_expected   Expected output
+ *  @param len          Expected output len
+ */
+static inline void DecoderFixture_CheckOutput(const uint8_t *p_expected, size_t len)
+{
+    CHECK_EQUAL(len, DecoderFixture_OutputLen);
+    CHECK(memcmp(p_expected, DecoderFixture_Output, len) == 0);
+}
+
+/*
+ *  Decode data split in two at every byte, then fed byte by byte with output
+ *  limited from one to 64 bytes per call, and check the output each time
+ *
+ *  @param p_decoder    Decoder under test
+ *  @param p_data       Encoded data
+ *  @param len          Data len
+ *  @param p_expected   Expected output
+ *  @param expected_len Expected output len
+ */
+static inline void DecoderFixture_CheckSplits(const DecoderFixture_Decoder_T *p_decoder, const uint8_t *p_data, size_t len, const uint8_t *p_expected, size_t expected_len)
+{
+    for (size_t split = 0; split <= len; split++)
+    {
+        size_t used = 0;
+
+        DecoderFixture_Init(p_decoder, expected_len);
+        CHECK_EQUAL(p_decoder->success, p_decoder->process(p_data, split, DECODER_FIXTURE_MAX_OUTPUT_LEN, &used));
+        CHECK_EQUAL(split, used);
+        CHECK_EQUAL(p_decoder->success, DecoderFixture_Feed(&p_data[split], len - split, len, DECODER_FIXTURE_MAX_OUTPUT_LEN));
+        DecoderFixture_CheckOutput(p_expected, expected_len);
+        CHECK(p_decoder->is_done());
+    }
+
+    for (size_t max_out = 1; max_out <= 64; max_out *= 4)
+    {
+        DecoderFixture_Init(p_decoder, expected_len);
+        CHECK_EQUAL(p_decoder->success, DecoderFixture_Feed(p_data, len, 1, max_out));
+        DecoderFixture_CheckOutput(p_expected, expected_len);
+        CHECK(p_decoder->is_done());
+    }
+}
+
+/*
+ *  Check that decoding stops with given error once output len reaches out_size
+ *
+ *  @param p_decoder    Decoder under test
+ *  @param p_data       Encoded data with output larger than out_size
+ *  @param len          Data len
+ *  @param out_size     Declared output size
+ *  @param error        Expected decoder return code
+ */
+static inline void DecoderFixture_CheckOverflow(const DecoderFixture_Decoder_T *p_decoder, const uint8_t *p_data, size_t len, uint32_t out_size, int error)
+{
+    DecoderFixture_Init(p_decoder, out_size);
+    CHECK_EQUAL(error, DecoderFixture_Feed(p_data, len, len, DECODER_FIXTURE_MAX_OUTPUT_LEN));
+    CHECK_EQUAL(out_size, DecoderFixture_OutputLen);
+}
+
+/*
+ *  Check that decoding stops with given error at failed output write
+ *
+ *  @param p_decoder    Decoder under test
+ *  @param p_data       Encoded data
+ *  @param len          Data len
+ *  @param out_size     Declared output size
+ *  @param fail_at      Position of failed write
+ *  @param error        Expected decoder return code
+ */
+static inline void DecoderFixture_CheckWriteFail(const DecoderFixture_Decoder_T *p_decoder, const uint8_t *p_data, size_t len, uint32_t out_size, uint32_t fail_at, int error)
+{
+    DecoderFixture_Init(p_decoder, out_size);
+    DecoderFixture_SetWriteFail(fail_at);
+    CHECK_EQUAL(error, DecoderFixture_Feed(p_data, len, len, DECODER_FIXTURE_MAX_OUTPUT_LEN));
+    CHECK_EQUAL(fail_at, DecoderFixture_OutputLen);
+}
+
+#endif    // DECODER_FIXTURE_H_
@@ -0,0 +1,127 @@
+/*
+Copyright © 2021 Silvair Sp. z o.o. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "DeltaGenerator.h"
+
+#include <string.h>
+
+#include "DeltaPatcher.h"
+
+#define HASH_BITS 14
+#define MIN_COPY 12 /**< Shorter copy with the insert it splits costs more than inserting the bytes */
+#define MAX_OP_LEN 0xFFFFu
+
+
+static uint8_t *AddCopy(uint8_t *p_patch, size_t offset, size_t len);
+static uint8_t *AddInsert(uint8_t *p_patch, const uint8_t *p_data, size_t len);
+static uint32_t Hash(const uint8_t *p_data);
+
+
+size_t DeltaGenerator_Diff(const uint8_t *p_base, size_t base_len, const uint8_t *p_new, size_t new_len, uint8_t *p_patch)
+{
+    static uint32_t table[1u << HASH_BITS];
+    uint8_t        *p_out  = p_patch;
+    size_t          anchor = 0;
+    size_t          pos    = 0;
+
+    // Positions are stored plus one, so zero marks an empty slot. Later positions win,
+    // which favours the most recent copy of repeated code.
+    memset(table, 0, sizeof(table));
+    for (size_t i = 0; i + MIN_COPY <= base_len; i++)
+    {
+        table[Hash(&p_base[i])] = i + 1;
+    }
+
+    while (pos + MIN_COPY <= new_len)
+    {
+        size_t candidate = table[Hash(&p_new[pos])];
+
+        if ((candidate == 0) || (memcmp(&p_base[candidate - 1], &p_new[pos], MIN_COPY) != 0))
+        {
+            pos++;
+            continue;
+        }
+
+        size_t offset = candidate - 1;
+        size_t len    = MIN_COPY;
+        while ((offset + len < base_len) && (pos + len < new_len) && (p_base[offset + len] == p_new[pos + len]))
+        {
+            len++;
+        }
+
+        p_out = AddInsert(p_out, &p_new[anchor], pos - anchor);
+        p_out = AddCopy(p_out, offset, len);
+        pos += len;
+        anchor = pos;
+    }
+
+    p_out = AddInsert(p_out, &p_new[anchor], new_len - anchor);
+
+    return p_out - p_patch;
+}
+
+static uint8_t *AddCopy(uint8_t *p_patch, size_t offset, size_t len)
+{
+    while (len > 0)
+    {
+        size_t op_len = (len < MAX_OP_LEN) ? len : MAX_OP_LEN;
+
+        *p_patch++ = DELTAPATCHER_OP_COPY;
+        for (size_t i = 0; i < sizeof(uint32_t); i++)
+        {
+            *p_patch++ = (uint8_t)(offset >> (8 * i));
+        }
+        *p_patch++ = (uint8_t)op_len;
+        *p_patch++ = (uint8_t)(op_len >> 8);
+
+        offset += op_len;
+        len -= op_len;
+    }
+    return p_patch;
+}
+
+static uint8_t *AddInsert(uint8_t *p_patch, const uint8_t *p_data, size_t len)
+{
+    while (len > 0)
+    {
+        size_t op_len = (len < MAX_OP_LEN) ? len : MAX_OP_LEN;
+
+        *p_patch++ = DELTAPATCHER_OP_INSERT;
+        *p_patch++ = (uint8_t)op_len;
+        *p_patch++ = (uint8_t)(op_len >> 8);
+        memcpy(p_patch, p_data, op_len);
+
+        p_patch += op_len;
+        p_data += op_len;
+        len -= op_len;
+    }
+    return p_patch;
+}
+
+static uint32_t Hash(const uint8_t *p_data)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < MIN_COPY; i++)
+    {
+        hash = (hash ^ p_data[i]) * 16777619u;
+    }
+    return hash >> (32 - HASH_BITS);
+}
@@ -0,0 +1,52 @@
+/*
+Copyright © 2021 Silvair Sp. z o.o. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+ *  Minimal patch generator for host tests. Emits DeltaPatcher COPY operations
+ *  for parts of the new image found in the base image and INSERT operations
+ *  for the rest. Matching is greedy over a hash of MIN_COPY byte sequences.
+ */
+
+#ifndef DELTA_GENERATOR_H_
+#define DELTA_GENERATOR_H_
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/**< Patch buffer size enough for any new image of given length */
+#define DELTA_GENERATOR_BOUND(len) ((len) + 3 * ((len) / 0xFFFFu + 2))
+
+
+/*
+ *  Generate patch transforming base image into new image
+ *
+ *  @param p_base       Base image
+ *  @param base_len     Base image len
+ *  @param p_new        New image
+ *  @param new_len      New image len
+ *  @param p_patch      [out] Patch, at least DELTA_GENERATOR_BOUND(new_len) bytes
+ *  @return             Patch len
+ */
+size_t DeltaGenerator_Diff(const uint8_t *p_base, size_t base_len, const uint8_t *p_new, size_t new_len, uint8_t *p_patch);
+
+#endif    // DELTA_GENERATOR_H_
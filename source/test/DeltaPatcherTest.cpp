@@ -0,0 +1,380 @@
+/*
+Copyright © 2021 Silvair Sp. z o.o. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "DecoderFixture.h"
+#include "DeltaGenerator.h"
+#include "DeltaPatcher.h"
+#include "TestCheck.h"
+
+#define BASE_SIZE 3000u
+#define MAX_OUTPUT_LEN DECODER_FIXTURE_MAX_OUTPUT_LEN
+#define MAX_PATCH_LEN (2 * MAX_OUTPUT_LEN)
+
+static DeltaPatcher_T Patcher;
+static uint8_t        Base[BASE_SIZE];
+static uint8_t        Patch[MAX_PATCH_LEN];
+static size_t         PatchLen    = 0;
+static uint8_t        Expected[MAX_OUTPUT_LEN];
+static size_t         ExpectedLen = 0;
+
+
+static uint8_t ReadBase(uint32_t position)
+{
+    CHECK(position < BASE_SIZE);
+    return (position < BASE_SIZE) ? Base[position] : 0;
+}
+
+static void PatcherInit(uint32_t out_size)
+{
+    DeltaPatcher_Init(&Patcher, BASE_SIZE, out_size, ReadBase, DecoderFixture_Write);
+}
+
+static int PatcherProcess(const uint8_t *p_data, size_t len, size_t max_out, size_t *p_used)
+{
+    return DeltaPatcher_Process(&Patcher, p_data, len, max_out, p_used);
+}
+
+static bool PatcherIsDone(void)
+{
+    return DeltaPatcher_IsDone(&Patcher);
+}
+
+static const DecoderFixture_Decoder_T Delta = {PatcherInit, PatcherProcess, PatcherIsDone, DELTAPATCHER_SUCCESS};
+
+/*
+ *  Start building patch and its expected output
+ */
+static void PatchStart(void)
+{
+    PatchLen    = 0;
+    ExpectedLen = 0;
+}
+
+static void PatchAddCopy(uint32_t offset, uint16_t len)
+{
+    Patch[PatchLen++] = DELTAPATCHER_OP_COPY;
+    for (size_t i = 0; i < sizeof(offset); i++)
+    {
+        Patch[PatchLen++] = offset >> (8 * i);
+    }
+    Patch[PatchLen++] = len;
+    Patch[PatchLen++] = len >> 8;
+
+    // Expected output only for copies within base image
+    for (size_t i = 0; (i < len) && (offset + i < BASE_SIZE); i++)
+    {
+        Expected[ExpectedLen++] = Base[offset + i];
+    }
+}
+
+static void PatchAddInsert(const uint8_t *p_data, uint16_t len)
+{
+    Patch[PatchLen++] = DELTAPATCHER_OP_INSERT;
+    Patch[PatchLen++] = len;
+    Patch[PatchLen++] = len >> 8;
+
+    memcpy(&Patch[PatchLen], p_data, len);
+    PatchLen += len;
+    memcpy(&Expected[ExpectedLen], p_data, len);
+    ExpectedLen += len;
+}
+
+static void CheckOutput(void)
+{
+    DecoderFixture_CheckOutput(Expected, ExpectedLen);
+}
+
+static void TestCopyLimits(void)
+{
+    // Copies ending exactly at base image end, including an empty one starting there
+    PatchStart();
+    PatchAddCopy(0, BASE_SIZE);
+    PatchAddCopy(BASE_SIZE - 1, 1);
+    PatchAddCopy(BASE_SIZE, 0);
+    DecoderFixture_Init(&Delta, ExpectedLen);
+    CHECK_EQUAL(DELTAPATCHER_SUCCESS, DecoderFixture_Feed(Patch, PatchLen, PatchLen, MAX_OUTPUT_LEN));
+    CheckOutput();
+    CHECK(DeltaPatcher_IsDone(&Patcher));
+
+    // Copies reaching past base image end fail before any byte is copied
+    const uint32_t offsets[] = {BASE_SIZE, BASE_SIZE - 1, 1, BASE_SIZE + 1, 0xFFFFFFFFu, 0xFFFFFFFFu - 1};
+    const uint16_t lengths[] = {1, 2, 0xFFFF, 0, 1, 2};
+    for (size_t i = 0; i < sizeof(offsets) / sizeof(offsets[0]); i++)
+    {
+        PatchStart();
+        PatchAddCopy(offsets[i], lengths[i]);
+        DecoderFixture_Init(&Delta, MAX_OUTPUT_LEN);
+        CHECK_EQUAL(DELTAPATCHER_ERROR_RANGE, DecoderFixture_Feed(Patch, PatchLen, PatchLen, MAX_OUTPUT_LEN));
+        CHECK_EQUAL(0, DecoderFixture_GetOutputLen());
+    }
+}
+
+static void TestZeroLength(void)
+{
+    const uint8_t data[] = {0x11, 0x22, 0x33};
+
+    // Empty operations at start, between others and after the output is complete
+    PatchStart();
+    PatchAddInsert(data, 0);
+    PatchAddCopy(10, 0);
+    PatchAddInsert(data, sizeof(data));
+    PatchAddCopy(0, 0);
+    PatchAddInsert(data, 0);
+    PatchAddCopy(20, 5);
+    PatchAddCopy(BASE_SIZE, 0);
+    PatchAddInsert(data, 0);
+
+    for (size_t chunk = 1; chunk <= PatchLen; chunk++)
+    {
+        DecoderFixture_Init(&Delta, ExpectedLen);
+        CHECK_EQUAL(DELTAPATCHER_SUCCESS, DecoderFixture_Feed(Patch, PatchLen, chunk, MAX_OUTPUT_LEN));
+        CheckOutput();
+        CHECK(DeltaPatcher_IsDone(&Patcher));
+        CHECK(DeltaPatcher_IsWaitingForInput(&Patcher));
+    }
+
+    // Empty output is done without any patch data
+    DecoderFixture_Init(&Delta, 0);
+    CHECK(DeltaPatcher_IsDone(&Patcher));
+}
+
+static void TestUnknownOpcode(void)
+{
+    const uint8_t data[] = {0xAB};
+
+    const uint8_t opcodes[] = {0x00, 0x03, 0x80, 0xFF};
+    for (size_t i = 0; i < sizeof(opcodes) / sizeof(opcodes[0]); i++)
+    {
+        PatchStart();
+        PatchAddInsert(data, sizeof(data));
+        Patch[PatchLen++] = opcodes[i];
+        PatchAddInsert(data, sizeof(data));
+
+        DecoderFixture_Init(&Delta, ExpectedLen);
+        CHECK_EQUAL(DELTAPATCHER_ERROR_OPCODE, DecoderFixture_Feed(Patch, PatchLen, 1, MAX_OUTPUT_LEN));
+        CHECK_EQUAL(1, DecoderFixture_GetOutputLen());
+        CHECK(!DeltaPatcher_IsDone(&Patcher));
+    }
+}
+
+static void TestOverflow(void)
+{
+    const uint8_t data[] = "overflow";
+
+    PatchStart();
+    PatchAddInsert(data, 8);
+    PatchAddCopy(100, 8);
+    PatchAddInsert(data, 8);
+
+    // Output larger than declared size fails in an insert, in a copy, and in an operation after the output is complete
+    const uint32_t out_sizes[] = {4, 12, 16, 20};
+    for (size_t i = 0; i < sizeof(out_sizes) / sizeof(out_sizes[0]); i++)
+    {
+        DecoderFixture_CheckOverflow(&Delta, Patch, PatchLen, out_sizes[i], DELTAPATCHER_ERROR_OVERFLOW);
+    }
+}
+
+static void TestWriteFail(void)
+{
+    const uint8_t data[] = "write";
+
+    PatchStart();
+    PatchAddInsert(data, 5);
+    PatchAddCopy(0, 10);
+
+    // Failed write of inserted and of copied byte stops patching
+    const uint32_t fail_at[] = {2, 9};
+    for (size_t i = 0; i < sizeof(fail_at) / sizeof(fail_at[0]); i++)
+    {
+        DecoderFixture_CheckWriteFail(&Delta, Patch, PatchLen, ExpectedLen, fail_at[i], DELTAPATCHER_ERROR_OUTPUT);
+    }
+}
+
+static void TestSplitAtEveryByte(void)
+{
+    uint8_t data[300];
+
+    for (size_t i = 0; i < sizeof(data); i++)
+    {
+        data[i] = i ^ 0xA5;
+    }
+
+    // Arguments with bytes that look like opcodes
+    PatchStart();
+    PatchAddCopy(0x0102, 0x0201);
+    PatchAddInsert(data, 0x0102);
+    PatchAddCopy(BASE_SIZE - 0x0101, 0x0101);
+    PatchAddInsert(data, 2);
+
+    DecoderFixture_CheckSplits(&Delta, Patch, PatchLen, Expected, ExpectedLen);
+
+    // Patch cut inside arguments is not done, even with the whole output written
+    PatchStart();
+    PatchAddInsert(data, 4);
+    PatchAddCopy(0, 0);
+    for (size_t cut = PatchLen - 6; cut < PatchLen; cut++)
+    {
+        DecoderFixture_Init(&Delta, ExpectedLen);
+        CHECK_EQUAL(DELTAPATCHER_SUCCESS, DecoderFixture_Feed(Patch, cut, 1, MAX_OUTPUT_LEN));
+        CHECK(!DeltaPatcher_IsDone(&Patcher));
+    }
+}
+
+static void TestRandomPatches(void)
+{
+    uint8_t data[600];
+
+    for (int round = 0; round < 200; round++)
+    {
+        PatchStart();
+        for (size_t i = 0; i < sizeof(data); i++)
+        {
+            data[i] = rand();
+        }
+
+        while (ExpectedLen < MAX_OUTPUT_LEN / 2)
+        {
+            if (rand() % 2 == 0)
+            {
+                uint16_t len = rand() % 600;
+                PatchAddCopy(rand() % (BASE_SIZE - len + 1), len);
+            }
+            else
+            {
+                PatchAddInsert(data, rand() % sizeof(data));
+            }
+        }
+
+        DecoderFixture_Init(&Delta, ExpectedLen);
+        CHECK_EQUAL(DELTAPATCHER_SUCCESS, DecoderFixture_Feed(Patch, PatchLen, 1 + rand() % 300, 1 + rand() % 100));
+        CheckOutput();
+        CHECK(DeltaPatcher_IsDone(&Patcher));
+    }
+}
+
+/*
+ *  Build new image in Expected from base image with typical firmware changes
+ *
+ *  @param kind         Change kind
+ */
+static void MakeModifiedImage(int kind)
+{
+    size_t at  = rand() % BASE_SIZE;
+    size_t len = 1 + rand() % 200;
+
+    memcpy(Expected, Base, BASE_SIZE);
+    ExpectedLen = BASE_SIZE;
+
+    if (at + len > BASE_SIZE)
+    {
+        len = BASE_SIZE - at;
+    }
+
+    switch (kind)
+    {
+        case 0:
+            // Identical image
+            break;
+        case 1:
+            // Changed constants scattered over the image
+            for (int i = 0; i < 8; i++)
+            {
+                Expected[rand() % BASE_SIZE] ^= 1 + rand() % 0xFF;
+            }
+            break;
+        case 2:
+            // New code in the middle shifts everything after it
+            memmove(&Expected[at + len], &Expected[at], BASE_SIZE - at);
+            for (size_t i = 0; i < len; i++)
+            {
+                Expected[at + i] = rand();
+            }
+            ExpectedLen += len;
+            break;
+        case 3:
+            // Removed code
+            memmove(&Expected[at], &Expected[at + len], BASE_SIZE - at - len);
+            ExpectedLen -= len;
+            break;
+        case 4:
+            // Function moved to the end and image grown
+            memcpy(&Expected[BASE_SIZE], &Base[at], len);
+            ExpectedLen += len;
+            for (size_t i = 0; i < 1000; i++)
+            {
+                Expected[ExpectedLen++] = rand();
+            }
+            break;
+        default:
+            // Unrelated image
+            for (size_t i = 0; i < BASE_SIZE; i++)
+            {
+                Expected[i] = rand();
+            }
+            break;
+    }
+}
+
+static void TestGeneratedPatches(void)
+{
+    for (int round = 0; round < 300; round++)
+    {
+        int kind = round % 6;
+
+        MakeModifiedImage(kind);
+        PatchLen = DeltaGenerator_Diff(Base, BASE_SIZE, Expected, ExpectedLen, Patch);
+        CHECK(PatchLen <= DELTA_GENERATOR_BOUND(ExpectedLen));
+
+        // Small changes give patches much smaller than the image
+        if (kind <= 3)
+        {
+            CHECK(PatchLen < ExpectedLen / 2);
+        }
+
+        DecoderFixture_Init(&Delta, ExpectedLen);
+        CHECK_EQUAL(DELTAPATCHER_SUCCESS, DecoderFixture_Feed(Patch, PatchLen, 1 + rand() % 300, 1 + rand() % 100));
+        CheckOutput();
+        CHECK(DeltaPatcher_IsDone(&Patcher));
+    }
+}
+
+int main(void)
+{
+    srand(1);
+    for (size_t i = 0; i < BASE_SIZE; i++)
+    {
+        Base[i] = rand();
+    }
+
+    TestCopyLimits();
+    TestZeroLength();
+    TestUnknownOpcode();
+    TestOverflow();
+    TestWriteFail();
+    TestSplitAtEveryByte();
+    TestRandomPatches();
+    TestGeneratedPatches();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,261 @@
+/*
+Copyright © 2021 Silvair Sp. z o.o. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "FakeFlasher.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "FlasherSectors.h"
+
+#define ERASED_WORD 0xFFFFFFFFu
+
+jmp_buf FakeFlasher_Reboot;
+
+static uint8_t *Memory = NULL;
+static uint32_t EraseCount[FLASHER_SECTOR_COUNT];
+static uint32_t ProgramCount    = 0;
+static uint32_t NotErasedCount  = 0;
+static uint32_t UpdateWords     = 0;
+static uint32_t PowerOffWords   = 0;
+static bool     IsPowerOffArmed = false;
+
+
+/*
+ *  Get offset from flash start of address in storage space
+ *
+ *  @param address      Flash address
+ *  @return             Offset, or FAKE_FLASHER_SIZE if address is outside storage space
+ */
+static uint32_t SpaceOffset(uint32_t address);
+
+/*
+ *  Check if power was cut, counting programmed word against power off budget
+ *
+ *  @return             True if the word cannot be programmed
+ */
+static bool IsPowerLost(void);
+
+
+void FakeFlasher_Reset(uint32_t seed)
+{
+    if (Memory == NULL)
+    {
+        // Code under test reads flash through 32-bit addresses, so it is mapped in the low 4 GB
+        void *p_map = mmap(NULL, FAKE_FLASHER_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+        if (p_map == MAP_FAILED)
+        {
+            printf("Fake flash not mapped\n");
+            exit(1);
+        }
+        Memory = (uint8_t *)p_map;
+    }
+
+    uint32_t random = seed;
+    for (uint32_t i = 0; i < FAKE_FLASHER_SIZE; i += sizeof(random))
+    {
+        random = random * 1664525u + 1013904223u;
+        memcpy(&Memory[i], &random, sizeof(random));
+    }
+
+    memset(EraseCount, 0, sizeof(EraseCount));
+    ProgramCount    = 0;
+    NotErasedCount  = 0;
+    UpdateWords     = 0;
+    IsPowerOffArmed = false;
+}
+
+uint8_t *FakeFlasher_GetMemory(void)
+{
+    return Memory;
+}
+
+void FakeFlasher_PowerOffAfter(uint32_t words)
+{
+    PowerOffWords   = words;
+    IsPowerOffArmed = true;
+}
+
+void FakeFlasher_PowerOn(void)
+{
+    IsPowerOffArmed = false;
+}
+
+bool FakeFlasher_IsPowerOff(void)
+{
+    return IsPowerOffArmed && (PowerOffWords == 0);
+}
+
+uint32_t FakeFlasher_GetEraseCount(uint32_t sector)
+{
+    return EraseCount[sector];
+}
+
+uint32_t FakeFlasher_GetProgramCount(void)
+{
+    return ProgramCount;
+}
+
+uint32_t FakeFlasher_GetNotErasedCount(void)
+{
+    return NotErasedCount;
+}
+
+uint32_t FakeFlasher_GetUpdateWords(void)
+{
+    return UpdateWords;
+}
+
+int Flasher_UpdateFirmware(uint32_t num_of_words)
+{
+    UpdateWords = num_of_words;
+    longjmp(FakeFlasher_Reboot, 1);
+}
+
+uint32_t Flasher_CountChangedSectors(uint32_t num_of_words)
+{
+    return Flasher_CountSectorsToRewrite(Flasher_GetFirmwareAddr(), Flasher_GetSpaceAddr(), num_of_words);
+}
+
+int Flasher_FlashWord(uint32_t address, uint32_t word_value, bool reenable_irq)
+{
+    (void)reenable_irq;
+
+    return Flasher_SaveMemoryToFlash(address, &word_value, 1);
+}
+
+uint32_t Flasher_GetSpaceAddr(void)
+{
+    return Flasher_GetFirmwareAddr() + FAKE_FLASHER_SPACE_OFFSET;
+}
+
+uint32_t Flasher_GetFirmwareAddr(void)
+{
+    return (uint32_t)(uintptr_t)Memory;
+}
+
+size_t Flasher_GetSpaceSize(void)
+{
+    return FAKE_FLASHER_SIZE - FAKE_FLASHER_SPACE_OFFSET - FAKE_FLASHER_EEPROM_SIZE;
+}
+
+int Flasher_EraseSpace(void)
+{
+    for (size_t offset = 0; offset < Flasher_GetSpaceSize(); offset += FLASHER_SECTOR_SIZE)
+    {
+        int ret_val = Flasher_EraseSpaceSector(Flasher_GetSpaceAddr() + offset);
+        if (ret_val != FLASHER_SUCCESS)
+        {
+            return ret_val;
+        }
+    }
+
+    return FLASHER_SUCCESS;
+}
+
+int Flasher_EraseSpaceSector(uint32_t address)
+{
+    uint32_t offset = SpaceOffset(address);
+
+    if (offset == FAKE_FLASHER_SIZE)
+    {
+        return FLASHER_ERROR_RANGE;
+    }
+    if (offset % FLASHER_SECTOR_SIZE != 0)
+    {
+        return FLASHER_ERROR_ALIGNMENT;
+    }
+    if (FakeFlasher_IsPowerOff())
+    {
+        return FLASHER_ERROR_CONTROLLER;
+    }
+
+    memset(&Memory[offset], 0xFF, FLASHER_SECTOR_SIZE);
+    EraseCount[offset / FLASHER_SECTOR_SIZE]++;
+
+    return FLASHER_SUCCESS;
+}
+
+int Flasher_SaveMemoryToFlash(uint32_t address, const uint32_t *src, uint32_t num_of_words)
+{
+    uint32_t offset = SpaceOffset(address);
+    uint32_t len    = num_of_words * sizeof(uint32_t);
+
+    if ((offset == FAKE_FLASHER_SIZE) || ((len > 0) && (SpaceOffset(address + len - 1) == FAKE_FLASHER_SIZE)))
+    {
+        return FLASHER_ERROR_RANGE;
+    }
+    if (offset % sizeof(uint32_t) != 0)
+    {
+        return FLASHER_ERROR_ALIGNMENT;
+    }
+
+    for (uint32_t i = 0; i < num_of_words; i++)
+    {
+        uint32_t word;
+        memcpy(&word, &Memory[offset + i * 4], sizeof(word));
+
+        if (word != ERASED_WORD)
+        {
+            NotErasedCount++;
+            return FLASHER_ERROR_NOT_ERASED;
+        }
+        if (IsPowerLost())
+        {
+            return FLASHER_ERROR_CONTROLLER;
+        }
+
+        memcpy(&Memory[offset + i * 4], &src[i], sizeof(word));
+        ProgramCount++;
+    }
+
+    return FLASHER_SUCCESS;
+}
+
+
+static uint32_t SpaceOffset(uint32_t address)
+{
+    uint32_t space_start = Flasher_GetSpaceAddr();
+
+    if ((address < space_start) || (address >= space_start + Flasher_GetSpaceSize()))
+    {
+        return FAKE_FLASHER_SIZE;
+    }
+
+    return address - Flasher_GetFirmwareAddr();
+}
+
+static bool IsPowerLost(void)
+{
+    if (!IsPowerOffArmed)
+    {
+        return false;
+    }
+    if (PowerOffWords == 0)
+    {
+        return true;
+    }
+
+    PowerOffWords--;
+    return false;
+}
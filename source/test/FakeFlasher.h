@@ -0,0 +1,109 @@
+/*
+Copyright © 2021 Silvair Sp. z o.o. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+ *  Flasher.h implemented over RAM for host tests. Writes behave like NOR flash:
+ *  a word can be programmed only if it is erased, and erase works on whole sectors.
+ *  Flash content left by the previous test is random, so missing erases show up.
+ */
+
+#ifndef FAKE_FLASHER_H_
+#define FAKE_FLASHER_H_
+
+
+#include <setjmp.h>
+#include <stdint.h>
+
+#include "Flasher.h"
+
+
+#define FAKE_FLASHER_SIZE (FLASHER_SECTOR_COUNT * FLASHER_SECTOR_SIZE)
+#define FAKE_FLASHER_SPACE_OFFSET (20 * FLASHER_SECTOR_SIZE) /**< Running firmware takes flash below storage space */
+#define FAKE_FLASHER_EEPROM_SIZE (2 * FLASHER_SECTOR_SIZE)    /**< Flash at the end emulating EEPROM, not part of storage space */
+
+/**< Flasher_UpdateFirmware jumps here instead of rebooting, set it with setjmp before code that can finish DFU */
+extern jmp_buf FakeFlasher_Reboot;
+
+
+/*
+ *  Fill whole flash with random data and clear counters
+ *
+ *  @param seed         Seed of random flash content
+ */
+void FakeFlasher_Reset(uint32_t seed);
+
+/*
+ *  Get flash memory
+ *
+ *  @return             Pointer to first flash byte, Flasher_GetFirmwareAddr
+ */
+uint8_t *FakeFlasher_GetMemory(void);
+
+/*
+ *  Cut power after given number of programmed words. From then on erase and
+ *  program calls do nothing and fail, until FakeFlasher_PowerOn.
+ *
+ *  @param words        Number of words programmed before power is lost
+ */
+void FakeFlasher_PowerOffAfter(uint32_t words);
+
+/*
+ *  Restore power cut by FakeFlasher_PowerOffAfter, flash content is kept
+ */
+void FakeFlasher_PowerOn(void);
+
+/*
+ *  Check if power was cut by FakeFlasher_PowerOffAfter
+ *
+ *  @return             True if flash stopped working
+ */
+bool FakeFlasher_IsPowerOff(void);
+
+/*
+ *  Get number of erases of flash sector
+ *
+ *  @param sector       Sector index counted from flash start
+ *  @return             Number of erases since FakeFlasher_Reset
+ */
+uint32_t FakeFlasher_GetEraseCount(uint32_t sector);
+
+/*
+ *  Get number of words programmed
+ *
+ *  @return             Number of words since FakeFlasher_Reset
+ */
+uint32_t FakeFlasher_GetProgramCount(void);
+
+/*
+ *  Get number of program calls rejected because the word was not erased
+ *
+ *  @return             Number of rejected calls since FakeFlasher_Reset
+ */
+uint32_t FakeFlasher_GetNotErasedCount(void);
+
+/*
+ *  Get image size passed to Flasher_UpdateFirmware
+ *
+ *  @return             Number of words, or 0 if not called since FakeFlasher_Reset
+ */
+uint32_t FakeFlasher_GetUpdateWords(void);
+
+#endif    // FAKE_FLASHER_H_
@@ -0,0 +1,194 @@
+/*
+Copyright © 2021 Silvair Sp. z o.o. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "FakeUARTDriver.h"
+
+#include "Arduino.h"
+#include "RingBuffer.h"
+
+#define TX_BUFFER_LEN 512
+
+static uint8_t      RxBuf[FAKE_UART_DRIVER_RX_BUFFER_LEN];
+static uint8_t      TxBuf[TX_BUFFER_LEN];
+static RingBuffer_T RxRing;
+static RingBuffer_T TxRing;
+static bool         IsRxNewData = false;
+static bool         IsRxLost    = false;
+static bool         IsRxIdle    = false;
+static uint8_t      TxCapture[FAKE_UART_DRIVER_TX_CAPTURE_LEN];
+static uint16_t     TxCaptureLen = 0;
+static bool         IsTxStalled  = false;
+static uint32_t     TxStallStart = 0;
+static uint32_t     TxStallLen   = 0;
+
+
+/*
+ *  Move committed TX bytes to capture buffer, as if TX DMA sent them at once.
+ *  Bytes stay in TX buffer while TX is stalled.
+ */
+static void TxDrain(void);
+
+
+void FakeUARTDriver_Reset(void)
+{
+    RINGBUFFER_INIT(&RxRing, RxBuf);
+    RINGBUFFER_INIT(&TxRing, TxBuf);
+    IsRxNewData  = false;
+    IsRxLost     = false;
+    IsRxIdle     = false;
+    TxCaptureLen = 0;
+    IsTxStalled  = false;
+}
+
+uint16_t FakeUARTDriver_Receive(const uint8_t *p_data, uint16_t len)
+{
+    uint16_t free_len = FAKE_UART_DRIVER_RX_BUFFER_LEN - RingBuffer_DataLen(&RxRing);
+
+    if (len > free_len)
+    {
+        len = free_len;
+    }
+
+    RingBuffer_QueueBytes(&RxRing, (uint8_t *)p_data, len);
+    IsRxNewData |= (len != 0);
+    return len;
+}
+
+void FakeUARTDriver_RxIdle(void)
+{
+    IsRxIdle = true;
+}
+
+void FakeUARTDriver_LoseRxData(void)
+{
+    IsRxLost = true;
+}
+
+void FakeUARTDriver_StallTx(uint32_t duration_us)
+{
+    IsTxStalled  = true;
+    TxStallStart = micros();
+    TxStallLen   = duration_us;
+}
+
+const uint8_t *FakeUARTDriver_GetTx(uint16_t *p_len)
+{
+    *p_len = TxCaptureLen;
+    return TxCapture;
+}
+
+void UARTDriver_Init(void)
+{
+    FakeUARTDriver_Reset();
+}
+
+bool UARTDriver_TxReserve(uint16_t len, RingBuffer_View_T *p_view)
+{
+    TxDrain();
+    return RingBuffer_Reserve(&TxRing, len, p_view);
+}
+
+uint16_t UARTDriver_TxFreeSpace(void)
+{
+    TxDrain();
+    return TX_BUFFER_LEN - RingBuffer_DataLen(&TxRing);
+}
+
+void UARTDriver_TxCommit(uint16_t len)
+{
+    RingBuffer_Commit(&TxRing, len);
+    TxDrain();
+}
+
+uint16_t UARTDriver_RxDataLen(void)
+{
+    return RingBuffer_DataLen(&RxRing);
+}
+
+uint8_t UARTDriver_RxPeekByte(uint16_t offset)
+{
+    return RingBuffer_PeekByte(&RxRing, offset);
+}
+
+bool UARTDriver_RxPeek(uint16_t offset, uint16_t len, RingBuffer_View_T *p_view)
+{
+    return RingBuffer_Peek(&RxRing, offset, len, p_view);
+}
+
+void UARTDriver_RxRelease(uint16_t len)
+{
+    RingBuffer_IncrementRdIndex(&RxRing, len);
+}
+
+bool UARTDriver_RxDataLost(void)
+{
+    if (!IsRxLost)
+    {
+        return false;
+    }
+
+    IsRxLost = false;
+    RingBuffer_IncrementRdIndex(&RxRing, RingBuffer_DataLen(&RxRing));
+    return true;
+}
+
+bool UARTDriver_RxLineIdle(void)
+{
+    bool is_idle = IsRxIdle;
+
+    IsRxIdle = false;
+    return is_idle;
+}
+
+bool UARTDriver_RxDMAPoll(void)
+{
+    bool is_new_data = IsRxNewData;
+
+    // Stalled TX resumes on the next loop pass after the mock clock passes the stall
+    TxDrain();
+
+    IsRxNewData = false;
+    return is_new_data;
+}
+
+static void TxDrain(void)
+{
+    uint8_t byte;
+
+    if (IsTxStalled)
+    {
+        if (micros() - TxStallStart < TxStallLen)
+        {
+            return;
+        }
+
+        IsTxStalled = false;
+    }
+
+    while (RingBuffer_DequeueByte(&TxRing, &byte))
+    {
+        if (TxCaptureLen == sizeof(TxCapture))
+        {
+            TxCaptureLen = 0;
+        }
+        TxCapture[TxCaptureLen++] = byte;
+    }
+}
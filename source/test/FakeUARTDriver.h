@@ -0,0 +1,79 @@
+/*
+Copyright © 2021 Silvair Sp. z o.o. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+ *  UARTDriver.h implemented over plain ring buffers for host tests. Received bytes
+ *  are injected by the test, transmitted frames are captured for inspection.
+ */
+
+#ifndef FAKE_UART_DRIVER_H_
+#define FAKE_UART_DRIVER_H_
+
+
+#include <stdint.h>
+
+#include "UARTDriver.h"
+
+
+#define FAKE_UART_DRIVER_RX_BUFFER_LEN 512 /**< Same RX buffer length as in UARTDriver.cpp */
+#define FAKE_UART_DRIVER_TX_CAPTURE_LEN 4096
+
+
+/*
+ *  Clear RX buffer, captured TX bytes, loss and idle flags and TX stall
+ */
+void FakeUARTDriver_Reset(void);
+
+/*
+ *  Place bytes in RX buffer, as RX DMA would. Bytes that do not fit are not accepted.
+ *
+ *  @param p_data       Received bytes
+ *  @param len          Number of bytes
+ *  @return             Number of accepted bytes
+ */
+uint16_t FakeUARTDriver_Receive(const uint8_t *p_data, uint16_t len);
+
+/*
+ *  Report RX line idle on the next UARTDriver_RxLineIdle call, as idle-line interrupt would
+ */
+void FakeUARTDriver_RxIdle(void);
+
+/*
+ *  Report lost received bytes on the next UARTDriver_RxDataLost call
+ */
+void FakeUARTDriver_LoseRxData(void);
+
+/*
+ *  Stop sending TX bytes for a given time of the mock clock
+ *
+ *  @param duration_us  Stall duration in microseconds
+ */
+void FakeUARTDriver_StallTx(uint32_t duration_us);
+
+/*
+ *  Get transmitted bytes. Capture starts over when FAKE_UART_DRIVER_TX_CAPTURE_LEN bytes are exceeded.
+ *
+ *  @param p_len        [out] Number of captured bytes
+ *  @return             Captured bytes
+ */
+const uint8_t *FakeUARTDriver_GetTx(uint16_t *p_len);
+
+#endif    // FAKE_UART_DRIVER_H_
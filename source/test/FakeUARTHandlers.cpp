@@ -0,0 +1,93 @@
+/*
+Copyright © 2021 Silvair Sp. z o.o. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "FakeUARTHandlers.h"
+
+#include <stddef.h>
+
+#include "MeshTime.h"
+#include "UARTProtocol.h"
+
+/**< Defines handler calling the callback with given command code */
+#define FAKE_HANDLER(name, cmd)                    \
+    void name(uint8_t *p_payload, uint8_t len)     \
+    {                                              \
+        if (Callback != NULL)                      \
+        {                                          \
+            Callback((cmd), p_payload, len);       \
+        }                                          \
+    }
+
+static FakeUARTHandlers_Callback_T Callback        = NULL;
+static uint32_t                    RxDataLossCount = 0;
+
+
+void FakeUARTHandlers_SetCallback(FakeUARTHandlers_Callback_T callback)
+{
+    Callback = callback;
+}
+
+uint32_t FakeUARTHandlers_GetRxDataLossCount(void)
+{
+    return RxDataLossCount;
+}
+
+FAKE_HANDLER(ProcessEnterInitDevice, 0x03)
+FAKE_HANDLER(ProcessEnterDevice, 0x05)
+FAKE_HANDLER(ProcessEnterInitNode, 0x06)
+FAKE_HANDLER(ProcessMeshCommand, 0x07)
+FAKE_HANDLER(ProcessEnterNode, 0x0B)
+FAKE_HANDLER(ProcessError, 0x12)
+FAKE_HANDLER(ProcessModemFirmwareVersion, 0x14)
+FAKE_HANDLER(ProcessAttention, 0x16)
+FAKE_HANDLER(ProcessStartTest, 0x20)
+FAKE_HANDLER(ProcessMeshMessageRequest1, 0x28)
+FAKE_HANDLER(MeshTime_ProcessTimeSourceSetRequest, 0x29)
+FAKE_HANDLER(MeshTime_ProcessTimeSourceGetRequest, 0x2B)
+FAKE_HANDLER(MeshTime_ProcessTimeGetResponse, 0x2E)
+FAKE_HANDLER(ProcessDfuInitRequest, 0x80)
+FAKE_HANDLER(ProcessDfuStatusRequest, 0x82)
+FAKE_HANDLER(ProcessDfuPageCreateRequest, 0x84)
+FAKE_HANDLER(ProcessDfuWriteDataEvent, 0x86)
+FAKE_HANDLER(ProcessDfuPageStoreRequest, 0x87)
+FAKE_HANDLER(ProcessDfuStateCheckResponse, 0x8A)
+FAKE_HANDLER(ProcessDfuCancelResponse, 0x8C)
+
+void ProcessFactoryResetEvent(void)
+{
+    if (Callback != NULL)
+    {
+        Callback(0x0E, NULL, 0);
+    }
+}
+
+void ProcessFirmwareVersionSetResponse(void)
+{
+    if (Callback != NULL)
+    {
+        Callback(0x25, NULL, 0);
+    }
+}
+
+void ProcessDfuRxDataLoss(void)
+{
+    RxDataLossCount++;
+}
@@ -0,0 +1,51 @@
+/*
+Copyright © 2021 Silvair Sp. z o.o. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+ *  Command handlers called by UARTProtocol.cpp, implemented for host tests.
+ *  Every handled command is passed to a callback set by the test.
+ */
+
+#ifndef FAKE_UART_HANDLERS_H_
+#define FAKE_UART_HANDLERS_H_
+
+
+#include <stdint.h>
+
+
+typedef void (*FakeUARTHandlers_Callback_T)(uint8_t cmd, uint8_t *p_payload, uint8_t len);
+
+
+/*
+ *  Set callback called by all command handlers
+ *
+ *  @param callback     Callback, NULL to ignore handled commands
+ */
+void FakeUARTHandlers_SetCallback(FakeUARTHandlers_Callback_T callback);
+
+/*
+ *  Get number of ProcessDfuRxDataLoss calls
+ *
+ *  @return             Number of calls since start
+ */
+uint32_t FakeUARTHandlers_GetRxDataLossCount(void);
+
+#endif    // FAKE_UART_HANDLERS_H_
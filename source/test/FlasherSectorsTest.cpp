@@ -0,0 +1,164 @@
+/*
+Copyright © 2021 Silvair Sp. z o.o. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <string.h>
+
+#include "FakeFlasher.h"
+#include "FlasherSectors.h"
+#include "TestCheck.h"
+
+#define IMAGE_WORDS (3 * FLASHER_SECTOR_WORDS + 10) /**< Image ending in a partial sector */
+#define CONFIG_FIELD_WORD (FLASHER_CONFIG_FIELD_OFFSET / sizeof(uint32_t))
+
+static uint32_t *Firmware;
+static uint32_t *Staged;
+
+
+/*
+ *  Stage random image and make running firmware as left by the updater: identical to the image
+ *  including the word past it, erased up to the sector end and with programmed config field
+ */
+static void SetUp(uint32_t seed, uint32_t num_of_words)
+{
+    FakeFlasher_Reset(seed);
+    Firmware = (uint32_t *)(uintptr_t)Flasher_GetFirmwareAddr();
+    Staged   = (uint32_t *)(uintptr_t)Flasher_GetSpaceAddr();
+    memcpy(Firmware, Staged, (num_of_words + 1) * sizeof(uint32_t));
+    for (uint32_t i = num_of_words + 1; i % FLASHER_SECTOR_WORDS != 0; i++)
+    {
+        Firmware[i] = FLASHER_ERASED_WORD;
+    }
+    Firmware[CONFIG_FIELD_WORD] = FLASHER_CONFIG_FIELD_VAL;
+}
+
+static bool IsChanged(uint32_t first_word, uint32_t num_of_words)
+{
+    return Flasher_IsSectorChanged(Flasher_GetFirmwareAddr() + first_word * 4,
+                                   Flasher_GetSpaceAddr() + first_word * 4,
+                                   Flasher_SectorWords(num_of_words, first_word),
+                                   Flasher_GetFirmwareAddr() + FLASHER_CONFIG_FIELD_OFFSET);
+}
+
+static void TestSectorWords(void)
+{
+    CHECK_EQUAL(FLASHER_SECTOR_WORDS, Flasher_SectorWords(IMAGE_WORDS, 0));
+    CHECK_EQUAL(FLASHER_SECTOR_WORDS, Flasher_SectorWords(IMAGE_WORDS, 2 * FLASHER_SECTOR_WORDS));
+    CHECK_EQUAL(11, Flasher_SectorWords(IMAGE_WORDS, 3 * FLASHER_SECTOR_WORDS));
+
+    // Word past an image filling whole sectors goes to the next sector alone
+    CHECK_EQUAL(FLASHER_SECTOR_WORDS, Flasher_SectorWords(FLASHER_SECTOR_WORDS, 0));
+    CHECK_EQUAL(1, Flasher_SectorWords(FLASHER_SECTOR_WORDS, FLASHER_SECTOR_WORDS));
+}
+
+static void TestIdenticalAndChanged(void)
+{
+    SetUp(1, IMAGE_WORDS);
+    CHECK_EQUAL(0, Flasher_CountChangedSectors(IMAGE_WORDS));
+    for (uint32_t i = 0; i <= IMAGE_WORDS; i += FLASHER_SECTOR_WORDS)
+    {
+        CHECK(!IsChanged(i, IMAGE_WORDS));
+    }
+
+    // Changed first and last word of a sector
+    Firmware[FLASHER_SECTOR_WORDS] ^= 1;
+    Firmware[3 * FLASHER_SECTOR_WORDS - 1] ^= 0x80000000u;
+    CHECK_EQUAL(2, Flasher_CountChangedSectors(IMAGE_WORDS));
+    CHECK(!IsChanged(0, IMAGE_WORDS));
+    CHECK(IsChanged(FLASHER_SECTOR_WORDS, IMAGE_WORDS));
+    CHECK(IsChanged(2 * FLASHER_SECTOR_WORDS, IMAGE_WORDS));
+    CHECK(!IsChanged(3 * FLASHER_SECTOR_WORDS, IMAGE_WORDS));
+
+    // Every sector changed
+    SetUp(2, IMAGE_WORDS);
+    for (uint32_t i = 0; i <= IMAGE_WORDS; i += FLASHER_SECTOR_WORDS)
+    {
+        Firmware[i + 1]++;
+    }
+    CHECK_EQUAL(4, Flasher_CountChangedSectors(IMAGE_WORDS));
+}
+
+static void TestConfigField(void)
+{
+    SetUp(3, IMAGE_WORDS);
+
+    // Running firmware holds the programmed config field value, staged image holds any value
+    Staged[CONFIG_FIELD_WORD] = 0x12345678u;
+    CHECK(!IsChanged(0, IMAGE_WORDS));
+    CHECK_EQUAL(0, Flasher_CountChangedSectors(IMAGE_WORDS));
+
+    // Config field holding other value, even the staged one, is programmed again
+    Firmware[CONFIG_FIELD_WORD] = Staged[CONFIG_FIELD_WORD];
+    CHECK(IsChanged(0, IMAGE_WORDS));
+    CHECK_EQUAL(1, Flasher_CountChangedSectors(IMAGE_WORDS));
+    Firmware[CONFIG_FIELD_WORD] = FLASHER_CONFIG_FIELD_VAL;
+
+    // Words around it are compared
+    Firmware[CONFIG_FIELD_WORD - 1]++;
+    CHECK(IsChanged(0, IMAGE_WORDS));
+    Firmware[CONFIG_FIELD_WORD - 1]--;
+    Firmware[CONFIG_FIELD_WORD + 1]++;
+    CHECK(IsChanged(0, IMAGE_WORDS));
+}
+
+static void TestPartialLastSector(void)
+{
+    SetUp(4, IMAGE_WORDS);
+
+    // Word past the image holds the tail of an image not aligned to words
+    Firmware[IMAGE_WORDS] ^= 0xFF;
+    CHECK(IsChanged(3 * FLASHER_SECTOR_WORDS, IMAGE_WORDS));
+    CHECK_EQUAL(1, Flasher_CountChangedSectors(IMAGE_WORDS));
+
+    // Stale tail of a longer previous firmware after it is erased too
+    Firmware[IMAGE_WORDS] ^= 0xFF;
+    Firmware[IMAGE_WORDS + 1] = Staged[IMAGE_WORDS + 1];
+    CHECK(IsChanged(3 * FLASHER_SECTOR_WORDS, IMAGE_WORDS));
+    CHECK_EQUAL(1, Flasher_CountChangedSectors(IMAGE_WORDS));
+    Firmware[IMAGE_WORDS + 1] = FLASHER_ERASED_WORD;
+    Firmware[4 * FLASHER_SECTOR_WORDS - 1] = 0;
+    CHECK(IsChanged(3 * FLASHER_SECTOR_WORDS, IMAGE_WORDS));
+    CHECK_EQUAL(1, Flasher_CountChangedSectors(IMAGE_WORDS));
+
+    // Next sector is not part of the image
+    Firmware[4 * FLASHER_SECTOR_WORDS - 1] = FLASHER_ERASED_WORD;
+    Firmware[4 * FLASHER_SECTOR_WORDS] ^= 0xFF;
+    CHECK(!IsChanged(3 * FLASHER_SECTOR_WORDS, IMAGE_WORDS));
+    CHECK_EQUAL(0, Flasher_CountChangedSectors(IMAGE_WORDS));
+
+    // Image filling whole sectors is followed by a sector holding only the word past the image
+    SetUp(5, 2 * FLASHER_SECTOR_WORDS);
+    CHECK_EQUAL(0, Flasher_CountChangedSectors(2 * FLASHER_SECTOR_WORDS));
+    Firmware[2 * FLASHER_SECTOR_WORDS]++;
+    CHECK_EQUAL(1, Flasher_CountChangedSectors(2 * FLASHER_SECTOR_WORDS));
+    Firmware[2 * FLASHER_SECTOR_WORDS]--;
+    Firmware[3 * FLASHER_SECTOR_WORDS - 1] = 0;
+    CHECK_EQUAL(1, Flasher_CountChangedSectors(2 * FLASHER_SECTOR_WORDS));
+}
+
+int main(void)
+{
+    TestSectorWords();
+    TestIdenticalAndChanged();
+    TestConfigField();
+    TestPartialLastSector();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,437 @@
+/*
+Copyright © 2021 Silvair Sp. z o.o. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "DecoderFixture.h"
+#include "LZ4Decoder.h"
+#include "LZ4Encoder.h"
+#include "TestCheck.h"
+
+#ifdef HAVE_LIBLZ4
+#include <lz4.h>
+#endif
+
+#define MAX_OUTPUT_LEN DECODER_FIXTURE_MAX_OUTPUT_LEN
+#define MAX_BLOCK_LEN (2 * MAX_OUTPUT_LEN)
+#define BENCH_ROUNDS 2000
+
+static LZ4Decoder_T Decoder;
+static uint8_t      Block[MAX_BLOCK_LEN];
+static size_t       BlockLen    = 0;
+static uint8_t      Expected[MAX_OUTPUT_LEN];
+static size_t       ExpectedLen = 0;
+
+
+static void DecoderInit(uint32_t out_size)
+{
+    LZ4Decoder_Init(&Decoder, out_size, DecoderFixture_Read, DecoderFixture_Write);
+}
+
+static int DecoderProcess(const uint8_t *p_data, size_t len, size_t max_out, size_t *p_used)
+{
+    return LZ4Decoder_Process(&Decoder, p_data, len, max_out, p_used);
+}
+
+static bool DecoderIsDone(void)
+{
+    return LZ4Decoder_IsDone(&Decoder);
+}
+
+static const DecoderFixture_Decoder_T LZ4 = {DecoderInit, DecoderProcess, DecoderIsDone, LZ4DECODER_SUCCESS};
+
+/*
+ *  Start building block and its expected output
+ */
+static void BlockStart(void)
+{
+    BlockLen    = 0;
+    ExpectedLen = 0;
+}
+
+/*
+ *  Append length nibble overflow as a chain of 0xFF bytes ended by smaller byte
+ */
+static void BlockAddExtendedLen(size_t len)
+{
+    for (; len >= 0xFF; len -= 0xFF)
+    {
+        Block[BlockLen++] = 0xFF;
+    }
+    Block[BlockLen++] = len;
+}
+
+/*
+ *  Append sequence of literals and a match, match_len 0 ends the block with literals only
+ */
+static void BlockAddSequence(const uint8_t *p_literals, size_t literal_len, uint16_t offset, size_t match_len)
+{
+    size_t match_code = (match_len == 0) ? 0 : match_len - 4;
+
+    Block[BlockLen++] = ((literal_len < 15) ? literal_len : 15) << 4 | ((match_code < 15) ? match_code : 15);
+    if (literal_len >= 15)
+    {
+        BlockAddExtendedLen(literal_len - 15);
+    }
+
+    memcpy(&Block[BlockLen], p_literals, literal_len);
+    BlockLen += literal_len;
+    memcpy(&Expected[ExpectedLen], p_literals, literal_len);
+    ExpectedLen += literal_len;
+
+    if (match_len == 0)
+    {
+        return;
+    }
+
+    Block[BlockLen++] = offset;
+    Block[BlockLen++] = offset >> 8;
+    if (match_code >= 15)
+    {
+        BlockAddExtendedLen(match_code - 15);
+    }
+
+    // Byte by byte copy, as match may overlap its own output
+    for (size_t i = 0; i < match_len; i++, ExpectedLen++)
+    {
+        Expected[ExpectedLen] = Expected[ExpectedLen - offset];
+    }
+}
+
+static void CheckOutput(void)
+{
+    DecoderFixture_CheckOutput(Expected, ExpectedLen);
+}
+
+static void TestLiteralOnly(void)
+{
+    const uint8_t text[] = "literal only block";
+
+    // Empty output needs no input at all
+    DecoderFixture_Init(&LZ4, 0);
+    CHECK(LZ4Decoder_IsDone(&Decoder));
+    CHECK(LZ4Decoder_IsWaitingForInput(&Decoder));
+
+    BlockStart();
+    BlockAddSequence(text, sizeof(text), 0, 0);
+    DecoderFixture_Init(&LZ4, ExpectedLen);
+    CHECK_EQUAL(LZ4DECODER_SUCCESS, DecoderFixture_Feed(Block, BlockLen, BlockLen, MAX_OUTPUT_LEN));
+    CheckOutput();
+    CHECK(LZ4Decoder_IsDone(&Decoder));
+    CHECK(LZ4Decoder_IsWaitingForInput(&Decoder));
+}
+
+static void TestExtendedLengths(void)
+{
+    uint8_t literals[600];
+
+    for (size_t i = 0; i < sizeof(literals); i++)
+    {
+        literals[i] = i * 13;
+    }
+
+    // Lengths around the nibble limit and 0xFF chain steps, for literals and matches
+    const size_t lengths[] = {14, 15, 16, 15 + 254, 15 + 255, 15 + 256, 15 + 2 * 255, 15 + 2 * 255 + 1};
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++)
+    {
+        BlockStart();
+        BlockAddSequence(literals, lengths[i], 7, 4 + lengths[i]);
+        BlockAddSequence(literals, 5, 0, 0);
+
+        for (size_t chunk = 1; chunk <= BlockLen; chunk += BlockLen - 1)
+        {
+            DecoderFixture_Init(&LZ4, ExpectedLen);
+            CHECK_EQUAL(LZ4DECODER_SUCCESS, DecoderFixture_Feed(Block, BlockLen, chunk, MAX_OUTPUT_LEN));
+            CheckOutput();
+            CHECK(LZ4Decoder_IsDone(&Decoder));
+        }
+    }
+}
+
+static void TestOverlappingMatch(void)
+{
+    const uint8_t text[] = "abc";
+    uint8_t       run[21];
+
+    // Offset 1 is run length encoding
+    const uint8_t block[] = {0x1F, 'x', 0x01, 0x00, 0x01, 0x10, 'y'};
+    memset(run, 'x', sizeof(run));
+    DecoderFixture_Init(&LZ4, sizeof(run) + 1);
+    CHECK_EQUAL(LZ4DECODER_SUCCESS, DecoderFixture_Feed(block, sizeof(block), sizeof(block), MAX_OUTPUT_LEN));
+    CHECK_EQUAL(sizeof(run) + 1, DecoderFixture_GetOutputLen());
+    CHECK(memcmp(run, DecoderFixture_GetOutput(), sizeof(run)) == 0);
+
+    // Offset shorter than length repeats the last bytes
+    for (uint16_t offset = 1; offset <= 3; offset++)
+    {
+        BlockStart();
+        BlockAddSequence(text, 3, offset, 40);
+        BlockAddSequence(text, 1, 0, 0);
+
+        DecoderFixture_Init(&LZ4, ExpectedLen);
+        CHECK_EQUAL(LZ4DECODER_SUCCESS, DecoderFixture_Feed(Block, BlockLen, BlockLen, MAX_OUTPUT_LEN));
+        CheckOutput();
+    }
+}
+
+static void TestInvalidOffset(void)
+{
+    const uint8_t text[] = "ab";
+
+    // Offset 0, and offsets reaching before output start
+    const uint16_t offsets[] = {0, 3, 0xFFFF};
+    for (size_t i = 0; i < sizeof(offsets) / sizeof(offsets[0]); i++)
+    {
+        const uint8_t block[] = {0x20, 'a', 'b', (uint8_t)offsets[i], (uint8_t)(offsets[i] >> 8), 0x10, 'z'};
+
+        DecoderFixture_Init(&LZ4, 100);
+        CHECK_EQUAL(LZ4DECODER_ERROR_OFFSET, DecoderFixture_Feed(block, sizeof(block), 1, MAX_OUTPUT_LEN));
+        CHECK_EQUAL(2, DecoderFixture_GetOutputLen());
+    }
+
+    // Offset equal to output length reaches the first byte
+    BlockStart();
+    BlockAddSequence(text, 2, 2, 4);
+    BlockAddSequence(text, 1, 0, 0);
+    DecoderFixture_Init(&LZ4, ExpectedLen);
+    CHECK_EQUAL(LZ4DECODER_SUCCESS, DecoderFixture_Feed(Block, BlockLen, BlockLen, MAX_OUTPUT_LEN));
+    CheckOutput();
+}
+
+static void TestOverflow(void)
+{
+    const uint8_t text[] = "overflow";
+
+    BlockStart();
+    BlockAddSequence(text, 8, 8, 8);
+    BlockAddSequence(text, 8, 0, 0);
+
+    // Output larger than declared size fails in literals, in a match and after the last sequence
+    const uint32_t out_sizes[] = {4, 12, 20};
+    for (size_t i = 0; i < sizeof(out_sizes) / sizeof(out_sizes[0]); i++)
+    {
+        DecoderFixture_CheckOverflow(&LZ4, Block, BlockLen, out_sizes[i], LZ4DECODER_ERROR_OVERFLOW);
+    }
+
+    // Token after the declared output is complete
+    const uint8_t extra[] = {0x10, 'x'};
+    DecoderFixture_Init(&LZ4, ExpectedLen);
+    CHECK_EQUAL(LZ4DECODER_SUCCESS, DecoderFixture_Feed(Block, BlockLen, BlockLen, MAX_OUTPUT_LEN));
+    CHECK_EQUAL(LZ4DECODER_ERROR_OVERFLOW, DecoderFixture_Feed(extra, sizeof(extra), sizeof(extra), MAX_OUTPUT_LEN));
+}
+
+static void TestWriteFail(void)
+{
+    const uint8_t text[] = "write";
+
+    BlockStart();
+    BlockAddSequence(text, 5, 5, 10);
+    BlockAddSequence(text, 5, 0, 0);
+
+    // Failed write of a literal and of a match byte stops decoding
+    const uint32_t fail_at[] = {3, 9};
+    for (size_t i = 0; i < sizeof(fail_at) / sizeof(fail_at[0]); i++)
+    {
+        DecoderFixture_CheckWriteFail(&LZ4, Block, BlockLen, ExpectedLen, fail_at[i], LZ4DECODER_ERROR_OUTPUT);
+    }
+}
+
+static void TestSplitAtEveryByte(void)
+{
+    uint8_t literals[300];
+
+    for (size_t i = 0; i < sizeof(literals); i++)
+    {
+        literals[i] = i ^ 0x5A;
+    }
+
+    BlockStart();
+    BlockAddSequence(literals, 20, 3, 300);
+    BlockAddSequence(literals, 0, 100, 4);
+    BlockAddSequence(literals, 270, 1, 19);
+    BlockAddSequence(literals, 15, 0, 0);
+
+    DecoderFixture_CheckSplits(&LZ4, Block, BlockLen, Expected, ExpectedLen);
+}
+
+static void TestRandomBlocks(void)
+{
+    uint8_t literals[MAX_OUTPUT_LEN];
+
+    for (int round = 0; round < 200; round++)
+    {
+        BlockStart();
+        for (size_t i = 0; i < sizeof(literals); i++)
+        {
+            literals[i] = rand();
+        }
+
+        // Random sequences within the output limit, the block ends with literals
+        while (ExpectedLen < MAX_OUTPUT_LEN / 2)
+        {
+            size_t   literal_len = (rand() % 4 == 0) ? rand() % 600 : rand() % 20;
+            size_t   match_len   = 4 + ((rand() % 4 == 0) ? rand() % 600 : rand() % 20);
+            uint16_t offset      = 1 + rand() % (ExpectedLen + literal_len + (ExpectedLen + literal_len == 0));
+
+            if (ExpectedLen + literal_len == 0)
+            {
+                literal_len = 1;
+            }
+            BlockAddSequence(literals, literal_len, offset, match_len);
+        }
+        BlockAddSequence(literals, 1 + rand() % 20, 0, 0);
+
+        DecoderFixture_Init(&LZ4, ExpectedLen);
+        CHECK_EQUAL(LZ4DECODER_SUCCESS, DecoderFixture_Feed(Block, BlockLen, 1 + rand() % 300, 1 + rand() % 100));
+        CheckOutput();
+        CHECK(LZ4Decoder_IsDone(&Decoder));
+    }
+}
+
+/*
+ *  Fill Expected with data resembling firmware: random code words, runs of padding
+ *  and mutated copies of earlier parts, like repeated instruction sequences
+ */
+static void MakeFirmwareLike(size_t len)
+{
+    ExpectedLen = 0;
+    while (ExpectedLen < len)
+    {
+        size_t run = 1 + rand() % 64;
+        if (run > len - ExpectedLen)
+        {
+            run = len - ExpectedLen;
+        }
+
+        int kind = rand() % 4;
+        for (size_t i = 0; i < run; i++, ExpectedLen++)
+        {
+            if ((kind == 0) && (ExpectedLen > 0))
+            {
+                size_t back           = 1 + rand() % ((ExpectedLen < 2048) ? ExpectedLen : 2048);
+                Expected[ExpectedLen] = Expected[ExpectedLen - back];
+                kind                  = 3;
+            }
+            else if (kind == 1)
+            {
+                Expected[ExpectedLen] = 0xFF;
+            }
+            else if (kind == 3)
+            {
+                Expected[ExpectedLen] = (rand() % 16 == 0) ? rand() : Expected[ExpectedLen - (ExpectedLen > 0)];
+            }
+            else
+            {
+                Expected[ExpectedLen] = rand();
+            }
+        }
+    }
+}
+
+/*
+ *  Compress Expected with given encoder and check that decoder restores it
+ */
+static void CheckRoundTrip(size_t (*compress)(const uint8_t *p_src, size_t len, uint8_t *p_dst))
+{
+    BlockLen = compress(Expected, ExpectedLen, Block);
+    CHECK(BlockLen <= LZ4_ENCODER_BOUND(ExpectedLen));
+
+    DecoderFixture_Init(&LZ4, ExpectedLen);
+    CHECK_EQUAL(LZ4DECODER_SUCCESS, DecoderFixture_Feed(Block, BlockLen, 1 + rand() % 300, 1 + rand() % 100));
+    CheckOutput();
+    CHECK(LZ4Decoder_IsDone(&Decoder));
+}
+
+#ifdef HAVE_LIBLZ4
+static size_t LibLZ4Compress(const uint8_t *p_src, size_t len, uint8_t *p_dst)
+{
+    return LZ4_compress_default((const char *)p_src, (char *)p_dst, len, MAX_BLOCK_LEN);
+}
+#endif
+
+static void TestEncoderRoundTrip(void)
+{
+    // Lengths around the end of block limits, then random lengths
+    static const size_t lens[] = {1, 4, 5, 12, 13, 17, 255, 256, 270, 4096, MAX_OUTPUT_LEN};
+
+    for (size_t round = 0; round < 300; round++)
+    {
+        size_t len = (round < sizeof(lens) / sizeof(lens[0])) ? lens[round] : 1 + rand() % MAX_OUTPUT_LEN;
+
+        MakeFirmwareLike(len);
+        CheckRoundTrip(LZ4Encoder_Compress);
+#ifdef HAVE_LIBLZ4
+        CheckRoundTrip(LibLZ4Compress);
+#endif
+
+        // Constant data is one long overlapping match
+        memset(Expected, round, len);
+        CheckRoundTrip(LZ4Encoder_Compress);
+#ifdef HAVE_LIBLZ4
+        CheckRoundTrip(LibLZ4Compress);
+#endif
+    }
+}
+
+static void Benchmark(void)
+{
+    size_t used;
+
+    MakeFirmwareLike(MAX_OUTPUT_LEN);
+    BlockLen = LZ4Encoder_Compress(Expected, ExpectedLen, Block);
+
+    clock_t start = clock();
+    for (int round = 0; round < BENCH_ROUNDS; round++)
+    {
+        DecoderFixture_Init(&LZ4, ExpectedLen);
+        LZ4Decoder_Process(&Decoder, Block, BlockLen, MAX_OUTPUT_LEN, &used);
+    }
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    CheckOutput();
+    if (seconds > 0)
+    {
+        printf("LZ4 decode: %.1f MB/s, %lu B compressed to %lu B\n",
+               (double)ExpectedLen * BENCH_ROUNDS / seconds / 1e6,
+               (unsigned long)ExpectedLen,
+               (unsigned long)BlockLen);
+    }
+}
+
+int main(void)
+{
+    srand(1);
+
+    TestLiteralOnly();
+    TestExtendedLengths();
+    TestOverlappingMatch();
+    TestInvalidOffset();
+    TestOverflow();
+    TestWriteFail();
+    TestSplitAtEveryByte();
+    TestRandomBlocks();
+    TestEncoderRoundTrip();
+    Benchmark();
+
+    return TEST_RESULT();
+}
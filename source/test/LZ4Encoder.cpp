@@ -0,0 +1,119 @@
+/*
+Copyright © 2021 Silvair Sp. z o.o. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "LZ4Encoder.h"
+
+#include <string.h>
+
+#define HASH_BITS 12
+#define MIN_MATCH 4
+#define LAST_LITERALS 5 /**< Block ends with at least this many literals */
+#define MATCH_LIMIT 12  /**< Match can not start closer to the block end */
+#define MAX_OFFSET 0xFFFFu
+
+
+/*
+ *  Append length nibble overflow as a chain of 0xFF bytes ended by smaller byte
+ */
+static uint8_t *WriteExtendedLen(uint8_t *p_dst, size_t len);
+
+static uint32_t Hash(const uint8_t *p_data);
+
+
+size_t LZ4Encoder_Compress(const uint8_t *p_src, size_t len, uint8_t *p_dst)
+{
+    static uint32_t table[1u << HASH_BITS];
+    uint8_t        *p_out  = p_dst;
+    size_t          anchor = 0;
+    size_t          pos    = 0;
+
+    // Positions are stored plus one, so zero marks an empty slot
+    memset(table, 0, sizeof(table));
+
+    while ((len >= MATCH_LIMIT) && (pos <= len - MATCH_LIMIT))
+    {
+        uint32_t hash      = Hash(&p_src[pos]);
+        size_t   candidate = table[hash];
+        table[hash]        = pos + 1;
+
+        if ((candidate == 0) || (pos - (candidate - 1) > MAX_OFFSET) || (memcmp(&p_src[candidate - 1], &p_src[pos], MIN_MATCH) != 0))
+        {
+            pos++;
+            continue;
+        }
+
+        size_t match     = candidate - 1;
+        size_t match_len = MIN_MATCH;
+        while ((pos + match_len < len - LAST_LITERALS) && (p_src[match + match_len] == p_src[pos + match_len]))
+        {
+            match_len++;
+        }
+
+        size_t literal_len = pos - anchor;
+        size_t match_code  = match_len - MIN_MATCH;
+
+        *p_out++ = ((literal_len < 15) ? literal_len : 15) << 4 | ((match_code < 15) ? match_code : 15);
+        if (literal_len >= 15)
+        {
+            p_out = WriteExtendedLen(p_out, literal_len - 15);
+        }
+        memcpy(p_out, &p_src[anchor], literal_len);
+        p_out += literal_len;
+
+        *p_out++ = (uint8_t)(pos - match);
+        *p_out++ = (uint8_t)((pos - match) >> 8);
+        if (match_code >= 15)
+        {
+            p_out = WriteExtendedLen(p_out, match_code - 15);
+        }
+
+        pos += match_len;
+        anchor = pos;
+    }
+
+    size_t literal_len = len - anchor;
+
+    *p_out++ = ((literal_len < 15) ? literal_len : 15) << 4;
+    if (literal_len >= 15)
+    {
+        p_out = WriteExtendedLen(p_out, literal_len - 15);
+    }
+    memcpy(p_out, &p_src[anchor], literal_len);
+    p_out += literal_len;
+
+    return p_out - p_dst;
+}
+
+static uint8_t *WriteExtendedLen(uint8_t *p_dst, size_t len)
+{
+    for (; len >= 0xFF; len -= 0xFF)
+    {
+        *p_dst++ = 0xFF;
+    }
+    *p_dst++ = len;
+    return p_dst;
+}
+
+static uint32_t Hash(const uint8_t *p_data)
+{
+    uint32_t value = (uint32_t)p_data[0] | ((uint32_t)p_data[1] << 8) | ((uint32_t)p_data[2] << 16) | ((uint32_t)p_data[3] << 24);
+    return (value * 2654435761u) >> (32 - HASH_BITS);
+}
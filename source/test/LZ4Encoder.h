@@ -0,0 +1,50 @@
+/*
+Copyright © 2021 Silvair Sp. z o.o. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+ *  Minimal LZ4 block format encoder for host tests. Greedy matching over a hash
+ *  of 4 byte sequences, following the end of block rules of the LZ4 format:
+ *  last 5 bytes are literals and no match starts in the last 12 bytes.
+ */
+
+#ifndef LZ4_ENCODER_H_
+#define LZ4_ENCODER_H_
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/**< Output buffer size enough for any input of given length */
+#define LZ4_ENCODER_BOUND(len) ((len) + (len) / 255 + 16)
+
+
+/*
+ *  Compress data to a single LZ4 block
+ *
+ *  @param p_src        Data to compress
+ *  @param len          Data len, greater than 0
+ *  @param p_dst        [out] LZ4 block, at least LZ4_ENCODER_BOUND(len) bytes
+ *  @return             Block len
+ */
+size_t LZ4Encoder_Compress(const uint8_t *p_src, size_t len, uint8_t *p_dst);
+
+#endif    // LZ4_ENCODER_H_
@@ -0,0 +1,888 @@
+/*
+Copyright © 2021 Silvair Sp. z o.o. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "CRC.h"
+#include "DeltaGenerator.h"
+#include "FakeFlasher.h"
+#include "LZ4Encoder.h"
+#include "MCU_DFU.h"
+#include "TestCheck.h"
+#include "UARTProtocol.h"
+#include "Utils.h"
+
+#define DFU_SUCCESS 0x01
+#define DFU_INVALID_PARAMETER 0x03
+#define DFU_INSUFFICIENT_RESOURCES 0x04
+#define DFU_OPERATION_FAILED 0x0A
+#define DFU_FIRMWARE_SUCCESSFULLY_UPDATED 0xFF
+#define MAX_PAGE_SIZE 1024u
+#define WRITE_DATA_CHUNK 100u     /**< Image bytes in one write data event */
+#define LOOP_PASSES_LIMIT 100000u /**< LoopDFU passes after which a page commit is considered stuck */
+#define MAX_IMAGE_SIZE (32u * 1024u)
+#define NO_RESPONSE 0x100u
+#define PROGRESS_RECORD_WORDS 11u /**< Offset, CRC, SHA256 state and magic written at each sector boundary */
+#define COMPRESSED_MAGIC 0x315A4C53u /**< "SLZ1", starts compressed image header */
+#define COMPRESSED_HEADER_SIZE 12u
+#define DELTA_MAGIC 0x31504453u  /**< "SDP1", starts delta image header */
+#define DELTA_HEADER_SIZE (16u + SHA256_DIGEST_SIZE)
+#define SPACE_SECTOR (FAKE_FLASHER_SPACE_OFFSET / FLASHER_SECTOR_SIZE)
+#define PROGRESS_SECTOR ((FAKE_FLASHER_SIZE - FAKE_FLASHER_EEPROM_SIZE) / FLASHER_SECTOR_SIZE - 1)
+#define BENCH_ROUNDS 16
+
+static uint16_t InitStatus       = NO_RESPONSE;
+static uint16_t PageCreateStatus = NO_RESPONSE;
+static uint16_t PageStoreStatus  = NO_RESPONSE;
+static uint32_t PageStoreCount   = 0;
+static uint32_t PageStoreFails   = 0; /**< Page store responses other than success */
+static uint32_t CancelCount      = 0;
+static uint8_t  StatusResponse[16];
+static uint8_t  Image[MAX_IMAGE_SIZE];
+static uint8_t  Transferred[2 * MAX_IMAGE_SIZE]; /**< Compressed or delta image made from Image */
+
+
+UART_TxStatus_T UART_SendDfuInitResponse(uint8_t *p_payload, uint8_t len)
+{
+    UNUSED(len);
+    InitStatus = p_payload[0];
+    return UART_TX_STATUS_SENT;
+}
+
+UART_TxStatus_T UART_SendDfuStatusResponse(uint8_t *p_payload, uint8_t len)
+{
+    memcpy(StatusResponse, p_payload, len);
+    return UART_TX_STATUS_SENT;
+}
+
+UART_TxStatus_T UART_SendDfuPageCreateResponse(uint8_t *p_payload, uint8_t len)
+{
+    UNUSED(len);
+    PageCreateStatus = p_payload[0];
+    return UART_TX_STATUS_SENT;
+}
+
+UART_TxStatus_T UART_SendDfuPageStoreResponse(uint8_t *p_payload, uint8_t len)
+{
+    UNUSED(len);
+    PageStoreStatus = p_payload[0];
+    PageStoreCount++;
+    PageStoreFails += (PageStoreStatus != DFU_SUCCESS) && (PageStoreStatus != DFU_FIRMWARE_SUCCESSFULLY_UPDATED);
+    return UART_TX_STATUS_SENT;
+}
+
+UART_TxStatus_T UART_SendDfuStateCheckRequest(uint8_t *p_payload, uint8_t len)
+{
+    UNUSED(p_payload);
+    UNUSED(len);
+    return UART_TX_STATUS_SENT;
+}
+
+UART_TxStatus_T UART_SendDfuCancelRequest(uint8_t *p_payload, uint8_t len)
+{
+    UNUSED(p_payload);
+    UNUSED(len);
+    CancelCount++;
+    return UART_TX_STATUS_SENT;
+}
+
+static uint32_t ReadU32(const uint8_t *p_data)
+{
+    return p_data[0] | (p_data[1] << 8) | (p_data[2] << 16) | ((uint32_t)p_data[3] << 24);
+}
+
+static void WriteU32(uint8_t *p_data, uint32_t value)
+{
+    for (size_t i = 0; i < sizeof(value); i++)
+    {
+        p_data[i] = value >> (8 * i);
+    }
+}
+
+/*
+ *  Make compressed image: header and LZ4 block
+ *
+ *  @return             Compressed image size
+ */
+static size_t Compress(const uint8_t *p_raw, size_t len, uint8_t *p_out)
+{
+    WriteU32(&p_out[0], COMPRESSED_MAGIC);
+    WriteU32(&p_out[4], len);
+    WriteU32(&p_out[8], CalcCRC32((uint8_t *)p_raw, len, CRC32_INIT_VAL));
+
+    return COMPRESSED_HEADER_SIZE + LZ4Encoder_Compress(p_raw, len, &p_out[COMPRESSED_HEADER_SIZE]);
+}
+
+/*
+ *  Make delta image: header and patch of running firmware giving Image
+ *
+ *  @return             Delta image size
+ */
+static size_t Diff(size_t len, size_t base_size, uint8_t *p_out)
+{
+    WriteU32(&p_out[0], DELTA_MAGIC);
+    WriteU32(&p_out[4], len);
+    WriteU32(&p_out[8], CalcCRC32(Image, len, CRC32_INIT_VAL));
+    WriteU32(&p_out[12], base_size);
+    CalcSHA256(FakeFlasher_GetMemory(), base_size, &p_out[16]);
+
+    return DELTA_HEADER_SIZE + DeltaGenerator_Diff(FakeFlasher_GetMemory(), base_size, Image, len, &p_out[DELTA_HEADER_SIZE]);
+}
+
+static void SetUp(uint32_t seed)
+{
+    FakeFlasher_Reset(seed);
+    SetupDFU();
+
+    srand(seed);
+    PageStoreCount = 0;
+    PageStoreFails = 0;
+    CancelCount    = 0;
+}
+
+/*
+ *  Run main loop passes
+ *
+ *  @param passes       Number of LoopDFU calls
+ *  @return             True if DFU finished and flashed the image
+ */
+static bool RunLoop(uint32_t passes)
+{
+    if (setjmp(FakeFlasher_Reboot) != 0)
+    {
+        return true;
+    }
+
+    for (uint32_t i = 0; i < passes; i++)
+    {
+        LoopDFU();
+    }
+    return false;
+}
+
+/*
+ *  Send init request with application data length field, followed by 6 bytes of application data
+ */
+static void SendInitAppData(const uint8_t *p_image, size_t len, uint8_t app_data_len)
+{
+    uint8_t payload[4 + SHA256_DIGEST_SIZE + 1 + 6];
+    uint8_t sha256[SHA256_DIGEST_SIZE];
+    size_t  index = 0;
+
+    CalcSHA256((uint8_t *)p_image, len, sha256);
+
+    for (size_t i = 0; i < sizeof(uint32_t); i++)
+    {
+        payload[index++] = len >> (8 * i);
+    }
+    for (size_t i = 0; i < SHA256_DIGEST_SIZE; i++)
+    {
+        payload[index++] = sha256[SHA256_DIGEST_SIZE - i - 1];
+    }
+    payload[index++] = app_data_len;
+    memcpy(&payload[index], "ignore", 6);
+
+    InitStatus = NO_RESPONSE;
+    ProcessDfuInitRequest(payload, sizeof(payload));
+}
+
+static void SendInit(const uint8_t *p_image, size_t len)
+{
+    SendInitAppData(p_image, len, 6);
+}
+
+/*
+ *  Request status and check it against the image sent so far
+ */
+static void CheckStatus(const uint8_t *p_image, size_t offset)
+{
+    ProcessDfuStatusRequest(NULL, 0);
+
+    CHECK_EQUAL(offset, ReadU32(&StatusResponse[5]));
+    CHECK_EQUAL(CalcCRC32((uint8_t *)p_image, offset, CRC32_INIT_VAL), ReadU32(&StatusResponse[9]));
+}
+
+static void SendPageCreate(size_t size)
+{
+    uint8_t payload[] = {(uint8_t)size, (uint8_t)(size >> 8), 0, 0};
+
+    PageCreateStatus = NO_RESPONSE;
+    ProcessDfuPageCreateRequest(payload, sizeof(payload));
+}
+
+static void SendWriteData(const uint8_t *p_data, size_t len)
+{
+    while (len > 0)
+    {
+        uint8_t payload[1 + WRITE_DATA_CHUNK];
+        uint8_t chunk = (len < WRITE_DATA_CHUNK) ? len : WRITE_DATA_CHUNK;
+
+        payload[0] = chunk;
+        memcpy(&payload[1], p_data, chunk);
+        ProcessDfuWriteDataEvent(payload, chunk + 1);
+
+        p_data += chunk;
+        len -= chunk;
+    }
+}
+
+/*
+ *  Send pages the way the modem does: status, page create, write data, page
+ *  store and wait for the response, until stop offset is reached. Pages are
+ *  sent from the offset in the status response, so an interrupted transfer
+ *  continues. Status is also checked in the middle of each page.
+ *
+ *  @param stop         Offset after which no more pages are sent
+ *  @return             True if DFU finished and flashed the image
+ */
+static bool SendPages(const uint8_t *p_image, size_t len, size_t page_size, size_t stop)
+{
+    ProcessDfuStatusRequest(NULL, 0);
+    size_t offset = ReadU32(&StatusResponse[5]);
+
+    while (offset < stop)
+    {
+        size_t size = (len - offset < page_size) ? len - offset : page_size;
+
+        CheckStatus(p_image, offset);
+        SendPageCreate(size);
+        CHECK_EQUAL(DFU_SUCCESS, PageCreateStatus);
+
+        SendWriteData(&p_image[offset], size / 2);
+        CheckStatus(p_image, offset + size / 2);
+        SendWriteData(&p_image[offset + size / 2], size - size / 2);
+
+        uint32_t store_count = PageStoreCount;
+        ProcessDfuPageStoreRequest(NULL, 0);
+        // Stored page counts in status before it is committed
+        CheckStatus(p_image, offset + size);
+
+        for (uint32_t passes = 0; (PageStoreCount == store_count) && (passes < LOOP_PASSES_LIMIT); passes++)
+        {
+            if (RunLoop(1))
+            {
+                return PageStoreStatus == DFU_FIRMWARE_SUCCESSFULLY_UPDATED;
+            }
+        }
+        if ((PageStoreCount == store_count) || (PageStoreStatus != DFU_SUCCESS))
+        {
+            return false;
+        }
+
+        offset += size;
+    }
+
+    return false;
+}
+
+/*
+ *  Init transfer, then send pages until stop offset is reached
+ *
+ *  @param stop         Offset after which no more pages are sent
+ *  @return             True if DFU finished and flashed the image
+ */
+static bool TransferUntil(const uint8_t *p_image, size_t len, size_t page_size, size_t stop)
+{
+    SendInit(p_image, len);
+    CHECK_EQUAL(DFU_SUCCESS, InitStatus);
+
+    return SendPages(p_image, len, page_size, stop);
+}
+
+static bool Transfer(const uint8_t *p_image, size_t len, size_t page_size)
+{
+    return TransferUntil(p_image, len, page_size, len);
+}
+
+/*
+ *  Reset MCU: state in RAM is lost, flash content is kept
+ */
+static void Reset(void)
+{
+    FakeFlasher_PowerOn();
+    SetupDFU();
+}
+
+/*
+ *  Get offset from the status response
+ */
+static size_t GetStatusOffset(void)
+{
+    ProcessDfuStatusRequest(NULL, 0);
+    return ReadU32(&StatusResponse[5]);
+}
+
+/*
+ *  Get offset from which transfer continues after init
+ */
+static size_t GetResumeOffset(const uint8_t *p_image, size_t len)
+{
+    SendInit(p_image, len);
+    ProcessDfuStatusRequest(NULL, 0);
+
+    size_t offset = ReadU32(&StatusResponse[5]);
+    CheckStatus(p_image, offset);
+
+    return offset;
+}
+
+static void TestRawTransfer(void)
+{
+    for (uint32_t round = 0; round < 40; round++)
+    {
+        SetUp(round);
+
+        size_t len       = 4 * (1 + rand() % (MAX_IMAGE_SIZE / 4));
+        size_t page_size = 4 * (1 + rand() % (MAX_PAGE_SIZE / 4));
+        for (size_t i = 0; i < len; i++)
+        {
+            Image[i] = rand();
+        }
+
+        CHECK(Transfer(Image, len, page_size));
+        CHECK_EQUAL(len / 4, FakeFlasher_GetUpdateWords());
+        CHECK(memcmp(&FakeFlasher_GetMemory()[FAKE_FLASHER_SPACE_OFFSET], Image, len) == 0);
+        CHECK_EQUAL(0, CancelCount);
+    }
+}
+
+static void TestInconsistentLength(void)
+{
+    const size_t len = 600;
+
+    SetUp(50);
+    for (size_t i = 0; i < len; i++)
+    {
+        Image[i] = rand();
+    }
+
+    // Application data length beyond the payload is rejected before the data is read
+    SendInitAppData(Image, len, 7);
+    CHECK_EQUAL(DFU_INVALID_PARAMETER, InitStatus);
+    SendInitAppData(Image, len, 255);
+    CHECK_EQUAL(DFU_INVALID_PARAMETER, InitStatus);
+
+    SendInit(Image, len);
+    CHECK_EQUAL(DFU_SUCCESS, InitStatus);
+    SendPageCreate(300);
+    CHECK_EQUAL(DFU_SUCCESS, PageCreateStatus);
+
+    // Image length beyond the payload fails the page, complete data does not fix it
+    uint8_t payload[1 + WRITE_DATA_CHUNK] = {WRITE_DATA_CHUNK + 1};
+    ProcessDfuWriteDataEvent(payload, sizeof(payload));
+    CheckStatus(Image, 0);
+    SendWriteData(Image, 300);
+    ProcessDfuPageStoreRequest(NULL, 0);
+    CHECK_EQUAL(DFU_OPERATION_FAILED, PageStoreStatus);
+    CheckStatus(Image, 0);
+
+    // Page is accepted when sent again
+    CHECK(Transfer(Image, len, 300));
+    CHECK(memcmp(&FakeFlasher_GetMemory()[FAKE_FLASHER_SPACE_OFFSET], Image, len) == 0);
+}
+
+static void TestLazyErase(void)
+{
+    const size_t lengths[] = {4, 1020, FLASHER_SECTOR_SIZE, 3 * FLASHER_SECTOR_SIZE + 8, 10 * FLASHER_SECTOR_SIZE};
+    uint32_t     expected_erases[FLASHER_SECTOR_COUNT] = {0};
+
+    SetUp(100);
+    for (size_t i = 0; i < MAX_IMAGE_SIZE; i++)
+    {
+        Image[i] = rand();
+    }
+
+    // Transfers follow each other without clearing flash, so each one has to erase again
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++)
+    {
+        size_t len = lengths[i];
+
+        // Init erases only the progress sector, image sectors are erased when the first page reaches them
+        SendInit(Image, len);
+        CHECK_EQUAL(DFU_SUCCESS, InitStatus);
+        expected_erases[PROGRESS_SECTOR]++;
+        for (size_t sector = 0; sector < FLASHER_SECTOR_COUNT; sector++)
+        {
+            CHECK_EQUAL(expected_erases[sector], FakeFlasher_GetEraseCount(sector));
+        }
+
+        CHECK(Transfer(Image, len, 256));
+        CHECK(memcmp(&FakeFlasher_GetMemory()[FAKE_FLASHER_SPACE_OFFSET], Image, len) == 0);
+
+        // Sectors used by the image are erased once, including the word after the image copied by update.
+        // Progress sector is erased once more when the finished transfer clears its records.
+        size_t used_sectors = (len + sizeof(uint32_t) + FLASHER_SECTOR_SIZE - 1) / FLASHER_SECTOR_SIZE;
+        for (size_t sector = SPACE_SECTOR; sector < SPACE_SECTOR + used_sectors; sector++)
+        {
+            expected_erases[sector]++;
+        }
+        expected_erases[PROGRESS_SECTOR]++;
+        for (size_t sector = 0; sector < FLASHER_SECTOR_COUNT; sector++)
+        {
+            CHECK_EQUAL(expected_erases[sector], FakeFlasher_GetEraseCount(sector));
+        }
+    }
+
+    CHECK_EQUAL(0, FakeFlasher_GetNotErasedCount());
+}
+
+/*
+ *  Transfer image without waiting for page store responses. Main loop runs
+ *  given number of passes after each UART event, so commits overlap reception.
+ *
+ *  @return             True if DFU finished and flashed the image
+ */
+static bool PipelinedTransfer(const uint8_t *p_image, size_t len, size_t page_size, uint32_t passes)
+{
+    bool     is_updated = false;
+    uint32_t pages      = 0;
+
+    SendInit(p_image, len);
+    CHECK_EQUAL(DFU_SUCCESS, InitStatus);
+
+    for (size_t offset = 0; (offset < len) && !is_updated; pages++)
+    {
+        size_t size = (len - offset < page_size) ? len - offset : page_size;
+
+        // Page buffers are busy until the committed page is done
+        SendPageCreate(size);
+        for (uint32_t retries = 0; (PageCreateStatus == DFU_INSUFFICIENT_RESOURCES) && (retries < LOOP_PASSES_LIMIT); retries++)
+        {
+            is_updated = RunLoop(1);
+            SendPageCreate(size);
+        }
+        CHECK_EQUAL(DFU_SUCCESS, PageCreateStatus);
+
+        for (size_t page_pos = 0; page_pos < size; page_pos += WRITE_DATA_CHUNK)
+        {
+            SendWriteData(&p_image[offset + page_pos], (size - page_pos < WRITE_DATA_CHUNK) ? size - page_pos : WRITE_DATA_CHUNK);
+            is_updated |= RunLoop(passes);
+        }
+
+        ProcessDfuPageStoreRequest(NULL, 0);
+        offset += size;
+        if (offset < len)
+        {
+            CheckStatus(p_image, offset);
+        }
+        is_updated |= RunLoop(passes);
+    }
+
+    if (!is_updated)
+    {
+        is_updated = RunLoop(LOOP_PASSES_LIMIT);
+    }
+
+    CHECK_EQUAL(pages, PageStoreCount);
+    CHECK_EQUAL(0, PageStoreFails);
+
+    return is_updated && (PageStoreStatus == DFU_FIRMWARE_SUCCESSFULLY_UPDATED);
+}
+
+#if DFU_PAGE_BUFFERS == 2
+static void TestPageQueue(void)
+{
+    SetUp(200);
+    for (size_t i = 0; i < 4 * MAX_PAGE_SIZE; i++)
+    {
+        Image[i] = rand();
+    }
+
+    SendInit(Image, 4 * MAX_PAGE_SIZE);
+    CHECK_EQUAL(DFU_SUCCESS, InitStatus);
+    uint32_t init_words = FakeFlasher_GetProgramCount();
+
+    // Page store only starts the commit, programming is left to the main loop
+    SendPageCreate(MAX_PAGE_SIZE);
+    SendWriteData(Image, MAX_PAGE_SIZE);
+    ProcessDfuPageStoreRequest(NULL, 0);
+    CHECK_EQUAL(0, PageStoreCount);
+    CHECK_EQUAL(init_words, FakeFlasher_GetProgramCount());
+
+    // Next page is received into the other buffer while the first one is committed
+    RunLoop(1);
+    SendPageCreate(MAX_PAGE_SIZE);
+    CHECK_EQUAL(DFU_SUCCESS, PageCreateStatus);
+    SendWriteData(&Image[MAX_PAGE_SIZE], MAX_PAGE_SIZE);
+    CheckStatus(Image, 2 * MAX_PAGE_SIZE);
+    ProcessDfuPageStoreRequest(NULL, 0);
+    CheckStatus(Image, 2 * MAX_PAGE_SIZE);
+
+    // Third page has no free buffer until the first one is committed
+    SendPageCreate(MAX_PAGE_SIZE);
+    CHECK_EQUAL(DFU_INSUFFICIENT_RESOURCES, PageCreateStatus);
+    CHECK_EQUAL(0, PageStoreCount);
+
+    // Page is programmed DFU_COMMIT_WORDS_PER_LOOP words per pass, then the queued page is committed
+    uint32_t page_passes = MAX_PAGE_SIZE / sizeof(uint32_t) / DFU_COMMIT_WORDS_PER_LOOP;
+    RunLoop(page_passes - 2);
+    CHECK_EQUAL(0, PageStoreCount);
+    RunLoop(1);
+    CHECK_EQUAL(1, PageStoreCount);
+    CHECK_EQUAL(init_words + MAX_PAGE_SIZE / sizeof(uint32_t) + PROGRESS_RECORD_WORDS, FakeFlasher_GetProgramCount());
+
+    // Buffer of the first page is free again
+    SendPageCreate(MAX_PAGE_SIZE);
+    CHECK_EQUAL(DFU_SUCCESS, PageCreateStatus);
+    SendWriteData(&Image[2 * MAX_PAGE_SIZE], MAX_PAGE_SIZE / 2);
+    CheckStatus(Image, 2 * MAX_PAGE_SIZE + MAX_PAGE_SIZE / 2);
+
+    RunLoop(page_passes);
+    CHECK_EQUAL(2, PageStoreCount);
+    CHECK_EQUAL(0, PageStoreFails);
+    CheckStatus(Image, 2 * MAX_PAGE_SIZE + MAX_PAGE_SIZE / 2);
+    CHECK(memcmp(&FakeFlasher_GetMemory()[FAKE_FLASHER_SPACE_OFFSET], Image, 2 * MAX_PAGE_SIZE) == 0);
+}
+
+#else
+static void TestPageQueue(void)
+{
+    SetUp(200);
+    for (size_t i = 0; i < 2 * MAX_PAGE_SIZE; i++)
+    {
+        Image[i] = rand();
+    }
+
+    SendInit(Image, 2 * MAX_PAGE_SIZE);
+    CHECK_EQUAL(DFU_SUCCESS, InitStatus);
+
+    SendPageCreate(MAX_PAGE_SIZE);
+    SendWriteData(Image, MAX_PAGE_SIZE);
+    ProcessDfuPageStoreRequest(NULL, 0);
+    CHECK_EQUAL(0, PageStoreCount);
+
+    // Single page buffer has no room for the next page until the first one is committed
+    RunLoop(1);
+    SendPageCreate(MAX_PAGE_SIZE);
+    CHECK_EQUAL(DFU_INSUFFICIENT_RESOURCES, PageCreateStatus);
+    CheckStatus(Image, MAX_PAGE_SIZE);
+
+    uint32_t page_passes = MAX_PAGE_SIZE / sizeof(uint32_t) / DFU_COMMIT_WORDS_PER_LOOP;
+    RunLoop(page_passes);
+    CHECK_EQUAL(1, PageStoreCount);
+
+    SendPageCreate(MAX_PAGE_SIZE);
+    CHECK_EQUAL(DFU_SUCCESS, PageCreateStatus);
+    SendWriteData(&Image[MAX_PAGE_SIZE], MAX_PAGE_SIZE / 2);
+    CheckStatus(Image, MAX_PAGE_SIZE + MAX_PAGE_SIZE / 2);
+    CHECK_EQUAL(0, PageStoreFails);
+    CHECK(memcmp(&FakeFlasher_GetMemory()[FAKE_FLASHER_SPACE_OFFSET], Image, MAX_PAGE_SIZE) == 0);
+}
+#endif
+
+static void TestPipelinedTransfer(void)
+{
+    for (uint32_t round = 0; round < 40; round++)
+    {
+        SetUp(300 + round);
+
+        size_t   len       = 4 * (1 + rand() % (MAX_IMAGE_SIZE / 4));
+        size_t   page_size = 4 * (1 + rand() % (MAX_PAGE_SIZE / 4));
+        uint32_t passes    = rand() % 4;
+        for (size_t i = 0; i < len; i++)
+        {
+            Image[i] = rand();
+        }
+
+        CHECK(PipelinedTransfer(Image, len, page_size, passes));
+        CHECK_EQUAL(len / 4, FakeFlasher_GetUpdateWords());
+        CHECK(memcmp(&FakeFlasher_GetMemory()[FAKE_FLASHER_SPACE_OFFSET], Image, len) == 0);
+    }
+}
+
+static void TestResumeAfterReset(void)
+{
+    const size_t len = 8 * FLASHER_SECTOR_SIZE + 100;
+
+    SetUp(400);
+    for (size_t i = 0; i < len; i++)
+    {
+        Image[i] = rand();
+    }
+
+    // Progress record is written at each sector boundary, modem learns the offset from status after init
+    CHECK(!TransferUntil(Image, len, 256, 3 * FLASHER_SECTOR_SIZE + 512));
+    Reset();
+    CHECK_EQUAL(3 * FLASHER_SECTOR_SIZE, GetResumeOffset(Image, len));
+
+    // Init for a different image does not resume
+    Reset();
+    CHECK_EQUAL(0, GetResumeOffset(Image, len - 4));
+
+    // Records of the other image are gone too
+    Reset();
+    CHECK_EQUAL(0, GetResumeOffset(Image, len));
+    CHECK(Transfer(Image, len, 256));
+    CHECK(memcmp(&FakeFlasher_GetMemory()[FAKE_FLASHER_SPACE_OFFSET], Image, len) == 0);
+
+    // Finished transfer clears its records
+    Reset();
+    CHECK_EQUAL(0, GetResumeOffset(Image, len));
+    CHECK_EQUAL(0, FakeFlasher_GetNotErasedCount());
+}
+
+static void TestTornProgressRecord(void)
+{
+    const size_t len = 8 * FLASHER_SECTOR_SIZE;
+
+    // Power is lost while the third record is written: before its magic, or halfway through
+    for (uint32_t torn_words = 5; torn_words <= PROGRESS_RECORD_WORDS - 1; torn_words += PROGRESS_RECORD_WORDS - 1 - 5)
+    {
+        SetUp(500 + torn_words);
+        for (size_t i = 0; i < len; i++)
+        {
+            Image[i] = rand();
+        }
+
+        SendInit(Image, len);
+        FakeFlasher_PowerOffAfter(3 * FLASHER_SECTOR_SIZE / sizeof(uint32_t) + 2 * PROGRESS_RECORD_WORDS + torn_words);
+        CHECK(!TransferUntil(Image, len, 512, len));
+        CHECK(FakeFlasher_IsPowerOff());
+
+        Reset();
+        CHECK_EQUAL(2 * FLASHER_SECTOR_SIZE, GetResumeOffset(Image, len));
+
+        // Records after the torn one are found on the next resume
+        CHECK(!TransferUntil(Image, len, 512, 6 * FLASHER_SECTOR_SIZE));
+        Reset();
+        CHECK_EQUAL(6 * FLASHER_SECTOR_SIZE, GetResumeOffset(Image, len));
+
+        CHECK(Transfer(Image, len, 512));
+        CHECK(memcmp(&FakeFlasher_GetMemory()[FAKE_FLASHER_SPACE_OFFSET], Image, len) == 0);
+        CHECK_EQUAL(0, FakeFlasher_GetNotErasedCount());
+    }
+}
+
+static void TestFullProgressSector(void)
+{
+    const size_t len = MAX_IMAGE_SIZE - 8;
+
+    SetUp(600);
+    for (size_t i = 0; i < len; i++)
+    {
+        Image[i] = rand();
+    }
+
+    // Sector holds header and 22 records, the next record starts the sector over
+    CHECK(!TransferUntil(Image, len, MAX_PAGE_SIZE, 22 * FLASHER_SECTOR_SIZE));
+    CHECK_EQUAL(1, FakeFlasher_GetEraseCount(PROGRESS_SECTOR));
+    Reset();
+    CHECK_EQUAL(22 * FLASHER_SECTOR_SIZE, GetResumeOffset(Image, len));
+
+    CHECK(!TransferUntil(Image, len, MAX_PAGE_SIZE, 25 * FLASHER_SECTOR_SIZE));
+    CHECK_EQUAL(2, FakeFlasher_GetEraseCount(PROGRESS_SECTOR));
+    Reset();
+    CHECK_EQUAL(25 * FLASHER_SECTOR_SIZE, GetResumeOffset(Image, len));
+
+    CHECK(Transfer(Image, len, MAX_PAGE_SIZE));
+    CHECK(memcmp(&FakeFlasher_GetMemory()[FAKE_FLASHER_SPACE_OFFSET], Image, len) == 0);
+}
+
+static void TestPowerLossAtEveryWord(void)
+{
+    const size_t len = 3 * FLASHER_SECTOR_SIZE + 36;
+
+    SetUp(700);
+    for (size_t i = 0; i < len; i++)
+    {
+        Image[i] = rand();
+    }
+    CHECK(Transfer(Image, len, 300));
+    uint32_t total_words = FakeFlasher_GetProgramCount();
+
+    // Resumed transfer ends with the image hash from progress records matching the whole image
+    for (uint32_t words = 0; words < total_words; words++)
+    {
+        SetUp(700);
+        FakeFlasher_PowerOffAfter(words);
+
+        // Losing only the last progress record does not fail the transfer
+        if (!Transfer(Image, len, 300))
+        {
+            Reset();
+            size_t offset = GetResumeOffset(Image, len);
+            CHECK_EQUAL(0, offset % FLASHER_SECTOR_SIZE);
+
+            CHECK(Transfer(Image, len, 300));
+        }
+        CHECK_EQUAL(len / 4, FakeFlasher_GetUpdateWords());
+        CHECK(memcmp(&FakeFlasher_GetMemory()[FAKE_FLASHER_SPACE_OFFSET], Image, len) == 0);
+        CHECK_EQUAL(0, FakeFlasher_GetNotErasedCount());
+    }
+}
+
+static void TestRetryAfterWriteFail(void)
+{
+    const size_t len = 3 * FLASHER_SECTOR_SIZE + 36;
+
+    SetUp(750);
+    for (size_t i = 0; i < len; i++)
+    {
+        Image[i] = rand();
+    }
+    CHECK(Transfer(Image, len, 300));
+    uint32_t total_words = FakeFlasher_GetProgramCount();
+
+    // Page retried without init has to erase words programmed before the failure, including earlier pages in its sector
+    for (uint32_t words = 1; words < total_words; words += 7)
+    {
+        SetUp(750);
+        FakeFlasher_PowerOffAfter(words);
+
+        if (Transfer(Image, len, 300))
+        {
+            continue;
+        }
+        FakeFlasher_PowerOn();
+
+        size_t offset = GetStatusOffset();
+        CHECK_EQUAL(0, offset % FLASHER_SECTOR_SIZE);
+        CheckStatus(Image, offset);
+
+        CHECK(SendPages(Image, len, 300, len));
+        CHECK_EQUAL(len / 4, FakeFlasher_GetUpdateWords());
+        CHECK(memcmp(&FakeFlasher_GetMemory()[FAKE_FLASHER_SPACE_OFFSET], Image, len) == 0);
+        CHECK_EQUAL(0, FakeFlasher_GetNotErasedCount());
+    }
+}
+
+static void TestCompressedErasedSector(void)
+{
+    const size_t len = 6 * FLASHER_SECTOR_SIZE + 12;
+
+    // Output sectors holding only erased value bytes are never programmed, they still must not keep stale data
+    for (uint32_t round = 0; round < 10; round++)
+    {
+        SetUp(800 + round);
+        for (size_t i = 0; i < len; i++)
+        {
+            Image[i] = rand();
+        }
+        memset(&Image[FLASHER_SECTOR_SIZE - 100], 0xFF, 3 * FLASHER_SECTOR_SIZE);
+        memset(&Image[5 * FLASHER_SECTOR_SIZE], 0x00, 200);
+
+        size_t compressed_len = Compress(Image, len, Transferred);
+        CHECK(compressed_len < len);
+
+        CHECK(Transfer(Transferred, compressed_len, 4 * (4 + rand() % (MAX_PAGE_SIZE / 4 - 4))));
+        CHECK_EQUAL(len / 4, FakeFlasher_GetUpdateWords());
+        CHECK(memcmp(&FakeFlasher_GetMemory()[FAKE_FLASHER_SPACE_OFFSET], Image, len) == 0);
+        CHECK_EQUAL(0, FakeFlasher_GetNotErasedCount());
+    }
+}
+
+static void TestDeltaErasedSector(void)
+{
+    const size_t base_size = 8 * FLASHER_SECTOR_SIZE;
+    uint8_t     *p_base    = FakeFlasher_GetMemory();
+
+    // Full output sectors of erased value bytes, copied from running firmware in even rounds and inserted in odd ones
+    for (uint32_t round = 0; round < 10; round++)
+    {
+        const size_t len = 6 * FLASHER_SECTOR_SIZE + 12;
+
+        SetUp(900 + round);
+        if (round % 2 == 0)
+        {
+            memset(&p_base[2 * FLASHER_SECTOR_SIZE], 0xFF, 2 * FLASHER_SECTOR_SIZE);
+        }
+        for (size_t i = 0; i < len; i++)
+        {
+            Image[i] = rand();
+        }
+        memcpy(&Image[0], &p_base[100], 1000);
+        memset(&Image[1000], 0xFF, 2 * FLASHER_SECTOR_SIZE + 500);
+        memcpy(&Image[2 * FLASHER_SECTOR_SIZE + 1500], &p_base[2 * FLASHER_SECTOR_SIZE], 2 * FLASHER_SECTOR_SIZE);
+
+        size_t delta_len = Diff(len, base_size, Transferred);
+        CHECK(delta_len < len);
+
+        CHECK(Transfer(Transferred, delta_len, 4 * (12 + rand() % (MAX_PAGE_SIZE / 4 - 12))));
+        CHECK_EQUAL(len / 4, FakeFlasher_GetUpdateWords());
+        CHECK(memcmp(&FakeFlasher_GetMemory()[FAKE_FLASHER_SPACE_OFFSET], Image, len) == 0);
+        CHECK_EQUAL(0, FakeFlasher_GetNotErasedCount());
+    }
+}
+
+/*
+ *  Time CRC32 reported after every stored page of a MAX_IMAGE_SIZE image: extended
+ *  page by page as MCU_DFU does, or recomputed over all stored bytes each time
+ */
+static void BenchmarkCrc(void)
+{
+    uint32_t incremental_crc = 0;
+    uint32_t single_pass_crc = 0;
+
+    for (size_t i = 0; i < MAX_IMAGE_SIZE; i++)
+    {
+        Image[i] = rand();
+    }
+
+    clock_t start = clock();
+    for (int round = 0; round < BENCH_ROUNDS; round++)
+    {
+        incremental_crc = ~CRC32_INIT_VAL;
+        for (size_t offset = 0; offset < MAX_IMAGE_SIZE; offset += MAX_PAGE_SIZE)
+        {
+            incremental_crc = CalcCRC32(&Image[offset], MAX_PAGE_SIZE, ~incremental_crc);
+        }
+    }
+    double incremental_seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    for (int round = 0; round < BENCH_ROUNDS; round++)
+    {
+        for (size_t offset = 0; offset < MAX_IMAGE_SIZE; offset += MAX_PAGE_SIZE)
+        {
+            single_pass_crc = CalcCRC32(Image, offset + MAX_PAGE_SIZE, CRC32_INIT_VAL);
+        }
+    }
+    double single_pass_seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    CHECK_EQUAL(single_pass_crc, incremental_crc);
+    printf("DFU CRC32 of %u kB image in %u B pages: incremental %.3f ms, single-pass per page %.3f ms\n",
+           MAX_IMAGE_SIZE / 1024u,
+           MAX_PAGE_SIZE,
+           incremental_seconds * 1e3 / BENCH_ROUNDS,
+           single_pass_seconds * 1e3 / BENCH_ROUNDS);
+}
+
+int main(void)
+{
+    TestRawTransfer();
+    TestInconsistentLength();
+    TestLazyErase();
+    TestPageQueue();
+    TestPipelinedTransfer();
+    TestResumeAfterReset();
+    TestTornProgressRecord();
+    TestFullProgressSector();
+    TestPowerLossAtEveryWord();
+    TestRetryAfterWriteFail();
+    TestCompressedErasedSector();
+    TestDeltaErasedSector();
+    BenchmarkCrc();
+
+    return TEST_RESULT();
+}
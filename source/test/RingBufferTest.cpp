@@ -0,0 +1,404 @@
+/*
+Copyright © 2021 Silvair Sp. z o.o. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <string.h>
+#include <thread>
+#include <time.h>
+
+#include "RingBuffer.h"
+#include "TestCheck.h"
+
+#define TEST_BUFFER_LEN 16
+#define STRESS_BYTES 2000000u
+#define BENCH_BUFFER_LEN 512
+#define BENCH_CHUNK_LEN 23
+#define BENCH_BYTES 20000000u
+
+static uint8_t      Buffer[TEST_BUFFER_LEN];
+static RingBuffer_T Ring;
+
+
+/*
+ *  Ring buffer before power-of-two lengths, indexes reduced with modulo by runtime length.
+ *  Copied for benchmark only, functions are kept out of line as in their own translation unit.
+ */
+typedef struct
+{
+    uint8_t *p_buf;
+    size_t   buf_len;
+    size_t   wr;
+    size_t   rd;
+} ModuloRing_T;
+
+__attribute__((noinline)) static uint16_t ModuloRing_DataLen(ModuloRing_T *p_ring_buffer)
+{
+    return (p_ring_buffer->wr - p_ring_buffer->rd) % p_ring_buffer->buf_len;
+}
+
+static bool ModuloRing_IsOverflow(ModuloRing_T *p_ring_buffer, uint16_t len)
+{
+    return (len + ModuloRing_DataLen(p_ring_buffer)) > p_ring_buffer->buf_len;
+}
+
+__attribute__((noinline)) static bool ModuloRing_DequeueByte(ModuloRing_T *p_ring_buffer, uint8_t *read_byte)
+{
+    if (p_ring_buffer->wr == p_ring_buffer->rd)
+    {
+        return false;
+    }
+    *read_byte = p_ring_buffer->p_buf[(p_ring_buffer->rd)++];
+
+    if (p_ring_buffer->rd >= p_ring_buffer->buf_len)
+    {
+        p_ring_buffer->rd = 0;
+    }
+
+    return true;
+}
+
+__attribute__((noinline)) static bool ModuloRing_QueueBytes(ModuloRing_T *p_ring_buffer, uint8_t *table, uint16_t table_len)
+{
+    if (ModuloRing_IsOverflow(p_ring_buffer, table_len))
+    {
+        return false;
+    }
+
+    uint16_t cpy_len = table_len;
+    if (p_ring_buffer->wr + table_len > p_ring_buffer->buf_len)
+    {
+        cpy_len = p_ring_buffer->buf_len - p_ring_buffer->wr;
+    }
+    memcpy(&p_ring_buffer->p_buf[p_ring_buffer->wr], table, cpy_len);
+
+    if (cpy_len != table_len)
+    {
+        memcpy(p_ring_buffer->p_buf, &table[cpy_len], table_len - cpy_len);
+    }
+
+    p_ring_buffer->wr = (p_ring_buffer->wr + table_len) % p_ring_buffer->buf_len;
+
+    return true;
+}
+
+/*
+ *  Start ring buffer with free running indexes at given position
+ */
+static void SetUp(size_t index)
+{
+    RINGBUFFER_INIT(&Ring, Buffer);
+    memset(Buffer, 0, sizeof(Buffer));
+    Ring.wr = index;
+    Ring.rd = index;
+}
+
+static void TestEmptyAndFull(void)
+{
+    uint8_t data[TEST_BUFFER_LEN + 1];
+    uint8_t byte;
+
+    for (size_t i = 0; i < sizeof(data); i++)
+    {
+        data[i] = i + 1;
+    }
+
+    SetUp(0);
+    CHECK(RingBuffer_isEmpty(&Ring));
+    CHECK_EQUAL(0, RingBuffer_DataLen(&Ring));
+    CHECK(!RingBuffer_DequeueByte(&Ring, &byte));
+
+    // Whole buffer can be filled, one byte more does not fit
+    CHECK(!RingBuffer_QueueBytes(&Ring, data, TEST_BUFFER_LEN + 1));
+    CHECK(RingBuffer_QueueBytes(&Ring, data, TEST_BUFFER_LEN));
+    CHECK_EQUAL(TEST_BUFFER_LEN, RingBuffer_DataLen(&Ring));
+    CHECK(!RingBuffer_isEmpty(&Ring));
+    CHECK(!RingBuffer_QueueBytes(&Ring, data, 1));
+
+    for (size_t i = 0; i < TEST_BUFFER_LEN; i++)
+    {
+        CHECK(RingBuffer_DequeueByte(&Ring, &byte));
+        CHECK_EQUAL(data[i], byte);
+    }
+    CHECK(RingBuffer_isEmpty(&Ring));
+    CHECK(!RingBuffer_DequeueByte(&Ring, &byte));
+
+    CHECK(RingBuffer_QueueBytes(&Ring, data, 0));
+    CHECK(RingBuffer_isEmpty(&Ring));
+}
+
+static void TestIndexOverflow(size_t start)
+{
+    uint8_t  data[TEST_BUFFER_LEN];
+    uint8_t  byte;
+    uint8_t  next_written = 0;
+    uint8_t  next_read    = 0;
+    uint16_t len;
+
+    SetUp(start);
+
+    // Indexes run past the overflow point with the buffer empty, partly filled and full
+    for (int round = 0; round < 4 * TEST_BUFFER_LEN; round++)
+    {
+        size_t count = (round % 3 == 0) ? TEST_BUFFER_LEN - RingBuffer_DataLen(&Ring) : 1 + round % 5;
+        for (size_t i = 0; i < count; i++)
+        {
+            data[i] = next_written + i;
+        }
+
+        if (RingBuffer_DataLen(&Ring) + count <= TEST_BUFFER_LEN)
+        {
+            CHECK(RingBuffer_QueueBytes(&Ring, data, count));
+            next_written += count;
+        }
+        else
+        {
+            CHECK(!RingBuffer_QueueBytes(&Ring, data, count));
+        }
+
+        CHECK_EQUAL((uint8_t)(next_written - next_read), RingBuffer_DataLen(&Ring));
+
+        uint8_t *p_continuous = RingBuffer_GetMaxContinuousBuffer(&Ring, &len);
+        CHECK(len <= RingBuffer_DataLen(&Ring));
+        CHECK(p_continuous + len <= &Buffer[TEST_BUFFER_LEN]);
+        for (uint16_t i = 0; i < len; i++)
+        {
+            CHECK_EQUAL((uint8_t)(next_read + i), p_continuous[i]);
+        }
+
+        size_t dequeue = (round % 2 == 0) ? 1 + round % 4 : RingBuffer_DataLen(&Ring);
+        for (size_t i = 0; (i < dequeue) && RingBuffer_DequeueByte(&Ring, &byte); i++)
+        {
+            CHECK_EQUAL(next_read, byte);
+            next_read++;
+        }
+    }
+
+    CHECK(Ring.wr - start > TEST_BUFFER_LEN);
+}
+
+static void TestReserveCommitAcrossWrap(void)
+{
+    RingBuffer_View_T view;
+    uint8_t           byte;
+
+    for (size_t start = 0; start < TEST_BUFFER_LEN; start++)
+    {
+        for (uint16_t len = 0; len <= TEST_BUFFER_LEN; len++)
+        {
+            SetUp(0xFFFFu - 7 + start);
+
+            CHECK(RingBuffer_Reserve(&Ring, len, &view));
+            CHECK_EQUAL(len, view.first_len + view.second_len);
+            CHECK_EQUAL(&Buffer[(start + 0xFFFFu - 7) & (TEST_BUFFER_LEN - 1)] - Buffer, view.p_first - Buffer);
+            CHECK(view.p_first + view.first_len <= &Buffer[TEST_BUFFER_LEN]);
+            CHECK_EQUAL(0, view.p_second - Buffer);
+
+            // Nothing is queued until commit
+            CHECK(RingBuffer_isEmpty(&Ring));
+
+            for (uint16_t i = 0; i < len; i++)
+            {
+                uint8_t *p_byte = (i < view.first_len) ? &view.p_first[i] : &view.p_second[i - view.first_len];
+                *p_byte         = 0xA0 + i;
+            }
+            RingBuffer_Commit(&Ring, len);
+
+            CHECK_EQUAL(len, RingBuffer_DataLen(&Ring));
+            CHECK(!RingBuffer_Reserve(&Ring, TEST_BUFFER_LEN - len + 1, &view));
+            for (uint16_t i = 0; i < len; i++)
+            {
+                CHECK(RingBuffer_DequeueByte(&Ring, &byte));
+                CHECK_EQUAL(0xA0 + i, byte);
+            }
+        }
+    }
+
+    // Only part of the reserved space may be committed
+    SetUp(TEST_BUFFER_LEN - 2);
+    CHECK(RingBuffer_Reserve(&Ring, 8, &view));
+    CHECK_EQUAL(2, view.first_len);
+    CHECK_EQUAL(6, view.second_len);
+    RingBuffer_Commit(&Ring, 3);
+    CHECK_EQUAL(3, RingBuffer_DataLen(&Ring));
+}
+
+static void TestPeekSegments(void)
+{
+    RingBuffer_View_T view;
+    uint8_t           data[TEST_BUFFER_LEN];
+
+    for (size_t i = 0; i < sizeof(data); i++)
+    {
+        data[i] = 0x10 + i;
+    }
+
+    SetUp(TEST_BUFFER_LEN - 5);
+    CHECK(RingBuffer_QueueBytes(&Ring, data, 12));
+
+    for (uint16_t offset = 0; offset <= 12; offset++)
+    {
+        for (uint16_t len = 0; offset + len <= 12; len++)
+        {
+            CHECK(RingBuffer_Peek(&Ring, offset, len, &view));
+            CHECK_EQUAL(len, view.first_len + view.second_len);
+            CHECK_EQUAL((offset < 5) ? ((len < 5 - offset) ? len : 5 - offset) : len, view.first_len);
+
+            for (uint16_t i = 0; i < len; i++)
+            {
+                uint8_t byte = (i < view.first_len) ? view.p_first[i] : view.p_second[i - view.first_len];
+                CHECK_EQUAL(data[offset + i], byte);
+                CHECK_EQUAL(data[offset + i], RingBuffer_PeekByte(&Ring, offset + i));
+            }
+        }
+
+        CHECK(!RingBuffer_Peek(&Ring, offset, 12 - offset + 1, &view));
+    }
+
+    // Peek does not dequeue, released bytes are gone
+    CHECK_EQUAL(12, RingBuffer_DataLen(&Ring));
+    RingBuffer_IncrementRdIndex(&Ring, 7);
+    CHECK(RingBuffer_Peek(&Ring, 0, 5, &view));
+    CHECK_EQUAL(data[7], view.p_first[0]);
+    CHECK_EQUAL(5, view.first_len);
+    CHECK_EQUAL(0, view.second_len);
+}
+
+static void TestProducerConsumerThreads(void)
+{
+    static uint8_t      stress_buffer[64];
+    static RingBuffer_T stress_ring;
+    unsigned            errors = 0;
+
+    RINGBUFFER_INIT(&stress_ring, stress_buffer);
+
+    // Producer writes in place through Reserve/Commit, as the UART TX path does, without locking
+    std::thread producer([] {
+        uint32_t written = 0;
+        while (written < STRESS_BYTES)
+        {
+            RingBuffer_View_T view;
+            uint16_t          len = 1 + written % 7;
+            if (len > STRESS_BYTES - written)
+            {
+                len = STRESS_BYTES - written;
+            }
+            if (!RingBuffer_Reserve(&stress_ring, len, &view))
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            for (uint16_t i = 0; i < len; i++)
+            {
+                uint8_t *p_byte = (i < view.first_len) ? &view.p_first[i] : &view.p_second[i - view.first_len];
+                *p_byte         = (uint8_t)(written + i);
+            }
+            RingBuffer_Commit(&stress_ring, len);
+            written += len;
+        }
+    });
+
+    uint32_t read = 0;
+    while (read < STRESS_BYTES)
+    {
+        uint16_t len;
+        uint8_t *p_data = RingBuffer_GetMaxContinuousBuffer(&stress_ring, &len);
+        if (len == 0)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        for (uint16_t i = 0; i < len; i++)
+        {
+            errors += (p_data[i] != (uint8_t)(read + i));
+        }
+        RingBuffer_IncrementRdIndex(&stress_ring, len);
+        read += len;
+    }
+    producer.join();
+
+    CHECK_EQUAL(0, errors);
+    CHECK_EQUAL(STRESS_BYTES, read);
+}
+
+/*
+ *  Queue chunks and dequeue them byte by byte, checking data length on every byte
+ *  like the old UART RX parser did
+ *
+ *  @return             Time in ns per byte
+ */
+template <typename Ring, typename Queue, typename Dequeue, typename Len>
+static double BenchmarkOne(Ring *p_ring, Queue queue, Dequeue dequeue, Len data_len, uint32_t *p_sum)
+{
+    uint8_t chunk[BENCH_CHUNK_LEN];
+    uint8_t byte;
+
+    for (size_t i = 0; i < sizeof(chunk); i++)
+    {
+        chunk[i] = i;
+    }
+
+    clock_t start = clock();
+    for (uint32_t done = 0; done < BENCH_BYTES; done += BENCH_CHUNK_LEN)
+    {
+        queue(p_ring, chunk, BENCH_CHUNK_LEN);
+        while (data_len(p_ring) != 0)
+        {
+            dequeue(p_ring, &byte);
+            *p_sum += byte;
+        }
+    }
+    return 1e9 * (clock() - start) / CLOCKS_PER_SEC / BENCH_BYTES;
+}
+
+static void Benchmark(void)
+{
+    static uint8_t  modulo_buffer[BENCH_BUFFER_LEN];
+    static uint8_t  mask_buffer[BENCH_BUFFER_LEN];
+    volatile size_t modulo_len  = BENCH_BUFFER_LEN;    // Length known only at runtime, as in the old RingBuffer_Init
+    ModuloRing_T    modulo_ring = {modulo_buffer, modulo_len, 0, 0};
+    RingBuffer_T    mask_ring;
+    uint32_t        modulo_sum = 0;
+    uint32_t        mask_sum   = 0;
+
+    RINGBUFFER_INIT(&mask_ring, mask_buffer);
+
+    double modulo_ns = BenchmarkOne(&modulo_ring, ModuloRing_QueueBytes, ModuloRing_DequeueByte, ModuloRing_DataLen, &modulo_sum);
+    double mask_ns   = BenchmarkOne(&mask_ring, RingBuffer_QueueBytes, RingBuffer_DequeueByte, RingBuffer_DataLen, &mask_sum);
+
+    CHECK_EQUAL(modulo_sum, mask_sum);
+    printf("RingBuffer (%d B): %.2f ns/byte, modulo RingBuffer: %.2f ns/byte\n", BENCH_BUFFER_LEN, mask_ns, modulo_ns);
+}
+
+int main(void)
+{
+    TestEmptyAndFull();
+
+    // Free running indexes cross 16 bit range used by lengths and the end of size_t range
+    TestIndexOverflow(0xFFFFu - 5);
+    TestIndexOverflow((size_t)0 - 5);
+
+    TestReserveCommitAcrossWrap();
+    TestPeekSegments();
+    TestProducerConsumerThreads();
+    Benchmark();
+
+    return TEST_RESULT();
+}
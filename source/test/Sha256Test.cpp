@@ -0,0 +1,236 @@
+/*
+Copyright © 2021 Silvair Sp. z o.o. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "CRC.h"
+#include "TestCheck.h"
+
+#define TEST_DATA_LEN 1000
+#define MILLION_LEN 1000000u
+#define BENCH_LEN (64u * 1024u)
+#define BENCH_ROUNDS 32
+
+typedef struct
+{
+    const char *p_message; /**< Message, or NULL for a run of 'a' */
+    size_t      len;       /**< Message length */
+    const char *p_digest;  /**< Expected digest as hex string */
+} KnownAnswer_T;
+
+/*
+ *  Messages from FIPS 180-2 examples and runs of 'a' around padding boundaries:
+ *  55 bytes is the longest message padded in one block, 56 bytes needs two blocks
+ */
+static const KnownAnswer_T KnownAnswers[] = {
+    {"", 0, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"},
+    {"abc", 3, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"},
+    {"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 56, "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"},
+    {"abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+     112,
+     "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1"},
+    {NULL, 55, "9f4390f8d30c2dd92ec9f095b65e2b9ae9b0a925a5258e241c9f1e910f734318"},
+    {NULL, 63, "7d3e74a05d7db15bce4ad9ec0658ea98e3f06eeecf16b4c6fff2da457ddc2f34"},
+    {NULL, 64, "ffe054fe7ae0cb6dc65c3af9b61d5209f439851db43d0ba5997337df154668eb"},
+    {NULL, 65, "635361c48bb9eab14198e76ea8ab7f1a41685d6ad62aa9146d301d4f17eb0ae0"},
+    {NULL, 119, "31eba51c313a5c08226adf18d4a359cfdfd8d2e816b13f4af952f7ea6584dcfb"},
+    {NULL, 120, "2f3d335432c70b580af0e8e1b3674a7c020d683aa5f73aaaedfdc55af904c21c"},
+};
+
+static uint8_t TestData[TEST_DATA_LEN];
+
+
+static void ParseDigest(const char *p_hex, uint8_t *p_digest)
+{
+    for (size_t i = 0; i < SHA256_DIGEST_SIZE; i++)
+    {
+        char byte[3] = {p_hex[2 * i], p_hex[2 * i + 1], 0};
+        p_digest[i]  = strtoul(byte, NULL, 16);
+    }
+}
+
+/*
+ *  Hash data with streaming calculation, in chunks of random length up to max_chunk
+ */
+static void StreamSHA256(const uint8_t *data, size_t len, size_t max_chunk, uint8_t *p_digest)
+{
+    Sha256_T ctx;
+    Sha256_Init(&ctx);
+
+    while (len > 0)
+    {
+        size_t chunk = rand() % (max_chunk + 1);
+        if (chunk > len)
+        {
+            chunk = len;
+        }
+
+        Sha256_Update(&ctx, data, chunk);
+        data += chunk;
+        len -= chunk;
+    }
+
+    Sha256_Final(&ctx, p_digest);
+}
+
+static void TestKnownAnswers(void)
+{
+    for (size_t i = 0; i < sizeof(KnownAnswers) / sizeof(KnownAnswers[0]); i++)
+    {
+        const KnownAnswer_T *p_answer = &KnownAnswers[i];
+        uint8_t              message[128];
+        uint8_t              expected[SHA256_DIGEST_SIZE];
+        uint8_t              digest[SHA256_DIGEST_SIZE];
+
+        if (p_answer->p_message != NULL)
+        {
+            memcpy(message, p_answer->p_message, p_answer->len);
+        }
+        else
+        {
+            memset(message, 'a', p_answer->len);
+        }
+        ParseDigest(p_answer->p_digest, expected);
+
+        CalcSHA256(message, p_answer->len, digest);
+        CHECK(memcmp(expected, digest, sizeof(digest)) == 0);
+
+        StreamSHA256(message, p_answer->len, 1, digest);
+        CHECK(memcmp(expected, digest, sizeof(digest)) == 0);
+
+        StreamSHA256(message, p_answer->len, SHA256_BLOCK_SIZE + 7, digest);
+        CHECK(memcmp(expected, digest, sizeof(digest)) == 0);
+    }
+}
+
+static void TestMillionA(void)
+{
+    uint8_t *p_data = (uint8_t *)malloc(MILLION_LEN);
+    uint8_t  expected[SHA256_DIGEST_SIZE];
+    uint8_t  digest[SHA256_DIGEST_SIZE];
+
+    memset(p_data, 'a', MILLION_LEN);
+    ParseDigest("cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0", expected);
+
+    // Length in bits overflows 16 and 24 bit counters
+    CalcSHA256(p_data, MILLION_LEN, digest);
+    CHECK(memcmp(expected, digest, sizeof(digest)) == 0);
+
+    StreamSHA256(p_data, MILLION_LEN, 300, digest);
+    CHECK(memcmp(expected, digest, sizeof(digest)) == 0);
+
+    free(p_data);
+}
+
+static void TestSplitUpdates(void)
+{
+    uint8_t expected[SHA256_DIGEST_SIZE];
+    uint8_t digest[SHA256_DIGEST_SIZE];
+
+    // DFU pages are hashed as they are stored, in any size from the modem
+    for (size_t len = 0; len <= TEST_DATA_LEN; len += (len < 200) ? 1 : 61)
+    {
+        CalcSHA256(TestData, len, expected);
+
+        for (size_t max_chunk = 1; max_chunk <= 130; max_chunk += 43)
+        {
+            StreamSHA256(TestData, len, max_chunk, digest);
+            CHECK(memcmp(expected, digest, sizeof(digest)) == 0);
+        }
+    }
+}
+
+static void TestResume(void)
+{
+    uint8_t expected[SHA256_DIGEST_SIZE];
+    uint8_t digest[SHA256_DIGEST_SIZE];
+
+    CalcSHA256(TestData, TEST_DATA_LEN, expected);
+
+    // Intermediate hash saved at every block boundary continues to the same digest
+    for (size_t resumed = 0; resumed <= TEST_DATA_LEN; resumed += SHA256_BLOCK_SIZE)
+    {
+        Sha256_T ctx;
+        uint32_t state[8];
+
+        Sha256_Init(&ctx);
+        Sha256_Update(&ctx, TestData, resumed / 2);
+        Sha256_Update(&ctx, &TestData[resumed / 2], resumed - resumed / 2);
+        CHECK_EQUAL(0, ctx.block_len);
+        memcpy(state, ctx.state, sizeof(state));
+
+        memset(&ctx, 0xA5, sizeof(ctx));
+        Sha256_Resume(&ctx, state, resumed);
+        for (size_t pos = resumed; pos < TEST_DATA_LEN;)
+        {
+            size_t chunk = 1 + rand() % 100;
+            if (chunk > TEST_DATA_LEN - pos)
+            {
+                chunk = TEST_DATA_LEN - pos;
+            }
+            Sha256_Update(&ctx, &TestData[pos], chunk);
+            pos += chunk;
+        }
+        Sha256_Final(&ctx, digest);
+
+        CHECK(memcmp(expected, digest, sizeof(digest)) == 0);
+    }
+}
+
+static void Benchmark(void)
+{
+    uint8_t *p_data = (uint8_t *)calloc(BENCH_LEN, 1);
+    uint8_t  digest[SHA256_DIGEST_SIZE];
+
+    clock_t start = clock();
+    for (int round = 0; round < BENCH_ROUNDS; round++)
+    {
+        p_data[0] = round;
+        CalcSHA256(p_data, BENCH_LEN, digest);
+    }
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    if (seconds > 0)
+    {
+        printf("SHA256: %.1f MB/s\n", (double)BENCH_LEN * BENCH_ROUNDS / seconds / 1e6);
+    }
+
+    free(p_data);
+}
+
+int main(void)
+{
+    srand(1);
+    for (size_t i = 0; i < TEST_DATA_LEN; i++)
+    {
+        TestData[i] = rand();
+    }
+
+    TestKnownAnswers();
+    TestMillionA();
+    TestSplitUpdates();
+    TestResume();
+    Benchmark();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,62 @@
+/*
+Copyright © 2021 Silvair Sp. z o.o. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+ *  Minimal check macros for host unit tests. A failed check is reported with
+ *  its location and the test continues; TEST_RESULT gives the process exit code.
+ */
+
+#ifndef TEST_CHECK_H_
+#define TEST_CHECK_H_
+
+
+#include <stdio.h>
+
+
+static unsigned TestFailures = 0;
+
+#define CHECK(condition)                                                                  \
+    do                                                                                    \
+    {                                                                                     \
+        if (!(condition))                                                                 \
+        {                                                                                 \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);          \
+            TestFailures++;                                                               \
+        }                                                                                 \
+    } while (0)
+
+#define CHECK_EQUAL(expected, actual)                                                     \
+    do                                                                                    \
+    {                                                                                     \
+        unsigned long long _expected = (unsigned long long)(expected);                    \
+        unsigned long long _actual   = (unsigned long long)(actual);                      \
+        if (_expected != _actual)                                                         \
+        {                                                                                 \
+            printf("%s:%d: %s expected 0x%llX, got 0x%llX\n",                             \
+                   __FILE__, __LINE__, #actual, _expected, _actual);                      \
+            TestFailures++;                                                               \
+        }                                                                                 \
+    } while (0)
+
+#define TEST_RESULT()                                                                     \
+    ((TestFailures == 0) ? (printf("PASSED\n"), 0) : (printf("FAILED: %u checks\n", TestFailures), 1))
+
+#endif    // TEST_CHECK_H_
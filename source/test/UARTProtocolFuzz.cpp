@@ -0,0 +1,219 @@
+/*
+Copyright © 2021 Silvair Sp. z o.o. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+ *  Feeds a stream of random frames through the UART parser: intact frames mixed
+ *  with corrupted, truncated and bad length frames and random garbage, received
+ *  in random chunks. Checks that every intact frame is dispatched and reports
+ *  parser throughput and outcome counters from UART link statistics.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "CRC.h"
+#include "FakeUARTDriver.h"
+#include "FakeUARTHandlers.h"
+#include "TestCheck.h"
+#include "UARTProtocol.h"
+#include "UARTStats.h"
+
+#define CMD_INIT_DEVICE_EVENT 0x03u /**< Handled command accepting any payload length */
+#define FRAME_OVERHEAD 6u
+#define MAX_FRAME_LEN (MAX_PAYLOAD_SIZE + FRAME_OVERHEAD)
+#define DEFAULT_FRAME_COUNT 100000u
+#define CORRUPTED_PERCENT 10u
+#define GARBAGE_PERCENT 5u
+#define MAX_CHUNK_LEN 200u
+
+typedef enum
+{
+    FRAME_INTACT,
+    FRAME_BIT_FLIP,
+    FRAME_TRUNCATED,
+    FRAME_BAD_LENGTH,
+} FrameKind_T;
+
+static uint32_t RandomState      = 1;
+static uint32_t ExpectedSeq      = 0; /**< Sequence number of the next intact frame */
+static uint32_t SentIntact       = 0;
+static uint32_t ReceivedIntact   = 0;
+static uint32_t ReceivedOutOfSeq = 0;
+
+
+static uint32_t Random(void)
+{
+    // xorshift32, the same sequence on every host
+    RandomState ^= RandomState << 13;
+    RandomState ^= RandomState >> 17;
+    RandomState ^= RandomState << 5;
+    return RandomState;
+}
+
+/*
+ *  Intact frames carry their sequence number in the first 4 payload bytes,
+ *  followed by bytes derived from it
+ */
+static uint16_t BuildFrame(uint8_t *p_frame, uint32_t seq, uint8_t len)
+{
+    p_frame[0] = 0xAA;
+    p_frame[1] = 0x55;
+    p_frame[2] = len;
+    p_frame[3] = CMD_INIT_DEVICE_EVENT;
+
+    for (uint8_t i = 0; i < len; i++)
+    {
+        p_frame[4 + i] = (i < sizeof(seq)) ? (uint8_t)(seq >> (8 * i)) : (uint8_t)(seq * 31 + i);
+    }
+
+    uint16_t crc     = CalcCRC16(&p_frame[2], len + 2, CRC16_INIT_VAL);
+    p_frame[4 + len] = lowByte(crc);
+    p_frame[5 + len] = highByte(crc);
+
+    return len + FRAME_OVERHEAD;
+}
+
+static void OnCommand(uint8_t cmd, uint8_t *p_payload, uint8_t len)
+{
+    uint8_t  expected[MAX_FRAME_LEN];
+    uint32_t seq = 0;
+
+    // Parser never dispatches longer payloads, the bound also keeps BuildFrame within expected
+    if ((cmd != CMD_INIT_DEVICE_EVENT) || (len < sizeof(seq)) || (len > MAX_PAYLOAD_SIZE))
+    {
+        ReceivedOutOfSeq++;
+        return;
+    }
+
+    memcpy(&seq, p_payload, sizeof(seq));
+    BuildFrame(expected, seq, len);
+
+    // Frames are never reordered, so a valid frame must be an intact one not seen yet
+    if ((seq < ExpectedSeq) || (seq >= SentIntact) || (memcmp(&expected[4], p_payload, len) != 0))
+    {
+        ReceivedOutOfSeq++;
+        return;
+    }
+
+    ExpectedSeq = seq + 1;
+    ReceivedIntact++;
+}
+
+static void Feed(const uint8_t *p_data, uint16_t len)
+{
+    while (len > 0)
+    {
+        uint16_t chunk    = 1 + Random() % MAX_CHUNK_LEN;
+        uint16_t accepted = FakeUARTDriver_Receive(p_data, (len < chunk) ? len : chunk);
+        p_data += accepted;
+        len -= accepted;
+
+        UART_ProcessIncomingCommand();
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t frame_count = (argc > 1) ? strtoul(argv[1], NULL, 0) : DEFAULT_FRAME_COUNT;
+    uint32_t corrupted   = 0;
+    uint64_t bytes       = 0;
+    uint8_t  frame[MAX_FRAME_LEN + 1];
+    uint8_t  garbage[MAX_FRAME_LEN];
+
+    UART_Init();
+    UARTStats_Reset();
+    FakeUARTHandlers_SetCallback(OnCommand);
+
+    clock_t start = clock();
+
+    for (uint32_t i = 0; i < frame_count; i++)
+    {
+        uint8_t     len       = Random() % (MAX_PAYLOAD_SIZE + 1);
+        uint16_t    frame_len = BuildFrame(frame, SentIntact, (len < sizeof(uint32_t)) ? sizeof(uint32_t) : len);
+        FrameKind_T kind      = FRAME_INTACT;
+
+        if (Random() % 100 < CORRUPTED_PERCENT)
+        {
+            kind = (FrameKind_T)(FRAME_BIT_FLIP + Random() % 3);
+        }
+
+        switch (kind)
+        {
+            case FRAME_INTACT:
+                SentIntact++;
+                break;
+            case FRAME_BIT_FLIP:
+                frame[2 + Random() % (frame_len - 2)] ^= 1u << (Random() % 8);
+                break;
+            case FRAME_TRUNCATED:
+                frame_len = 1 + Random() % (frame_len - 1);
+                break;
+            case FRAME_BAD_LENGTH:
+                frame[2] = MAX_PAYLOAD_SIZE + 1 + Random() % (0xFF - MAX_PAYLOAD_SIZE);
+                break;
+        }
+        corrupted += (kind != FRAME_INTACT);
+
+        Feed(frame, frame_len);
+        bytes += frame_len;
+
+        if (Random() % 100 < GARBAGE_PERCENT)
+        {
+            uint16_t garbage_len = 1 + Random() % sizeof(garbage);
+            for (uint16_t j = 0; j < garbage_len; j++)
+            {
+                // Preamble bytes are frequent, so false frame starts are common
+                uint32_t value = Random();
+                garbage[j]     = ((value & 0x300) == 0) ? 0xAA : ((value & 0x300) == 0x100) ? 0x55 : (uint8_t)value;
+            }
+            Feed(garbage, garbage_len);
+            bytes += garbage_len;
+        }
+    }
+
+    // Trailing bytes complete any frame that is still waiting for its claimed length
+    memset(garbage, 0, sizeof(garbage));
+    Feed(garbage, sizeof(garbage));
+    Feed(garbage, sizeof(garbage));
+
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    const UARTStats_T *p_stats = UARTStats_Get();
+    printf("Frames: %u intact, %u corrupted, %llu bytes\n", SentIntact, corrupted, (unsigned long long)bytes);
+    printf("Dispatched: %u intact, %u not sent as intact\n", ReceivedIntact, ReceivedOutOfSeq);
+    printf("Parser: %lu passes, %lu partial frames, %lu CRC errors, %lu bad lengths, %lu resync bytes\n",
+           (unsigned long)p_stats->rx_parse_passes,
+           (unsigned long)p_stats->rx_partial_frames,
+           (unsigned long)p_stats->crc_errors,
+           (unsigned long)p_stats->bad_lengths,
+           (unsigned long)p_stats->resyncs);
+    if (seconds > 0)
+    {
+        printf("Throughput: %.0f frames/s, %.1f MB/s\n", frame_count / seconds, bytes / seconds / 1e6);
+    }
+
+    // An intact frame can only be lost if a corrupted one passed CRC check in its place
+    CHECK(SentIntact - ReceivedIntact <= ReceivedOutOfSeq);
+    CHECK(ReceivedOutOfSeq <= corrupted / 1000 + 1);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,447 @@
+/*
+Copyright © 2021 Silvair Sp. z o.o. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <string.h>
+
+#include "Arduino.h"
+#include "CRC.h"
+#include "FakeUARTDriver.h"
+#include "FakeUARTHandlers.h"
+#include "TestCheck.h"
+#include "UARTProtocol.h"
+#include "Utils.h"
+
+#define CMD_INIT_DEVICE_EVENT 0x03u /**< Handled command accepting any payload length */
+#define CMD_ATTENTION_EVENT 0x16u   /**< Handled command with minimal payload length 1 */
+#define CMD_UNHANDLED 0x30u
+#define CMD_PING_REQUEST 0x01u
+#define CMD_MESH_MESSAGE_REQUEST 0x07u
+#define CMD_SENSOR_UPDATE_REQUEST 0x15u
+#define CMD_BATTERY_STATUS_SET_REQ 0x26u
+#define TX_FILL_PAYLOAD_LEN 100u /**< Four control frames of this payload leave less than the control reserve in TX buffer */
+#define TX_FILL_FRAMES 4u
+#define TX_STALL_LONG_US 1000000u
+#define FRAME_OVERHEAD 6u
+#define MAX_FRAME_LEN (MAX_PAYLOAD_SIZE + FRAME_OVERHEAD)
+#define MAX_CALLS 64
+#define PROCESS_PASSES 64
+
+typedef struct
+{
+    uint8_t cmd;
+    uint8_t len;
+    uint8_t payload[MAX_PAYLOAD_SIZE];
+} Call_T;
+
+static Call_T   Calls[MAX_CALLS];
+static uint32_t CallCount = 0;
+
+
+static void RecordCall(uint8_t cmd, uint8_t *p_payload, uint8_t len)
+{
+    if (CallCount < MAX_CALLS)
+    {
+        Calls[CallCount].cmd = cmd;
+        Calls[CallCount].len = len;
+        memcpy(Calls[CallCount].payload, p_payload, len);
+    }
+    CallCount++;
+}
+
+static void SetUp(void)
+{
+    UART_Init();
+    FakeUARTHandlers_SetCallback(RecordCall);
+    CallCount = 0;
+
+    // Parser state left by the previous test is dropped the same way as after lost bytes
+    FakeUARTDriver_LoseRxData();
+    UART_ProcessIncomingCommand();
+}
+
+/*
+ *  Build frame: preamble, length, command, payload and CRC16 (low byte first)
+ */
+static uint16_t BuildFrame(uint8_t *p_frame, uint8_t cmd, const uint8_t *p_payload, uint8_t len)
+{
+    p_frame[0] = 0xAA;
+    p_frame[1] = 0x55;
+    p_frame[2] = len;
+    p_frame[3] = cmd;
+    memcpy(&p_frame[4], p_payload, len);
+
+    uint16_t crc    = CalcCRC16(&p_frame[2], len + 2, CRC16_INIT_VAL);
+    p_frame[4 + len] = lowByte(crc);
+    p_frame[5 + len] = highByte(crc);
+
+    return len + FRAME_OVERHEAD;
+}
+
+/*
+ *  Feed bytes in chunks of given size, processing after each chunk
+ */
+static void Feed(const uint8_t *p_data, uint16_t len, uint16_t chunk)
+{
+    while (len > 0)
+    {
+        uint16_t accepted = FakeUARTDriver_Receive(p_data, (len < chunk) ? len : chunk);
+        p_data += accepted;
+        len -= accepted;
+
+        for (int pass = 0; pass < PROCESS_PASSES; pass++)
+        {
+            UART_ProcessIncomingCommand();
+        }
+    }
+}
+
+/*
+ *  Split bytes transmitted since tx_start into frames, reusing Call_T for frame contents
+ */
+static uint32_t GetTxFrames(uint16_t tx_start, Call_T *p_frames, uint32_t max_frames)
+{
+    uint16_t       tx_len;
+    const uint8_t *p_tx  = FakeUARTDriver_GetTx(&tx_len);
+    uint32_t       count = 0;
+
+    for (uint16_t i = tx_start; (i + FRAME_OVERHEAD <= tx_len) && (count < max_frames); i += p_tx[i + 2] + FRAME_OVERHEAD)
+    {
+        p_frames[count].cmd = p_tx[i + 3];
+        p_frames[count].len = p_tx[i + 2];
+        memcpy(p_frames[count].payload, &p_tx[i + 4], p_tx[i + 2]);
+        count++;
+    }
+
+    return count;
+}
+
+/*
+ *  Stall TX and fill TX buffer with control frames up to the control reserve
+ */
+static uint16_t FillStalledTx(uint32_t stall_us)
+{
+    uint8_t  payload[TX_FILL_PAYLOAD_LEN] = {0};
+    uint16_t tx_start;
+
+    FakeUARTDriver_GetTx(&tx_start);
+    FakeUARTDriver_StallTx(stall_us);
+
+    for (size_t i = 0; i < TX_FILL_FRAMES; i++)
+    {
+        CHECK_EQUAL(UART_TX_STATUS_SENT, UART_SendMeshMessageRequest(payload, sizeof(payload)));
+    }
+
+    return tx_start;
+}
+
+static void CheckCall(uint32_t idx, uint8_t cmd, const uint8_t *p_payload, uint8_t len)
+{
+    CHECK(idx < CallCount);
+    if (idx >= CallCount)
+    {
+        return;
+    }
+
+    CHECK_EQUAL(cmd, Calls[idx].cmd);
+    CHECK_EQUAL(len, Calls[idx].len);
+    CHECK(memcmp(p_payload, Calls[idx].payload, len) == 0);
+}
+
+static void TestFramesSplitAtEveryByte(void)
+{
+    uint8_t  payload[MAX_PAYLOAD_SIZE];
+    uint8_t  stream[3 * MAX_FRAME_LEN];
+    uint16_t stream_len = 0;
+
+    for (size_t i = 0; i < sizeof(payload); i++)
+    {
+        payload[i] = 0xAA ^ i;
+    }
+
+    stream_len += BuildFrame(&stream[stream_len], CMD_INIT_DEVICE_EVENT, payload, 0);
+    stream_len += BuildFrame(&stream[stream_len], CMD_INIT_DEVICE_EVENT, payload, 17);
+    stream_len += BuildFrame(&stream[stream_len], CMD_INIT_DEVICE_EVENT, payload, MAX_PAYLOAD_SIZE);
+
+    // CRC is folded in as bytes arrive, so every split of the stream gives the same frames
+    for (uint16_t chunk = 1; chunk <= stream_len; chunk += (chunk < 16) ? 1 : 37)
+    {
+        SetUp();
+        Feed(stream, stream_len, chunk);
+
+        CHECK_EQUAL(3, CallCount);
+        CheckCall(0, CMD_INIT_DEVICE_EVENT, payload, 0);
+        CheckCall(1, CMD_INIT_DEVICE_EVENT, payload, 17);
+        CheckCall(2, CMD_INIT_DEVICE_EVENT, payload, MAX_PAYLOAD_SIZE);
+    }
+}
+
+static void TestPreambleInsideRejectedFrame(void)
+{
+    uint8_t  inner[MAX_FRAME_LEN];
+    uint8_t  outer[MAX_FRAME_LEN];
+    uint8_t  next[MAX_FRAME_LEN];
+    uint8_t  stream[3 * MAX_FRAME_LEN];
+    uint8_t  inner_payload[] = {0x01, 0x02, 0x03};
+    uint8_t  next_payload[]  = {0x42};
+    uint16_t inner_len       = BuildFrame(inner, CMD_INIT_DEVICE_EVENT, inner_payload, sizeof(inner_payload));
+    uint16_t next_len        = BuildFrame(next, CMD_ATTENTION_EVENT, next_payload, sizeof(next_payload));
+
+    // Outer frame carries a complete frame in its payload and is rejected on CRC
+    uint16_t outer_len = BuildFrame(outer, CMD_INIT_DEVICE_EVENT, inner, inner_len);
+    outer[outer_len - 1] ^= 0x01;
+
+    uint16_t stream_len = 0;
+    memcpy(&stream[stream_len], outer, outer_len);
+    stream_len += outer_len;
+    memcpy(&stream[stream_len], next, next_len);
+    stream_len += next_len;
+
+    for (uint16_t chunk = 1; chunk <= stream_len; chunk++)
+    {
+        SetUp();
+        Feed(stream, stream_len, chunk);
+
+        // Only the corrupted frame is lost, the frame inside it and the next one are found
+        CHECK_EQUAL(2, CallCount);
+        CheckCall(0, CMD_INIT_DEVICE_EVENT, inner_payload, sizeof(inner_payload));
+        CheckCall(1, CMD_ATTENTION_EVENT, next_payload, sizeof(next_payload));
+    }
+}
+
+static void TestPreambleInsideBadLength(void)
+{
+    uint8_t  frame[MAX_FRAME_LEN];
+    uint8_t  payload[] = {0x10, 0x20};
+    uint8_t  stream[2 * MAX_FRAME_LEN];
+    uint16_t stream_len = 0;
+    uint16_t frame_len  = BuildFrame(frame, CMD_INIT_DEVICE_EVENT, payload, sizeof(payload));
+
+    // Length over MAX_PAYLOAD_SIZE, then preamble fragments and a frame right after the bad header
+    const uint8_t garbage[] = {0xAA, 0x55, MAX_PAYLOAD_SIZE + 1, 0xAA, 0xAA, 0x00, 0x55, 0xAA};
+    memcpy(&stream[stream_len], garbage, sizeof(garbage));
+    stream_len += sizeof(garbage);
+    memcpy(&stream[stream_len], frame, frame_len);
+    stream_len += frame_len;
+
+    for (uint16_t chunk = 1; chunk <= stream_len; chunk++)
+    {
+        SetUp();
+        Feed(stream, stream_len, chunk);
+
+        CHECK_EQUAL(1, CallCount);
+        CheckCall(0, CMD_INIT_DEVICE_EVENT, payload, sizeof(payload));
+    }
+}
+
+static void TestRejectedCommands(void)
+{
+    uint8_t  frame[MAX_FRAME_LEN];
+    uint8_t  payload[] = {0x07};
+    uint16_t frame_len;
+
+    SetUp();
+
+    // Valid frames with no handler or with a payload length not accepted by it are not dispatched
+    frame_len = BuildFrame(frame, CMD_UNHANDLED, payload, sizeof(payload));
+    Feed(frame, frame_len, frame_len);
+    frame_len = BuildFrame(frame, CMD_ATTENTION_EVENT, payload, 0);
+    Feed(frame, frame_len, frame_len);
+    CHECK_EQUAL(0, CallCount);
+
+    frame_len = BuildFrame(frame, CMD_ATTENTION_EVENT, payload, sizeof(payload));
+    Feed(frame, frame_len, frame_len);
+    CHECK_EQUAL(1, CallCount);
+    CheckCall(0, CMD_ATTENTION_EVENT, payload, sizeof(payload));
+}
+
+static void TestFrameWrappedInBuffer(void)
+{
+    uint8_t  frame[MAX_FRAME_LEN];
+    uint8_t  payload[MAX_PAYLOAD_SIZE];
+    uint16_t frame_len;
+
+    for (size_t i = 0; i < sizeof(payload); i++)
+    {
+        payload[i] = i * 7;
+    }
+    frame_len = BuildFrame(frame, CMD_INIT_DEVICE_EVENT, payload, sizeof(payload));
+
+    // Frames at every position move the frame start around the whole RX buffer
+    SetUp();
+    for (int i = 0; i < FAKE_UART_DRIVER_RX_BUFFER_LEN; i++)
+    {
+        Feed(frame, frame_len, frame_len);
+        uint8_t pad = 0x00;
+        Feed(&pad, 1, 1);
+    }
+
+    CHECK_EQUAL(FAKE_UART_DRIVER_RX_BUFFER_LEN, CallCount);
+    for (uint32_t i = 0; i < MAX_CALLS; i++)
+    {
+        CheckCall(i, CMD_INIT_DEVICE_EVENT, payload, sizeof(payload));
+    }
+}
+
+static void TestRxDataLoss(void)
+{
+    uint8_t  frame[MAX_FRAME_LEN];
+    uint8_t  payload[] = {0x01, 0x02, 0x03, 0x04};
+    uint16_t frame_len = BuildFrame(frame, CMD_INIT_DEVICE_EVENT, payload, sizeof(payload));
+    uint32_t losses;
+
+    SetUp();
+    losses = FakeUARTHandlers_GetRxDataLossCount();
+
+    // Frame cut by lost bytes is dropped together with the CRC folded so far
+    Feed(frame, frame_len / 2, frame_len);
+    FakeUARTDriver_LoseRxData();
+    UART_ProcessIncomingCommand();
+    Feed(frame, frame_len, frame_len);
+
+    CHECK_EQUAL(losses + 1, FakeUARTHandlers_GetRxDataLossCount());
+    CHECK_EQUAL(1, CallCount);
+    CheckCall(0, CMD_INIT_DEVICE_EVENT, payload, sizeof(payload));
+}
+
+static void TestControlFrameBacklog(void)
+{
+    uint8_t  payload[TX_FILL_PAYLOAD_LEN] = {0};
+    uint8_t  battery[]                    = {0x05, 0x64, 0x00};
+    Call_T   frames[TX_FILL_FRAMES + 4];
+    uint32_t drops = UART_GetTxDropCount();
+
+    SetUp();
+    uint16_t tx_start = FillStalledTx(TX_STALL_LONG_US);
+    uint32_t start    = millis();
+
+    // Control frame not fitting in TX buffer waits in control backlog without blocking the caller
+    payload[0] = 1;
+    CHECK_EQUAL(UART_TX_STATUS_DEFERRED, UART_SendMeshMessageRequest(payload, sizeof(payload)));
+    CHECK_EQUAL(start, millis());
+
+    // Telemetry does not overtake control frames waiting in the backlog
+    CHECK_EQUAL(UART_TX_STATUS_DEFERRED, UART_SendBatteryStatusSetRequest(battery, sizeof(battery)));
+    CHECK_EQUAL(drops, UART_GetTxDropCount());
+
+    // Next control frame goes after the waiting one, even if the TX buffer has space by then
+    MockClock_Advance(TX_STALL_LONG_US);
+    payload[0] = 2;
+    CHECK_EQUAL(UART_TX_STATUS_SENT, UART_SendMeshMessageRequest(payload, sizeof(payload)));
+    UART_ProcessIncomingCommand();
+
+    CHECK_EQUAL(TX_FILL_FRAMES + 3, GetTxFrames(tx_start, frames, ARRAY_SIZE(frames)));
+    CHECK_EQUAL(CMD_MESH_MESSAGE_REQUEST, frames[TX_FILL_FRAMES].cmd);
+    CHECK_EQUAL(1, frames[TX_FILL_FRAMES].payload[0]);
+    CHECK_EQUAL(CMD_MESH_MESSAGE_REQUEST, frames[TX_FILL_FRAMES + 1].cmd);
+    CHECK_EQUAL(2, frames[TX_FILL_FRAMES + 1].payload[0]);
+    CHECK_EQUAL(CMD_BATTERY_STATUS_SET_REQ, frames[TX_FILL_FRAMES + 2].cmd);
+    CHECK_EQUAL(drops, UART_GetTxDropCount());
+}
+
+static void TestControlBacklogFull(void)
+{
+    uint8_t  payload[TX_FILL_PAYLOAD_LEN] = {0};
+    Call_T   frames[TX_FILL_FRAMES + 4];
+    uint32_t drops  = UART_GetTxDropCount();
+    size_t   queued = UART_TX_CONTROL_BACKLOG_LEN / (TX_FILL_PAYLOAD_LEN + 2);
+
+    SetUp();
+    uint16_t tx_start = FillStalledTx(TX_STALL_LONG_US);
+
+    for (size_t i = 0; i < queued; i++)
+    {
+        CHECK_EQUAL(UART_TX_STATUS_DEFERRED, UART_SendMeshMessageRequest(payload, sizeof(payload)));
+    }
+
+    // Control frame is dropped only if TX stalls long enough to fill the backlog too
+    CHECK_EQUAL(UART_TX_STATUS_DROPPED, UART_SendMeshMessageRequest(payload, sizeof(payload)));
+    CHECK_EQUAL(drops + 1, UART_GetTxDropCount());
+
+    MockClock_Advance(TX_STALL_LONG_US);
+    UART_ProcessIncomingCommand();
+    CHECK_EQUAL(TX_FILL_FRAMES + queued, GetTxFrames(tx_start, frames, ARRAY_SIZE(frames)));
+}
+
+static void TestTelemetryDeferral(void)
+{
+    uint8_t  sensor_a_1[] = {0x01, 0x02, 0x03, 0x11};
+    uint8_t  sensor_a_2[] = {0x01, 0x02, 0x03, 0x22};
+    uint8_t  sensor_b[]   = {0x01, 0x02, 0x04, 0x33};
+    uint8_t  sensor_c[]   = {0x09, 0x02, 0x03, 0x44};
+    uint8_t  battery[]    = {0x05, 0x64, 0x00};
+    uint8_t  too_long[UART_TX_DEFERRED_PAYLOAD_MAX + 1] = {0};
+    Call_T   frames[TX_FILL_FRAMES + UART_TX_DEFERRED_SLOTS + 2];
+    uint32_t drops = UART_GetTxDropCount();
+
+    SetUp();
+    uint16_t tx_start = FillStalledTx(TX_STALL_LONG_US);
+
+    // Deferred frame cannot be longer than the deferred slot
+    CHECK_EQUAL(UART_TX_STATUS_DROPPED, UART_SendSensorUpdateRequest(too_long, sizeof(too_long)));
+    CHECK_EQUAL(drops + 1, UART_GetTxDropCount());
+
+    CHECK_EQUAL(UART_TX_STATUS_DEFERRED, UART_SendSensorUpdateRequest(sensor_a_1, sizeof(sensor_a_1)));
+    CHECK_EQUAL(UART_TX_STATUS_DEFERRED, UART_SendBatteryStatusSetRequest(battery, sizeof(battery)));
+    CHECK_EQUAL(drops + 1, UART_GetTxDropCount());
+
+    // Newer value of the same sensor replaces the deferred one in place
+    CHECK_EQUAL(UART_TX_STATUS_DEFERRED, UART_SendSensorUpdateRequest(sensor_a_2, sizeof(sensor_a_2)));
+    CHECK_EQUAL(drops + 2, UART_GetTxDropCount());
+
+    CHECK_EQUAL(UART_TX_STATUS_DEFERRED, UART_SendSensorUpdateRequest(sensor_b, sizeof(sensor_b)));
+    CHECK_EQUAL(UART_TX_STATUS_DEFERRED, UART_SendPingRequest());
+
+    // All deferred slots are taken by other values
+    CHECK_EQUAL(UART_TX_STATUS_DROPPED, UART_SendSensorUpdateRequest(sensor_c, sizeof(sensor_c)));
+    CHECK_EQUAL(drops + 3, UART_GetTxDropCount());
+
+    MockClock_Advance(TX_STALL_LONG_US);
+    UART_ProcessIncomingCommand();
+
+    // Deferred frames follow the control frames, oldest first
+    CHECK_EQUAL(TX_FILL_FRAMES + 4, GetTxFrames(tx_start, frames, ARRAY_SIZE(frames)));
+    CHECK_EQUAL(CMD_SENSOR_UPDATE_REQUEST, frames[TX_FILL_FRAMES].cmd);
+    CHECK(memcmp(sensor_a_2, frames[TX_FILL_FRAMES].payload, sizeof(sensor_a_2)) == 0);
+    CHECK_EQUAL(CMD_BATTERY_STATUS_SET_REQ, frames[TX_FILL_FRAMES + 1].cmd);
+    CHECK(memcmp(battery, frames[TX_FILL_FRAMES + 1].payload, sizeof(battery)) == 0);
+    CHECK_EQUAL(CMD_SENSOR_UPDATE_REQUEST, frames[TX_FILL_FRAMES + 2].cmd);
+    CHECK(memcmp(sensor_b, frames[TX_FILL_FRAMES + 2].payload, sizeof(sensor_b)) == 0);
+    CHECK_EQUAL(CMD_PING_REQUEST, frames[TX_FILL_FRAMES + 3].cmd);
+    CHECK_EQUAL(0, frames[TX_FILL_FRAMES + 3].len);
+
+    CHECK_EQUAL(UART_TX_STATUS_SENT, UART_SendSensorUpdateRequest(sensor_c, sizeof(sensor_c)));
+    CHECK_EQUAL(drops + 3, UART_GetTxDropCount());
+}
+
+int main(void)
+{
+    TestFramesSplitAtEveryByte();
+    TestPreambleInsideRejectedFrame();
+    TestPreambleInsideBadLength();
+    TestRejectedCommands();
+    TestFrameWrappedInBuffer();
+    TestRxDataLoss();
+    TestControlFrameBacklog();
+    TestControlBacklogFull();
+    TestTelemetryDeferral();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,277 @@
+/*
+Copyright © 2021 Silvair Sp. z o.o. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <string.h>
+
+#include "CRC.h"
+#include "FakeUARTDriver.h"
+#include "FakeUARTHandlers.h"
+#include "TestCheck.h"
+#include "UARTProtocol.h"
+#include "UARTStats.h"
+#include "Utils.h"
+
+#define CMD_INIT_DEVICE_EVENT 0x03u    /**< Handled command accepting any payload length */
+#define CMD_ATTENTION_EVENT 0x16u      /**< Handled command with minimal payload length 1 */
+#define CMD_DFU_WRITE_DATA_EVENT 0x86u /**< Handled DFU command */
+#define CMD_START_NODE_RESPONSE 0x0Bu
+#define CMD_UNHANDLED 0x30u
+#define IDX_INIT_DEVICE_EVENT 0x03u
+#define IDX_DFU_WRITE_DATA_EVENT (UART_STATS_CMD_BASE_COUNT + 0x06u)
+#define RTT_IDX_START_NODE 2u
+#define FRAME_OVERHEAD 6u
+#define MAX_FRAME_LEN (MAX_PAYLOAD_SIZE + FRAME_OVERHEAD)
+#define PROCESS_PASSES 8
+
+static uint32_t HandlerTimeUs = 0; /**< Time each handler call takes on the mock clock */
+
+
+static void AdvanceClock(uint8_t cmd, uint8_t *p_payload, uint8_t len)
+{
+    UNUSED(cmd);
+    UNUSED(p_payload);
+    UNUSED(len);
+
+    MockClock_Advance(HandlerTimeUs);
+}
+
+static void SetUp(void)
+{
+    UART_Init();
+    FakeUARTHandlers_SetCallback(AdvanceClock);
+
+    // Parser state left by the previous test is dropped the same way as after lost bytes
+    FakeUARTDriver_LoseRxData();
+    UART_ProcessIncomingCommand();
+
+    UARTStats_Reset();
+}
+
+/*
+ *  Send frame with given command and payload length, handler takes time_us
+ */
+static void SendFrame(uint8_t cmd, uint8_t len, uint32_t time_us)
+{
+    uint8_t frame[MAX_FRAME_LEN] = {0};
+
+    frame[0] = 0xAA;
+    frame[1] = 0x55;
+    frame[2] = len;
+    frame[3] = cmd;
+
+    uint16_t crc   = CalcCRC16(&frame[2], len + 2, CRC16_INIT_VAL);
+    frame[4 + len] = lowByte(crc);
+    frame[5 + len] = highByte(crc);
+    HandlerTimeUs  = time_us;
+
+    FakeUARTDriver_Receive(frame, len + FRAME_OVERHEAD);
+    for (int pass = 0; pass < PROCESS_PASSES; pass++)
+    {
+        UART_ProcessIncomingCommand();
+    }
+}
+
+static void CheckHandler(size_t idx, uint32_t count, uint32_t total_us, uint32_t max_us)
+{
+    const UARTStats_Handler_T *p_handler = &UARTStats_Get()->handlers[idx];
+
+    CHECK_EQUAL(count, p_handler->count);
+    CHECK_EQUAL(total_us, p_handler->total_us);
+    CHECK_EQUAL(max_us, p_handler->max_us);
+}
+
+static void TestHandlerTime(void)
+{
+    SetUp();
+
+    SendFrame(CMD_INIT_DEVICE_EVENT, 0, 10);
+    SendFrame(CMD_INIT_DEVICE_EVENT, 5, 250);
+    // Time between frames is not spent in any handler
+    MockClock_Advance(100000);
+    SendFrame(CMD_INIT_DEVICE_EVENT, MAX_PAYLOAD_SIZE, 40);
+    SendFrame(CMD_DFU_WRITE_DATA_EVENT, 20, 1000);
+    SendFrame(CMD_DFU_WRITE_DATA_EVENT, 20, 0);
+
+    CheckHandler(IDX_INIT_DEVICE_EVENT, 3, 300, 250);
+    CheckHandler(IDX_DFU_WRITE_DATA_EVENT, 2, 1000, 1000);
+    CHECK_EQUAL(3, UARTStats_Get()->rx_frames[IDX_INIT_DEVICE_EVENT]);
+    CHECK_EQUAL(2, UARTStats_Get()->rx_frames[IDX_DFU_WRITE_DATA_EVENT]);
+
+    for (size_t i = 0; i < UART_STATS_CMD_COUNT; i++)
+    {
+        if ((i != IDX_INIT_DEVICE_EVENT) && (i != IDX_DFU_WRITE_DATA_EVENT))
+        {
+            CheckHandler(i, 0, 0, 0);
+        }
+    }
+}
+
+static void TestRejectedFramesNotTimed(void)
+{
+    SetUp();
+
+    // Frames dropped before dispatch never reach a handler
+    SendFrame(CMD_UNHANDLED, 1, 500);
+    SendFrame(CMD_ATTENTION_EVENT, 0, 500);
+
+    CHECK_EQUAL(1, UARTStats_Get()->unhandled_cmds);
+    CHECK_EQUAL(1, UARTStats_Get()->rejected_lengths);
+    for (size_t i = 0; i < UART_STATS_CMD_COUNT; i++)
+    {
+        CheckHandler(i, 0, 0, 0);
+    }
+
+    SendFrame(CMD_ATTENTION_EVENT, 1, 70);
+    CheckHandler(CMD_ATTENTION_EVENT, 1, 70, 70);
+}
+
+static void TestHandlerTimeAcrossMicrosWrap(void)
+{
+    SetUp();
+
+    // micros() wraps after about 71 minutes, handler starts 0x100 us before the wrap
+    MockClock_Advance(0xFFFFFF00u - micros());
+    SendFrame(CMD_INIT_DEVICE_EVENT, 1, 0x300);
+
+    CHECK_EQUAL(0x200, micros());
+    CheckHandler(IDX_INIT_DEVICE_EVENT, 1, 0x300, 0x300);
+}
+
+static void TestParseSkippedWithoutRxData(void)
+{
+    SetUp();
+
+    for (int pass = 0; pass < PROCESS_PASSES; pass++)
+    {
+        UART_ProcessIncomingCommand();
+    }
+    CHECK_EQUAL(0, UARTStats_Get()->rx_parse_passes);
+
+    // Idle line is a hint that a frame may be complete, even without new bytes
+    FakeUARTDriver_RxIdle();
+    UART_ProcessIncomingCommand();
+    UART_ProcessIncomingCommand();
+    CHECK_EQUAL(1, UARTStats_Get()->rx_parse_passes);
+
+    // New bytes are parsed without the hint
+    SendFrame(CMD_INIT_DEVICE_EVENT, 0, 0);
+    CHECK_EQUAL(2, UARTStats_Get()->rx_parse_passes);
+    CHECK_EQUAL(1, UARTStats_Get()->rx_frames[IDX_INIT_DEVICE_EVENT]);
+}
+
+/*
+ *  Send Start Node Request and receive its response after rtt_us
+ */
+static void MeasureRtt(uint32_t rtt_us)
+{
+    UART_StartNodeRequest();
+    MockClock_Advance(rtt_us);
+    SendFrame(CMD_START_NODE_RESPONSE, 0, 0);
+}
+
+static void TestRttEmpty(void)
+{
+    const UARTStats_Rtt_T *p_rtt = &UARTStats_Get()->rtt[RTT_IDX_START_NODE];
+
+    SetUp();
+
+    // Response without a pending request is not measured
+    SendFrame(CMD_START_NODE_RESPONSE, 0, 0);
+
+    CHECK_EQUAL(0, p_rtt->count);
+    CHECK_EQUAL(0, UARTStats_RttPercentile(p_rtt, 0));
+    CHECK_EQUAL(0, UARTStats_RttPercentile(p_rtt, 50));
+    CHECK_EQUAL(0, UARTStats_RttPercentile(p_rtt, 100));
+}
+
+static void TestRttPercentiles(void)
+{
+    const UARTStats_Rtt_T *p_rtt = &UARTStats_Get()->rtt[RTT_IDX_START_NODE];
+
+    SetUp();
+
+    for (size_t i = 0; i < 98; i++)
+    {
+        MeasureRtt(300);
+    }
+    MeasureRtt(5000);
+    MeasureRtt(20000);
+
+    CHECK_EQUAL(100, p_rtt->count);
+    CHECK_EQUAL(300, p_rtt->min_us);
+    CHECK_EQUAL(20000, p_rtt->max_us);
+    CHECK_EQUAL(98, p_rtt->buckets[9]);  /* [256, 512) us */
+    CHECK_EQUAL(1, p_rtt->buckets[13]);  /* [4096, 8192) us */
+    CHECK_EQUAL(1, p_rtt->buckets[15]);  /* [16384, 32768) us */
+
+    // Percentile is reported as the upper bound of its bucket, capped at maximum
+    CHECK_EQUAL(511, UARTStats_RttPercentile(p_rtt, 0));
+    CHECK_EQUAL(511, UARTStats_RttPercentile(p_rtt, 50));
+    CHECK_EQUAL(511, UARTStats_RttPercentile(p_rtt, 98));
+    CHECK_EQUAL(8191, UARTStats_RttPercentile(p_rtt, 99));
+    CHECK_EQUAL(20000, UARTStats_RttPercentile(p_rtt, 100));
+
+    // Only the last request is measured if the previous one was not answered
+    UART_StartNodeRequest();
+    MockClock_Advance(100000);
+    MeasureRtt(1);
+
+    CHECK_EQUAL(101, p_rtt->count);
+    CHECK_EQUAL(1, p_rtt->min_us);
+    CHECK_EQUAL(1, p_rtt->buckets[1]);
+    CHECK_EQUAL(1, UARTStats_RttPercentile(p_rtt, 0));
+}
+
+static void TestRttTopBucket(void)
+{
+    const UARTStats_Rtt_T *p_rtt = &UARTStats_Get()->rtt[RTT_IDX_START_NODE];
+
+    SetUp();
+
+    // Longest time of the second to last bucket, then times beyond the histogram range
+    MeasureRtt((1UL << (UART_STATS_RTT_BUCKET_COUNT - 2)) - 1);
+    MeasureRtt(5000000);
+    MeasureRtt(0x7FFFFFFFu);
+
+    CHECK_EQUAL(3, p_rtt->count);
+    CHECK_EQUAL((1UL << (UART_STATS_RTT_BUCKET_COUNT - 2)) - 1, p_rtt->min_us);
+    CHECK_EQUAL(0x7FFFFFFFu, p_rtt->max_us);
+    CHECK_EQUAL(1, p_rtt->buckets[UART_STATS_RTT_BUCKET_COUNT - 2]);
+    CHECK_EQUAL(2, p_rtt->buckets[UART_STATS_RTT_BUCKET_COUNT - 1]);
+
+    CHECK_EQUAL((1UL << (UART_STATS_RTT_BUCKET_COUNT - 2)) - 1, UARTStats_RttPercentile(p_rtt, 33));
+    // Last bucket has no upper bound, so its percentiles are reported as maximum
+    CHECK_EQUAL(0x7FFFFFFFu, UARTStats_RttPercentile(p_rtt, 50));
+    CHECK_EQUAL(0x7FFFFFFFu, UARTStats_RttPercentile(p_rtt, 99));
+}
+
+int main(void)
+{
+    TestHandlerTime();
+    TestRejectedFramesNotTimed();
+    TestHandlerTimeAcrossMicrosWrap();
+    TestParseSkippedWithoutRxData();
+    TestRttEmpty();
+    TestRttPercentiles();
+    TestRttTopBucket();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,105 @@
+/*
+Copyright © 2021 Silvair Sp. z o.o. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+ *  Host stand-in for the Arduino core, used by unit test targets. Time is
+ *  driven by the test through MockClock_Advance, so time measurements done
+ *  by the code under test are deterministic.
+ */
+
+#ifndef ARDUINO_H_
+#define ARDUINO_H_
+
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+
+#define lowByte(w) ((uint8_t)((w)&0xFF))
+#define highByte(w) ((uint8_t)((w) >> 8))
+
+#define LOW 0
+#define HIGH 1
+
+struct SerialStub
+{
+    void begin(uint32_t baudrate)
+    {
+        (void)baudrate;
+    }
+
+    void printf(const char *format, ...)
+    {
+        va_list args;
+        va_start(args, format);
+        vprintf(format, args);
+        va_end(args);
+    }
+
+    void flush(void)
+    {
+        fflush(stdout);
+    }
+};
+
+extern SerialStub Serial;
+
+/*
+ *  Get mock clock time in milliseconds
+ *
+ *  @return             Time since start
+ */
+uint32_t millis(void);
+
+/*
+ *  Get mock clock time in microseconds
+ *
+ *  @return             Time since start
+ */
+uint32_t micros(void);
+
+/*
+ *  Advance mock clock
+ *
+ *  @param ms           Time to advance in milliseconds
+ */
+void delay(uint32_t ms);
+
+/*
+ *  Advance mock clock
+ *
+ *  @param us           Time to advance in microseconds
+ */
+void MockClock_Advance(uint32_t us);
+
+/*
+ *  Set digital pin output, ignored on host
+ *
+ *  @param pin          Pin number
+ *  @param value        LOW or HIGH
+ */
+void digitalWrite(uint8_t pin, uint8_t value);
+
+#endif    // ARDUINO_H_